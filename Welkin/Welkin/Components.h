@@ -0,0 +1,75 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <type_traits>
+#include "TransformSystem.h"
+
+class Mesh;
+class Material;
+
+//How often an object's transform changes, decides where its instance data lives and how often it's uploaded
+enum class Mobility
+{
+	//Never moves after creation, so StaticBatcher may merge it into a batch
+	STATIC,
+	//Moves rarely, kept out of batches and uploaded only when it does
+	STATIONARY,
+	//Moves often, uploaded every frame
+	DYNAMIC
+};
+
+//Components live in EntityRegistry's chunks and are moved with memcpy, so they have to be plain data
+//The transform itself stays in TransformSystem's arrays, the entity only holds its handle
+struct TransformRef
+{
+	TransformHandle handle;
+};
+
+struct MeshRef
+{
+	Mesh* mesh;
+};
+
+struct MaterialRef
+{
+	Material* material;
+};
+
+//Model space bounding sphere, copied from the mesh so culling doesn't have to load it
+struct Bounds
+{
+	glm::vec3 center;
+	float radius;
+};
+
+struct MobilityState
+{
+	Mobility mobility;
+};
+
+//Every component type has a bit in an archetype's mask
+enum class ComponentType : uint32_t
+{
+	TRANSFORM,
+	MESH,
+	MATERIAL,
+	BOUNDS,
+	MOBILITY,
+	COUNT
+};
+
+typedef uint32_t ComponentMask;
+
+template<typename T> struct ComponentInfo;
+template<> struct ComponentInfo<TransformRef> { static const ComponentType type = ComponentType::TRANSFORM; };
+template<> struct ComponentInfo<MeshRef> { static const ComponentType type = ComponentType::MESH; };
+template<> struct ComponentInfo<MaterialRef> { static const ComponentType type = ComponentType::MATERIAL; };
+template<> struct ComponentInfo<Bounds> { static const ComponentType type = ComponentType::BOUNDS; };
+template<> struct ComponentInfo<MobilityState> { static const ComponentType type = ComponentType::MOBILITY; };
+
+template<typename... Components>
+ComponentMask MaskOf()
+{
+	static_assert((std::is_trivially_copyable<Components>::value && ...), "Components are moved between chunks with memcpy");
+	return ((1u << static_cast<uint32_t>(ComponentInfo<Components>::type)) | ... | 0u);
+}
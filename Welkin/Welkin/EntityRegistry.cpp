@@ -0,0 +1,237 @@
+#include "EntityRegistry.h"
+#include <cstring>
+#include <new>
+
+namespace
+{
+	//In ComponentType order
+	const uint32_t COMPONENT_SIZES[] = { sizeof(TransformRef), sizeof(MeshRef), sizeof(MaterialRef), sizeof(Bounds), sizeof(MobilityState) };
+	static_assert(sizeof(COMPONENT_SIZES) / sizeof(COMPONENT_SIZES[0]) == static_cast<uint32_t>(ComponentType::COUNT), "Every component needs a size");
+
+	//Every array starts on its own 16 bytes, so a chunk's arrays can be loaded with SSE
+	const uint32_t ARRAY_ALIGNMENT = 16;
+
+	uint32_t AlignUp(uint32_t value)
+	{
+		return (value + ARRAY_ALIGNMENT - 1) & ~(ARRAY_ALIGNMENT - 1);
+	}
+}
+
+EntityRegistry::EntityRegistry() : structureVersion{ 0 }
+{
+}
+
+EntityRegistry::~EntityRegistry()
+{
+	for (auto& archetype : archetypes)
+	{
+		for (auto& chunk : archetype.chunks)
+		{
+			operator delete[](chunk.data, std::align_val_t(ARRAY_ALIGNMENT));
+		}
+	}
+}
+
+#pragma region Entities
+EntityHandle EntityRegistry::Create(ComponentMask components, const std::string& name)
+{
+	EntityHandle entity;
+	if (freeEntities.empty())
+	{
+		entity.index = static_cast<uint32_t>(records.size());
+		records.push_back(EntityRecord{ 0, 0, 0, 0, false });
+		names.emplace_back();
+	}
+	else
+	{
+		entity.index = freeEntities.back();
+		freeEntities.pop_back();
+	}
+
+	EntityRecord& record = records[entity.index];
+	record.alive = true;
+	entity.generation = record.generation;
+	names[entity.index] = name;
+
+	AddRow(entity, FindArchetype(components));
+	structureVersion++;
+	return entity;
+}
+
+void EntityRegistry::Destroy(EntityHandle entity)
+{
+	GetRecord(entity);
+	EntityRecord& record = records[entity.index];
+	RemoveRow(record);
+
+	record.alive = false;
+	record.generation++;
+	names[entity.index].clear();
+	freeEntities.push_back(entity.index);
+	structureVersion++;
+}
+
+bool EntityRegistry::IsValid(EntityHandle entity) const
+{
+	return entity.index < records.size() && records[entity.index].alive && records[entity.index].generation == entity.generation;
+}
+
+void EntityRegistry::SetComponents(EntityHandle entity, ComponentMask components)
+{
+	const EntityRecord oldRecord = GetRecord(entity);
+	if (archetypes[oldRecord.archetype].mask == components)
+	{
+		return;
+	}
+
+	//Found before taking references, adding an archetype can move the others
+	const uint32_t newArchetypeIndex = FindArchetype(components);
+	AddRow(entity, newArchetypeIndex);
+
+	const EntityRecord& newRecord = records[entity.index];
+	const Archetype& oldArchetype = archetypes[oldRecord.archetype];
+	const Archetype& newArchetype = archetypes[newArchetypeIndex];
+	const ComponentMask shared = oldArchetype.mask & newArchetype.mask;
+
+	for (uint32_t type = 0; type < COMPONENT_COUNT; type++)
+	{
+		if (shared & (1u << type))
+		{
+			memcpy(newArchetype.chunks[newRecord.chunk].data + newArchetype.offsets[type] + newRecord.row * COMPONENT_SIZES[type],
+				oldArchetype.chunks[oldRecord.chunk].data + oldArchetype.offsets[type] + oldRecord.row * COMPONENT_SIZES[type], COMPONENT_SIZES[type]);
+		}
+	}
+
+	RemoveRow(oldRecord);
+	structureVersion++;
+}
+
+ComponentMask EntityRegistry::GetComponents(EntityHandle entity) const
+{
+	return archetypes[GetRecord(entity).archetype].mask;
+}
+
+const EntityRegistry::EntityRecord& EntityRegistry::GetRecord(EntityHandle entity) const
+{
+	if (!IsValid(entity))
+	{
+		throw std::runtime_error("Used an entity handle after its entity was destroyed!");
+	}
+	return records[entity.index];
+}
+#pragma endregion
+
+#pragma region Chunks
+uint32_t EntityRegistry::FindArchetype(ComponentMask mask)
+{
+	for (uint32_t i = 0; i < archetypes.size(); i++)
+	{
+		if (archetypes[i].mask == mask)
+		{
+			return i;
+		}
+	}
+
+	Archetype archetype{};
+	archetype.mask = mask;
+
+	uint32_t bytesPerEntity = sizeof(EntityHandle);
+	for (uint32_t type = 0; type < COMPONENT_COUNT; type++)
+	{
+		if (mask & (1u << type))
+		{
+			bytesPerEntity += COMPONENT_SIZES[type];
+		}
+	}
+
+	//As many as fit once every array is padded to its alignment, the offsets are always the ones of the capacity the loop stops at
+	for (archetype.capacity = CHUNK_SIZE / bytesPerEntity; archetype.capacity > 0; archetype.capacity--)
+	{
+		uint32_t offset = AlignUp(archetype.capacity * sizeof(EntityHandle));
+		for (uint32_t type = 0; type < COMPONENT_COUNT; type++)
+		{
+			if (mask & (1u << type))
+			{
+				archetype.offsets[type] = offset;
+				offset = AlignUp(offset + archetype.capacity * COMPONENT_SIZES[type]);
+			}
+		}
+
+		if (offset <= CHUNK_SIZE)
+		{
+			break;
+		}
+	}
+
+	if (archetype.capacity == 0)
+	{
+		throw std::runtime_error("Components of one entity don't fit in a " + std::to_string(CHUNK_SIZE) + " byte chunk!");
+	}
+
+	archetypes.push_back(std::move(archetype));
+	return static_cast<uint32_t>(archetypes.size() - 1);
+}
+
+void EntityRegistry::AddRow(EntityHandle entity, uint32_t archetypeIndex)
+{
+	Archetype& archetype = archetypes[archetypeIndex];
+
+	if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity)
+	{
+		Chunk chunk;
+		chunk.data = static_cast<uint8_t*>(operator new[](CHUNK_SIZE, std::align_val_t(ARRAY_ALIGNMENT)));
+		chunk.count = 0;
+		archetype.chunks.push_back(chunk);
+	}
+
+	Chunk& chunk = archetype.chunks.back();
+	const uint32_t row = chunk.count++;
+
+	reinterpret_cast<EntityHandle*>(chunk.data)[row] = entity;
+	for (uint32_t type = 0; type < COMPONENT_COUNT; type++)
+	{
+		if (archetype.mask & (1u << type))
+		{
+			memset(chunk.data + archetype.offsets[type] + row * COMPONENT_SIZES[type], 0, COMPONENT_SIZES[type]);
+		}
+	}
+
+	EntityRecord& record = records[entity.index];
+	record.archetype = archetypeIndex;
+	record.chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+	record.row = row;
+}
+
+void EntityRegistry::RemoveRow(const EntityRecord& record)
+{
+	Archetype& archetype = archetypes[record.archetype];
+	Chunk& lastChunk = archetype.chunks.back();
+	const uint32_t lastRow = lastChunk.count - 1;
+	Chunk& chunk = archetype.chunks[record.chunk];
+
+	//Keeps the chunks packed, the archetype's last entity takes the hole
+	if (&chunk != &lastChunk || record.row != lastRow)
+	{
+		const EntityHandle moved = reinterpret_cast<EntityHandle*>(lastChunk.data)[lastRow];
+		reinterpret_cast<EntityHandle*>(chunk.data)[record.row] = moved;
+
+		for (uint32_t type = 0; type < COMPONENT_COUNT; type++)
+		{
+			if (archetype.mask & (1u << type))
+			{
+				memcpy(chunk.data + archetype.offsets[type] + record.row * COMPONENT_SIZES[type], lastChunk.data + archetype.offsets[type] + lastRow * COMPONENT_SIZES[type], COMPONENT_SIZES[type]);
+			}
+		}
+
+		records[moved.index].chunk = record.chunk;
+		records[moved.index].row = record.row;
+	}
+
+	lastChunk.count--;
+	if (lastChunk.count == 0)
+	{
+		operator delete[](lastChunk.data, std::align_val_t(ARRAY_ALIGNMENT));
+		archetype.chunks.pop_back();
+	}
+}
+#pragma endregion
@@ -0,0 +1,145 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#include "Components.h"
+
+//Index into EntityRegistry's entity table, the generation catches handles that are used after their entity was destroyed
+struct EntityHandle
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+};
+
+//Entities with the same set of components share an archetype, which stores them in fixed size chunks with one contiguous array per component
+//Queries walk the chunks of every archetype that has the components asked for, so iterating never follows a pointer per entity
+//Removing an entity moves the archetype's last entity into its place, handles stay valid but the order entities are visited in changes
+class EntityRegistry
+{
+public:
+	EntityRegistry();
+	~EntityRegistry();
+
+	EntityRegistry(const EntityRegistry&) = delete;
+	EntityRegistry& operator=(const EntityRegistry&) = delete;
+
+	//Components start zeroed
+	EntityHandle Create(ComponentMask components, const std::string& name = "");
+	//The handle is reused by a later Create with a new generation
+	void Destroy(EntityHandle entity);
+	bool IsValid(EntityHandle entity) const;
+
+	//Moves the entity to the archetype with these components, the ones it already had keep their values
+	void SetComponents(EntityHandle entity, ComponentMask components);
+	ComponentMask GetComponents(EntityHandle entity) const;
+
+	//Throws if the entity doesn't have the component
+	//The reference is only good until the next Create, Destroy or SetComponents
+	template<typename T>
+	T& Get(EntityHandle entity)
+	{
+		const EntityRecord& record = GetRecord(entity);
+		Archetype& archetype = archetypes[record.archetype];
+		const uint32_t type = static_cast<uint32_t>(ComponentInfo<T>::type);
+
+		if ((archetype.mask & (1u << type)) == 0)
+		{
+			throw std::runtime_error("Entity " + names[entity.index] + " has no component " + std::to_string(type));
+		}
+		return reinterpret_cast<T*>(archetype.chunks[record.chunk].data + archetype.offsets[type])[record.row];
+	}
+
+	template<typename T>
+	bool Has(EntityHandle entity) const
+	{
+		return (GetComponents(entity) & MaskOf<T>()) != 0;
+	}
+
+	const std::string& GetName(EntityHandle entity) const { GetRecord(entity); return names[entity.index]; };
+	void SetName(EntityHandle entity, const std::string& name) { GetRecord(entity); names[entity.index] = name; };
+
+	//Calls function(count, entities, arrays...) once per chunk of every archetype with all of Components, each array has count entries
+	//Nothing may be created, destroyed or moved to another archetype from inside function
+	template<typename... Components, typename Function>
+	void ForEachChunk(Function&& function)
+	{
+		const ComponentMask mask = MaskOf<Components...>();
+		for (Archetype& archetype : archetypes)
+		{
+			if ((archetype.mask & mask) != mask)
+			{
+				continue;
+			}
+
+			for (Chunk& chunk : archetype.chunks)
+			{
+				function(chunk.count, reinterpret_cast<const EntityHandle*>(chunk.data), reinterpret_cast<Components*>(chunk.data + archetype.offsets[static_cast<uint32_t>(ComponentInfo<Components>::type)])...);
+			}
+		}
+	}
+
+	//Same, but calls function(components...) for every entity
+	template<typename... Components, typename Function>
+	void ForEach(Function&& function)
+	{
+		ForEachChunk<Components...>([&](uint32_t count, const EntityHandle*, Components*... arrays)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				function(arrays[i]...);
+			}
+		});
+	}
+
+	//Live entities
+	uint32_t GetCount() const { return static_cast<uint32_t>(records.size() - freeEntities.size()); };
+	//Goes up whenever an entity is created, destroyed or changes archetype, which is whenever the order queries visit entities in can change
+	uint32_t GetStructureVersion() const { return this->structureVersion; };
+
+private:
+	//Bytes per chunk, small enough to stay in L2 while a query walks it
+	static const uint32_t CHUNK_SIZE = 16 * 1024;
+	static const uint32_t COMPONENT_COUNT = static_cast<uint32_t>(ComponentType::COUNT);
+
+	struct Chunk
+	{
+		//Entity handles first, then one array per component at the archetype's offsets
+		uint8_t* data;
+		uint32_t count;
+	};
+
+	struct Archetype
+	{
+		ComponentMask mask;
+		//Entities per chunk
+		uint32_t capacity;
+		//Byte offset of each component's array in a chunk, only meaningful for the components in mask
+		uint32_t offsets[COMPONENT_COUNT];
+		//Every chunk but the last is full
+		std::vector<Chunk> chunks;
+	};
+
+	struct EntityRecord
+	{
+		uint32_t archetype;
+		uint32_t chunk;
+		uint32_t row;
+		uint32_t generation;
+		bool alive;
+	};
+
+	std::vector<Archetype> archetypes;
+	std::vector<EntityRecord> records;
+	//Cold, only read by name lookups and logging
+	std::vector<std::string> names;
+	std::vector<uint32_t> freeEntities;
+	uint32_t structureVersion;
+
+	const EntityRecord& GetRecord(EntityHandle entity) const;
+	uint32_t FindArchetype(ComponentMask mask);
+	//Adds a zeroed row at the end of the archetype and points the entity's record at it
+	void AddRow(EntityHandle entity, uint32_t archetypeIndex);
+	//Fills the entity's row with the archetype's last one, its record isn't touched
+	void RemoveRow(const EntityRecord& record);
+};
@@ -1,31 +1,59 @@
 #include "FileManager.h"
+#include <algorithm>
 
-FileManager::FileManager(VulkanCore* vCore)
+FileManager::FileManager(JobSystem* jobSystem)
 {
     Helper::Cout("File Manager", true);
-    this->vCore = vCore;
+    this->jobSystem = jobSystem;
+    this->vCore = nullptr;
+    this->device = nullptr;
+    this->textureStreamer = nullptr;
 	totalTexturesLoaded = 0;
+
+    //Shaders first, models check which vertex formats there are shaders for
+    ReadAllShaders();
+    ImportAllModels();
+}
+
+void FileManager::Load(VulkanCore* vCore)
+{
+    this->vCore = vCore;
     this->device = vCore->GetLogicalDevice();
-    
-    try
-    {
-        this->device = device;
-    }
-    catch (const std::exception& ex)
-    {
-        std::cout << ex.what() << std::endl;
-    }
 
-    LoadAllModels();
+    //Textures stream in after the first frame, materials bind the placeholder until then
+    textureStreamer = new TextureStreamer(vCore);
+
+    //Only queues the textures, so this runs while the workers are still importing
     //LoadAllTextures(device);
     CreateMaterial("BrickSimple");
     CreateMaterial("VikingRoom");
 
-    LoadAllShaders(device);
+    jobSystem->Wait(&loadJobs);
+
+    CreateAllShaderModules(device);
+    UploadAllModels();
 }
 
 FileManager::~FileManager()
 {
+    //Jobs still running write into this
+    try
+    {
+        jobSystem->Wait(&loadJobs);
+    }
+    catch (const std::exception& ex)
+    {
+        Helper::Warning(ex.what());
+    }
+
+    for (const auto& importedMesh : importedMeshes)
+    {
+        delete importedMesh.second;
+    }
+
+    //Stops the workers and waits for uploads still in flight
+    delete textureStreamer;
+
     for (const auto& shaderFile : allShaders)
     {
         vkDestroyShaderModule(*device, *shaderFile.second, nullptr);
@@ -89,14 +117,20 @@ VkShaderModule* FileManager::FindShaderModule(string name)
     throw std::runtime_error("Couldn't find shader: " + name);
 }
 
+VkShaderModule* FileManager::TryFindShaderModule(string name)
+{
+    unordered_map<string, VkShaderModule*>::const_iterator iter = allShaders.find(name);
+    return (iter != allShaders.end()) ? iter->second : nullptr;
+}
+
 
 #pragma region Shaders
 
 //TODO Maybe make it so it doesn't load all shaders?
-void FileManager::LoadAllShaders(VkDevice* logicalDevice)
+void FileManager::ReadAllShaders()
 {
     Helper::Cout("");
-    Helper::Cout("Loading All Shaders");
+    Helper::Cout("Reading All Shaders");
 
     string path = "Shaders/";
     string ext = { ".spv" };
@@ -107,14 +141,36 @@ void FileManager::LoadAllShaders(VkDevice* logicalDevice)
         {
             if (entity.path().extension() == ext)
             {
-                std::pair<string, VkShaderModule*> newPair(fileName, new VkShaderModule());
-                *newPair.second = CreateShaderModule(ReadFile(path + fileName), logicalDevice);
-                allShaders.insert(newPair);
-                Helper::Cout("- Loaded Shader: " + fileName);
+                shaderFiles.emplace_back(fileName, std::vector<char>());
             }
         }
     }
 
+    //Sized up front, each job only writes its own entry
+    for (size_t i = 0; i < shaderFiles.size(); i++)
+    {
+        jobSystem->Run([this, path, i]() { shaderFiles[i].second = ReadFile(path + shaderFiles[i].first); }, &loadJobs);
+    }
+}
+
+void FileManager::CreateAllShaderModules(VkDevice* logicalDevice)
+{
+    std::vector<VkShaderModule> shaderModules(shaderFiles.size());
+    jobSystem->ParallelFor(static_cast<uint32_t>(shaderFiles.size()), [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            shaderModules[i] = CreateShaderModule(shaderFiles[i].second, logicalDevice);
+        }
+    }, 1);
+
+    for (size_t i = 0; i < shaderFiles.size(); i++)
+    {
+        allShaders.insert(std::pair<string, VkShaderModule*>(shaderFiles[i].first, new VkShaderModule(shaderModules[i])));
+        Helper::Cout("- Loaded Shader: " + shaderFiles[i].first);
+    }
+    shaderFiles.clear();
+
     Helper::Cout("- All Shaders Loaded!");
 }
 
@@ -156,24 +212,74 @@ std::vector<char> FileManager::ReadFile(const std::string& filename)
 
 #pragma region Models
 
-void FileManager::LoadAllModels()
+void FileManager::ImportAllModels()
 {
     std::string path = "Models/";
-    std::string ext = { ".obj" };
+    //glTF binaries and Wavefront OBJs, see Mesh::LoadModel
+    const std::vector<std::string> extensions = { ".obj", ".glb" };
+
+    //Falls back to full size vertices if the compact vertex shader hasn't been compiled, the shader modules don't exist yet so this goes by file name
+    VertexFormat format = VertexFormat::STANDARD;
+    if (Welkin_Settings::USE_COMPACT_VERTICES)
+    {
+        if (std::find_if(shaderFiles.begin(), shaderFiles.end(), [](const auto& shaderFile) { return shaderFile.first == "(C)SimpleShaderCompactVert.spv"; }) != shaderFiles.end())
+        {
+            format = VertexFormat::COMPACT;
+        }
+        else
+        {
+            Helper::Warning("(C)SimpleShaderCompactVert.spv is missing, using uncompressed vertices");
+        }
+    }
+
+    std::vector<std::string> modelPaths;
     for (auto& entity : fs::recursive_directory_iterator(path))
     {
         std::string fileName = entity.path().filename().string();
-        size_t lastIndex = fileName.find_last_of(".");
-        string rawName = fileName.substr(0, lastIndex);
         if (fs::is_regular_file(entity))
         {
-			if (entity.path().extension() == ext)
+			if (std::find(extensions.begin(), extensions.end(), entity.path().extension().string()) != extensions.end())
 			{
-				pair<string, Mesh*> newMesh(rawName, new Mesh(path + fileName, vCore));
-				allMeshes.insert(newMesh);
+				//Keyed with the extension, Foo.obj and Foo.glb are different meshes
+				importedMeshes.emplace_back(fileName, nullptr);
+				modelPaths.push_back(path + fileName);
 			}
         }
     }
+
+    //Parsing, optimizing and writing the cache are the slow part of a cold start, one job per model
+    for (size_t i = 0; i < importedMeshes.size(); i++)
+    {
+        jobSystem->Run([this, i, modelPath = modelPaths[i], format]() { importedMeshes[i].second = new Mesh(modelPath, format, jobSystem); }, &loadJobs);
+    }
+}
+
+void FileManager::UploadAllModels()
+{
+    //Staging buffers are filled, and compressed caches decoded, on every worker, then copied in one submit
+    vCore->BeginUploadBatch();
+    try
+    {
+        jobSystem->ParallelFor(static_cast<uint32_t>(importedMeshes.size()), [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                importedMeshes[i].second->Upload(vCore);
+            }
+        }, 1);
+    }
+    catch (...)
+    {
+        vCore->EndUploadBatch();
+        throw;
+    }
+    vCore->EndUploadBatch();
+
+    for (const auto& importedMesh : importedMeshes)
+    {
+        allMeshes.insert(importedMesh);
+    }
+    importedMeshes.clear();
 }
 #pragma endregion
 
@@ -196,10 +302,11 @@ void FileManager::LoadAllTextures(VkDevice* logicalDevice)
         {
             if (entity.path().extension() == ext)
             {
-                pair<string, Texture*> newTex(rawName, new Texture(entity.path().string(), vCore, totalTexturesLoaded));
+                pair<string, Texture*> newTex(rawName, new Texture(entity.path().string(), vCore, totalTexturesLoaded, textureStreamer->GetPlaceholder()));
                 allTextures.insert(newTex);
+                textureStreamer->RequestTexture(newTex.second);
 				totalTexturesLoaded++;
-                Helper::Cout("-- Loaded Texture: " + fileName);
+                Helper::Cout("-- Queued Texture: " + fileName);
             }
         }
     }
@@ -223,9 +330,10 @@ std::pair<string, unsigned short> FileManager::LoadTexturesFromFolder(string fol
         {
             if (entity.path().extension() == ext)
             {
-				pair<string, Texture*> newTex(rawName, new Texture(entity.path().string(), vCore, totalTexturesLoaded));
+				pair<string, Texture*> newTex(rawName, new Texture(entity.path().string(), vCore, totalTexturesLoaded, textureStreamer->GetPlaceholder()));
 				allTextures.insert(newTex);
-                Helper::Cout("-- Loaded Texture: " + fileName);
+                textureStreamer->RequestTexture(newTex.second);
+                Helper::Cout("-- Queued Texture: " + fileName);
 
                 numberOfTextures++;
                 if (firstFileName == "")
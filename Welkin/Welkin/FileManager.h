@@ -3,10 +3,10 @@
 #include <string>
 #include <map>
 #include <filesystem>
-#include <tiny_obj_loader.h>
 #include <vulkan/vulkan.h>
 #include <fstream>
 #include "Texture.h"
+#include "TextureStreamer.h"
 #include <unordered_map>
 #include <memory>
 #include <vector>
@@ -16,33 +16,53 @@
 #include "Helper.h"
 #include "Mesh.h"
 #include "VulkanCore.h"
+#include "JobSystem.h"
 
 namespace fs = std::filesystem;
 
 class FileManager
 {
 public:
-	FileManager(VulkanCore* vCore);
+	//Starts reading the shaders and importing the models on the job system, neither needs the device so this can run while it's created
+	FileManager(JobSystem* jobSystem);
 	~FileManager();
+	//Finishes loading once the device exists, shader modules, materials and one batched upload for every mesh
+	void Load(VulkanCore* vCore);
 
+	//By file name with its extension, VikingRoom.obj
 	Mesh* FindMesh(string name);
 	Material* FindMaterial(string name);
 	unordered_map<string, Material*>* GetAllMaterials() { return &this->allMaterials; };
 	unordered_map<string, Texture*>* GetAllTextures() { return &this->allTextures; };
+	unordered_map<string, Mesh*>* GetAllMeshes() { return &this->allMeshes; };
 	VkShaderModule* FindShaderModule(string name);
+	//Same as FindShaderModule but returns nullptr instead of throwing, for optional shaders
+	VkShaderModule* TryFindShaderModule(string name);
+	TextureStreamer* GetTextureStreamer() { return this->textureStreamer; };
+	JobSystem* GetJobSystem() { return this->jobSystem; };
 
 private:
 
 	VulkanCore* vCore;
+	JobSystem* jobSystem;
 	VkDevice* device;
 	int totalTexturesLoaded;
+	TextureStreamer* textureStreamer;
+
+	//Started by the constructor, waited on by Load
+	JobCounter loadJobs;
+	//Filled by loadJobs, turned into allShaders and allMeshes by Load
+	std::vector<std::pair<string, std::vector<char>>> shaderFiles;
+	std::vector<std::pair<string, Mesh*>> importedMeshes;
 
 	void LoadAllTextures(VkDevice* logicalDevice);
 	std::pair<string, unsigned short> LoadTexturesFromFolder(string folderName);
-	void LoadAllModels();
+	void ReadAllShaders();
+	void ImportAllModels();
+	void UploadAllModels();
 	void CreateMaterial(string folderMaterialName, bool loadTexturesFromFolder = true);
 
-	void LoadAllShaders(VkDevice* logicalDevice);
+	void CreateAllShaderModules(VkDevice* logicalDevice);
 	VkShaderModule CreateShaderModule(const std::vector<char>& shaderCode, VkDevice* device);
 	static std::vector<char> ReadFile(const std::string& filename);
 	
@@ -9,6 +9,12 @@ void Game::Init()
 {
 	Helper::Cout("Game Initalization", true);
 
+	//First, so everything after can split its work over it
+	jobSystem = new JobSystem(Welkin_Settings::JOB_WORKER_COUNT, Welkin_Settings::PIN_JOB_THREADS, Welkin_Settings::JOB_MAIN_THREAD_HELPS);
+
+	//Shaders are read and models imported on the workers while the window and device are created
+	fileManager = new FileManager(jobSystem);
+
 	mainWindow = new WkWindow{ WIDTH, HEIGHT, "Main Welkin Window" };
 
 	input = new Input(mainWindow);
@@ -18,15 +24,28 @@ void Game::Init()
 
 	vCore = new VulkanCore(mainWindow->GetWindow());
 
-	fileManager = new FileManager(vCore);
+	fileManager->Load(vCore);
+
+	transformSystem = new TransformSystem();
+	entityRegistry = new EntityRegistry();
 
-	renderer = new Renderer(vCore, fileManager, mainCamera, &gameObjects);
+	sceneSnapshots = new SnapshotExchange();
+	rendering = false;
+	deltaTime = 0;
+	framesElapsed = 0;
+	totalTimeSinceFPS = 0;
+
+	renderer = new Renderer(vCore, fileManager, sceneSnapshots, jobSystem);
 
 
 	//imGui = new ImGUI(vCore, mainWindow, input);
 
 	AssetCreation();
 
+	//Static objects are final once the scene is created
+	staticBatcher = new StaticBatcher(vCore, entityRegistry, transformSystem, jobSystem);
+	staticBatcher->Build(gameObjects);
+
 	Update();
 }
 
@@ -34,6 +53,7 @@ Game::~Game()
 {
 	//Clean up all other vulkan resources before
 	delete fileManager;
+	delete staticBatcher;
 	delete mainCamera;
 	delete renderer;
 	delete vCore;
@@ -45,6 +65,11 @@ Game::~Game()
 	{
 		delete gameObject;
 	}
+	delete entityRegistry;
+	delete transformSystem;
+	delete sceneSnapshots;
+	//Last, anything above may still have jobs queued
+	delete jobSystem;
 }
 
 void Game::AssetCreation()
@@ -52,24 +77,24 @@ void Game::AssetCreation()
 	Helper::Cout("Asset Creation", true);
 
 	//TODO change the naming conventions of models and materials
-	//CreateObject("Viking Cone", "Pyramid", "VikingRoom");
+	//CreateObject("Viking Cone", "Pyramid.obj", "VikingRoom");
 
 	Transform planeTransform(vec3(0, -3, 0), vec3(0, 0, 0), vec3(5, 5, 5));
-	CreateObject("Main Plane", "SimplePlane", "VikingRoom", planeTransform);
+	CreateObject("Main Plane", "SimplePlane.obj", "VikingRoom", planeTransform, Mobility::STATIC);
 
 	Transform cubeTransform(vec3(3, 0, 0), vec3(0, 0, 0), vec3(2, 2, 2));
-	CreateObject("Smooth Cube", "(HighPoly)SmoothCube", "VikingRoom", cubeTransform);
+	CreateObject("Smooth Cube", "(HighPoly)SmoothCube.obj", "VikingRoom", cubeTransform);
 
 	Transform vikingTransform(vec3(0, 1, 0), vec3(0, 0, 0), vec3(2, 2, 2));
-	CreateObject("Smooth Cube", "VikingRoom", "VikingRoom", vikingTransform);
+	CreateObject("Smooth Cube", "VikingRoom.obj", "VikingRoom", vikingTransform);
 }
 
-void Game::CreateObject(string objName, string modelName, string materialFolderName, Transform transform, bool sort)
+void Game::CreateObject(string objName, string modelName, string materialFolderName, Transform transform, Mobility mobility, bool sort)
 {
-	GameObject* newObj = new GameObject(objName, fileManager->FindMesh(modelName), fileManager->FindMaterial(materialFolderName));
-	newObj->GetTransform()->SetTransform(transform);
-	vector<GameObject*>::iterator location = upper_bound(gameObjects.begin(), gameObjects.end(), newObj);
-	gameObjects.insert(location, newObj);
+	GameObject* newObj = new GameObject(objName, fileManager->FindMesh(modelName), fileManager->FindMaterial(materialFolderName), entityRegistry, transformSystem, transform);
+	newObj->SetMobility(mobility);
+	//Draw order is sorted by the renderer, so where it goes in the list doesn't matter
+	gameObjects.push_back(newObj);
 
 	//Technically shouldn't ever need to call this...
 	if (sort)
@@ -80,63 +105,192 @@ void Game::Update()
 {
 	Helper::Cout("Game Loop", true);
 
-	while (!mainWindow->shouldClose())
+	//The render thread only reads snapshots, so objects could be added or removed past this point
+	double simulationTime = SceneSnapshot::ClockNow();
+	PublishSnapshot(simulationTime);
+
+	if (Welkin_Settings::USE_RENDER_THREAD)
 	{
-		auto startTime = std::chrono::high_resolution_clock::now();
-		//Helper::Cout("[" + std::to_string(framesElapsed) + "]");
-		
-		//MAIN LOOP
-		{ 
-			glfwPollEvents();
-			input->Update();
-			mainCamera->Update((float)deltaTime);
+		rendering = true;
+		renderThread = std::thread(&Game::RenderLoop, this);
+	}
 
-			if (input->KeyDown(GLFW_KEY_P))
-			{
-				const float rotateSpeed = 0.1f;
-				gameObjects[0]->GetTransform()->Rotate(0, 0, rotateSpeed * (float)deltaTime);
-			}
+	//MAIN LOOP
+	//GLFW only takes events on the main thread, so it polls and simulates while the render thread draws the last published step
+	while (!mainWindow->shouldClose() && (rendering || !Welkin_Settings::USE_RENDER_THREAD))
+	{
+		glfwPollEvents();
+		vCore->UpdateFramebufferSize();
+
+		//Too far behind to catch up, after a breakpoint or a stall, skips ahead instead of simulating every missed step
+		const double now = SceneSnapshot::ClockNow();
+		const double maxLag = Welkin_Settings::SIMULATION_STEP_MS * 5.0;
+		if (now - simulationTime > maxLag)
+		{
+			simulationTime = now - maxLag;
+		}
 
-			for (auto& gameObj : gameObjects)
+		if (now - simulationTime >= Welkin_Settings::SIMULATION_STEP_MS)
+		{
+			//Every step due this loop sees the same input
+			input->Update();
+			while (now - simulationTime >= Welkin_Settings::SIMULATION_STEP_MS)
 			{
-				gameObj->GetTransform()->UpdateMatrices();
+				Simulate(Welkin_Settings::SIMULATION_STEP_MS);
+				simulationTime += Welkin_Settings::SIMULATION_STEP_MS;
 			}
+			input->EndOfFrame();
 
-			//imGui->Update((float)deltaTime);
+			PublishSnapshot(simulationTime);
+		}
+
+		if (!Welkin_Settings::USE_RENDER_THREAD)
+		{
+			DrawFrame();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(simulationTime + Welkin_Settings::SIMULATION_STEP_MS - SceneSnapshot::ClockNow()));
+		}
+	}
+
+	if (renderThread.joinable())
+	{
+		rendering = false;
+		renderThread.join();
+	}
+
+	vkDeviceWaitIdle(*vCore->GetLogicalDevice());
+
+	if (renderError)
+	{
+		std::rethrow_exception(renderError);
+	}
+}
 
-			if (gameObjects.size() > 0)
+void Game::Simulate(float dt)
+{
+	mainCamera->Update(dt);
+
+	if (input->KeyDown(GLFW_KEY_P))
+	{
+		const float rotateSpeed = 0.1f;
+		gameObjects[0]->Rotate(0, 0, rotateSpeed * dt);
+	}
+
+	transformSystem->UpdateMatrices();
+
+	//imGui->Update(dt);
+}
+
+void Game::PublishSnapshot(double time)
+{
+	SceneSnapshot* snapshot = sceneSnapshots->GetWriteSnapshot();
+	snapshot->time = time;
+
+	mainCamera->UpdateProjectionMatrix();
+	mainCamera->UpdateViewMatrix();
+	snapshot->projection = mainCamera->GetProjection();
+	snapshot->view = mainCamera->GetView();
+	snapshot->camera = SnapshotPose::FromMatrix(glm::inverse(snapshot->view));
+
+	const bool evaluateTransforms = renderer->IsTransformEvaluationEnabled();
+	const size_t count = entityRegistry->GetCount();
+	snapshot->worlds.resize(count);
+	snapshot->poses.resize(count);
+	snapshot->meshes.resize(count);
+	snapshot->materials.resize(count);
+	snapshot->bounds.resize(count);
+	snapshot->mobilities.resize(count);
+	snapshot->objectSlots.resize(evaluateTransforms ? count : 0);
+
+	//Straight copies out of each chunk's arrays, only the world matrices are looked up through TransformSystem
+	size_t object = 0;
+	entityRegistry->ForEachChunk<TransformRef, MeshRef, MaterialRef, Bounds, MobilityState>([&](uint32_t chunkCount, const EntityHandle*, TransformRef* transforms, MeshRef* meshes, MaterialRef* materials, Bounds* bounds, MobilityState* mobilities)
+	{
+		for (uint32_t i = 0; i < chunkCount; i++, object++)
+		{
+			snapshot->worlds[object] = transformSystem->GetWorldMatrix(transforms[i].handle);
+			snapshot->meshes[object] = meshes[i].mesh;
+			snapshot->materials[object] = materials[i].material;
+			snapshot->bounds[object] = bounds[i];
+			snapshot->mobilities[object] = mobilities[i].mobility;
+			if (mobilities[i].mobility == Mobility::DYNAMIC)
 			{
-				if (framesElapsed == 0)
-				{
-					Helper::Cout("Begining to draw frame!");
-				}
-				renderer->DrawFrame();
+				snapshot->poses[object] = SnapshotPose::FromMatrix(snapshot->worlds[object]);
+			}
+			if (evaluateTransforms)
+			{
+				snapshot->objectSlots[object] = transformSystem->GetSlotIndex(transforms[i].handle);
 			}
-
-			input->EndOfFrame();
 		}
-		
+	});
+	//Entities missing one of the components aren't drawn
+	snapshot->worlds.resize(object);
+	snapshot->poses.resize(object);
+	snapshot->meshes.resize(object);
+	snapshot->materials.resize(object);
+	snapshot->bounds.resize(object);
+	snapshot->mobilities.resize(object);
+	snapshot->objectSlots.resize(evaluateTransforms ? object : 0);
+
+	snapshot->fixedVersion = GameObject::GetFixedVersion();
+	snapshot->structureVersion = entityRegistry->GetStructureVersion();
+
+	if (evaluateTransforms)
+	{
+		snapshot->slotCount = transformSystem->GetSlotCount();
+		snapshot->transformComponents.resize(static_cast<size_t>(snapshot->slotCount) * TransformSystem::GPU_COMPONENT_COUNT * sizeof(float));
+		transformSystem->WriteComponents(snapshot->transformComponents.data());
+	}
 
-		auto stopTime = std::chrono::high_resolution_clock::now();
-		using ms = std::chrono::duration<float, std::milli>;
-		deltaTime = std::chrono::duration_cast<ms>(stopTime - startTime).count();
-		framesElapsed++;
-		totalTimeSinceFPS += deltaTime;
+	sceneSnapshots->Publish();
+}
 
-		if (framesElapsed % 300)
+void Game::RenderLoop()
+{
+	try
+	{
+		while (rendering)
 		{
-			//Calculate FPS every 300 frames
-			FPS = (300.0f / totalTimeSinceFPS);
-			totalTimeSinceFPS = 0;
+			DrawFrame();
 		}
 	}
+	catch (...)
+	{
+		renderError = std::current_exception();
+		rendering = false;
+	}
+}
 
-	vkDeviceWaitIdle(*vCore->GetLogicalDevice());
+void Game::DrawFrame()
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	//Runs on the render thread, so the registry isn't touched here, the renderer skips frames whose snapshot has nothing in it
+	if (framesElapsed == 0)
+	{
+		Helper::Cout("Begining to draw frame!");
+	}
+	renderer->DrawFrame();
+
+	auto stopTime = std::chrono::high_resolution_clock::now();
+	using ms = std::chrono::duration<float, std::milli>;
+	deltaTime = std::chrono::duration_cast<ms>(stopTime - startTime).count();
+	framesElapsed++;
+	totalTimeSinceFPS += deltaTime;
+
+	if (framesElapsed % 300)
+	{
+		//Calculate FPS every 300 frames
+		FPS = (300.0f / totalTimeSinceFPS);
+		totalTimeSinceFPS = 0;
+	}
 }
 
 void Game::SortObjectsByMaterial()
 {
-	std::sort(gameObjects.begin(), gameObjects.end());
+	std::stable_sort(gameObjects.begin(), gameObjects.end(), [](const GameObject* a, const GameObject* b) { return *a < *b; });
 }
 
 void Game::SetScreenResolution(int width, int height)
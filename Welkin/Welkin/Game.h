@@ -8,7 +8,14 @@
 #include "Camera.h"
 #include "ImGUI.h"
 #include "GameObject.h"
+#include "EntityRegistry.h"
 #include "Renderer.h"
+#include "StaticBatcher.h"
+#include "JobSystem.h"
+#include "SceneSnapshot.h"
+#include <thread>
+#include <atomic>
+#include <exception>
 
 class Game
 {
@@ -23,14 +30,28 @@ public:
 private:
 
 	WkWindow* mainWindow;
+	JobSystem* jobSystem;
 	VulkanCore* vCore;
 	ImGUI* imGui;
 	Renderer* renderer;
+	StaticBatcher* staticBatcher;
+	TransformSystem* transformSystem;
+	//Where every object's components live, the snapshots are built by querying it
+	EntityRegistry* entityRegistry;
 	FileManager* fileManager;
 	Input* input;
 	Camera* mainCamera;
+	//Facades over the registry's entities, owned here so they're deleted with the scene
 	vector<GameObject*> gameObjects;
 
+	//Simulation to render thread handoff, see SnapshotExchange
+	SnapshotExchange* sceneSnapshots;
+	std::thread renderThread;
+	std::atomic<bool> rendering;
+	//Whatever ended the render thread, rethrown on the main thread
+	std::exception_ptr renderError;
+
+	//Time of the last frame drawn, only used for the FPS
 	float deltaTime;
 	float FPS;
 	unsigned int framesElapsed;
@@ -38,7 +59,13 @@ private:
 
 	void Init();
 	void AssetCreation();
-	void CreateObject(string objName, string modelName, string materialFolderName, Transform transform = Transform(), bool sort = false);
+	//One fixed step, dt is SIMULATION_STEP_MS
+	void Simulate(float dt);
+	//Copies what the renderer needs out of the simulation and hands it over
+	void PublishSnapshot(double time);
+	void RenderLoop();
+	void DrawFrame();
+	void CreateObject(string objName, string modelName, string materialFolderName, Transform transform = Transform(), Mobility mobility = Mobility::DYNAMIC, bool sort = false);
 	void SortObjectsByMaterial();
 	void SetScreenResolution(int width, int height);
 };
\ No newline at end of file
@@ -1,8 +1,21 @@
 #include "GameObject.h"
 
-GameObject::GameObject(string objectName, Mesh* mesh, Material* material):
-	name{ objectName }, mesh{mesh}, material {material}
+uint32_t GameObject::fixedVersion = 0;
+
+GameObject::GameObject(string objectName, Mesh* mesh, Material* material, EntityRegistry* registry, TransformSystem* transformSystem, const Transform& transform):
+	registry{ registry }, transformSystem{ transformSystem }
 {
+	entity = registry->Create(MaskOf<TransformRef, MeshRef, MaterialRef, Bounds, MobilityState>(), objectName);
+	registry->Get<TransformRef>(entity).handle = transformSystem->Create(transform);
+	registry->Get<MeshRef>(entity).mesh = mesh;
+	registry->Get<MaterialRef>(entity).material = material;
+	registry->Get<MobilityState>(entity).mobility = Mobility::DYNAMIC;
+	if (mesh != nullptr)
+	{
+		registry->Get<Bounds>(entity) = Bounds{ mesh->GetBoundsCenter(), mesh->GetBoundsRadius() };
+	}
+	fixedVersion++;
+
 	if (objectName != "" && mesh != nullptr && material != nullptr)
 	{
 		Helper::Cout("[" + objectName + "] Gameobject Created!");
@@ -15,20 +28,98 @@ GameObject::GameObject(string objectName, Mesh* mesh, Material* material):
 
 Mesh* GameObject::GetMesh()
 {
-	return this->mesh;
+	return registry->Get<MeshRef>(entity).mesh;
 }
 
 Material* GameObject::GetMaterial()
 {
-	return this->material;
+	return registry->Get<MaterialRef>(entity).material;
 }
 
-Transform* GameObject::GetTransform()
+GameObject::~GameObject()
 {
-	return &this->transform;
+	transformSystem->Destroy(GetTransformHandle());
+	registry->Destroy(entity);
+	fixedVersion++;
 }
 
 void GameObject::SetMaterial(Material* material)
 {
-	this->material = material;
+	registry->Get<MaterialRef>(entity).material = material;
+	//The renderer's draw order is sorted by material
+	fixedVersion++;
+}
+
+TransformHandle GameObject::GetTransformHandle()
+{
+	return registry->Get<TransformRef>(entity).handle;
+}
+
+void GameObject::SetTransform(const Transform& transform)
+{
+	transformSystem->SetTransform(GetTransformHandle(), transform);
+	TransformChanged();
+}
+
+void GameObject::SetPosition(const glm::vec3& position)
+{
+	transformSystem->SetPosition(GetTransformHandle(), position);
+	TransformChanged();
+}
+
+void GameObject::Rotate(float pitch, float yaw, float roll)
+{
+	transformSystem->Rotate(GetTransformHandle(), glm::vec3(pitch, yaw, roll));
+	TransformChanged();
+}
+
+glm::vec3 GameObject::GetPosition()
+{
+	return transformSystem->GetPosition(GetTransformHandle());
+}
+
+void GameObject::SetParent(GameObject* parent)
+{
+	transformSystem->SetParent(GetTransformHandle(), parent ? parent->GetTransformHandle() : TransformHandle());
+	TransformChanged();
+}
+
+const std::string& GameObject::GetName()
+{
+	return registry->GetName(entity);
+}
+
+void GameObject::SetName(const std::string& name)
+{
+	registry->SetName(entity, name);
+}
+
+Mobility GameObject::GetMobility()
+{
+	return registry->Get<MobilityState>(entity).mobility;
+}
+
+void GameObject::SetMobility(Mobility mobility)
+{
+	registry->Get<MobilityState>(entity).mobility = mobility;
+	fixedVersion++;
+}
+
+void GameObject::TransformChanged()
+{
+	//Dynamic objects are redone every frame anyway
+	if (GetMobility() != Mobility::DYNAMIC)
+	{
+		fixedVersion++;
+	}
+}
+
+const glm::mat4& GameObject::GetWorldMatrix()
+{
+	return transformSystem->GetWorldMatrix(GetTransformHandle());
+}
+
+const glm::mat4& GameObject::GetWorldInverseTransposeMatrix()
+{
+	return transformSystem->GetWorldInverseTransposeMatrix(GetTransformHandle());
 }
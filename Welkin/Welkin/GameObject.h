@@ -2,29 +2,60 @@
 #include "Mesh.h"
 #include "Camera.h"
 #include "Transform.h"
+#include "TransformSystem.h"
 #include "Material.h"
+#include "Components.h"
+#include "EntityRegistry.h"
 
+//Thin handle over an entity in EntityRegistry, everything it reads or writes lives in the registry's chunks or TransformSystem's arrays
+//Kept so code that builds the scene can keep working with objects, the renderer only ever sees the registry's queries
 class GameObject
 {
 public:
-	GameObject(std::string name, Mesh* mesh, Material* material);
+	//The transform is copied into transformSystem, both it and registry have to outlive the object
+	GameObject(std::string name, Mesh* mesh, Material* material, EntityRegistry* registry, TransformSystem* transformSystem, const Transform& transform = Transform());
+	~GameObject();
 
 	Mesh* GetMesh();
 	Material* GetMaterial();
-	Transform* GetTransform();
 
 	void SetMaterial(Material* material);
 
-	std::string name;
+	EntityHandle GetEntity() { return this->entity; };
+
+	//Transform lives in TransformSystem's arrays, these go through the handle
+	TransformHandle GetTransformHandle();
+	void SetTransform(const Transform& transform);
+	void SetPosition(const glm::vec3& position);
+	void Rotate(float pitch, float yaw, float roll);
+	glm::vec3 GetPosition();
+	//Position, rotation and scale become relative to parent, nullptr detaches
+	//Static and stationary objects shouldn't be parented to dynamic ones, their matrices are only uploaded when they change themselves
+	void SetParent(GameObject* parent);
+	//Only current after TransformSystem::UpdateMatrices
+	const glm::mat4& GetWorldMatrix();
+	const glm::mat4& GetWorldInverseTransposeMatrix();
+
+	const std::string& GetName();
+	void SetName(const std::string& name);
+
+	Mobility GetMobility();
+	void SetMobility(Mobility mobility);
+	//Changes whenever an object is created, destroyed or changes mobility or material, or a static or stationary one moves
+	//Work done for the objects that aren't dynamic only has to be redone when this changes
+	static uint32_t GetFixedVersion() { return fixedVersion; };
 
 	bool operator < (const GameObject& str) const
 	{
-		return (this->material->GetMaterialName() < str.material->GetMaterialName());
+		return (this->registry->Get<MaterialRef>(this->entity).material->GetMaterialName() < str.registry->Get<MaterialRef>(str.entity).material->GetMaterialName());
 	}
 
 private:
 
-	Mesh* mesh;
-	Material* material;
-	Transform transform;
+	EntityRegistry* registry;
+	EntityHandle entity;
+	TransformSystem* transformSystem;
+
+	static uint32_t fixedVersion;
+	void TransformChanged();
 };
\ No newline at end of file
@@ -0,0 +1,744 @@
+#include "GltfImporter.h"
+#include "MappedFile.h"
+#include "Helper.h"
+#include <charconv>
+#include <cfloat>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	const uint32_t GLB_MAGIC = 0x46546C67; //"glTF"
+	const uint32_t GLB_VERSION = 2;
+	const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; //"JSON"
+	const uint32_t GLB_CHUNK_BIN = 0x004E4942; //"BIN\0"
+
+	const uint32_t COMPONENT_BYTE = 5120;
+	const uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+	const uint32_t COMPONENT_SHORT = 5122;
+	const uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+	const uint32_t COMPONENT_UNSIGNED_INT = 5125;
+	const uint32_t COMPONENT_FLOAT = 5126;
+
+	const uint32_t MODE_TRIANGLES = 4;
+	//Deepest JSON nesting or node hierarchy, stops broken files with cycles from recursing forever
+	const uint32_t MAX_DEPTH = 64;
+
+	#pragma region JSON
+
+		//Just enough of a DOM for the glTF header, which is tiny next to the binary chunk
+		struct JsonValue
+		{
+			enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+			Type type = Type::NUL;
+			bool boolean = false;
+			double number = 0.0;
+			std::string string;
+			std::vector<JsonValue> array;
+			std::vector<std::pair<std::string, JsonValue>> object;
+
+			const JsonValue* Find(const char* key) const
+			{
+				for (const auto& member : object)
+				{
+					if (member.first == key)
+					{
+						return &member.second;
+					}
+				}
+				return nullptr;
+			}
+
+			double GetNumber(const char* key, double fallback) const
+			{
+				const JsonValue* value = Find(key);
+				return (value != nullptr && value->type == Type::NUMBER) ? value->number : fallback;
+			}
+
+			bool GetBool(const char* key, bool fallback) const
+			{
+				const JsonValue* value = Find(key);
+				return (value != nullptr && value->type == Type::BOOLEAN) ? value->boolean : fallback;
+			}
+
+			//Empty array for missing members, saves a null check at every use
+			const std::vector<JsonValue>& GetArray(const char* key) const
+			{
+				static const std::vector<JsonValue> empty;
+				const JsonValue* value = Find(key);
+				return (value != nullptr && value->type == Type::ARRAY) ? value->array : empty;
+			}
+		};
+
+		class JsonParser
+		{
+		public:
+			JsonParser(const char* begin, const char* end) : c{ begin }, end{ end } {}
+
+			void Parse(JsonValue& value)
+			{
+				ParseValue(value, 0);
+				SkipSpaces();
+				if (c != end)
+				{
+					Fail();
+				}
+			}
+
+		private:
+			const char* c;
+			const char* end;
+
+			[[noreturn]] void Fail()
+			{
+				throw std::runtime_error("glTF JSON chunk is malformed!");
+			}
+
+			void SkipSpaces()
+			{
+				//The JSON chunk is padded with spaces, so trailing ones are expected
+				while (c < end && (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r'))
+				{
+					c++;
+				}
+			}
+
+			void Expect(char character)
+			{
+				SkipSpaces();
+				if (c >= end || *c != character)
+				{
+					Fail();
+				}
+				c++;
+			}
+
+			bool Match(const char* literal)
+			{
+				const size_t length = strlen(literal);
+				if (static_cast<size_t>(end - c) >= length && memcmp(c, literal, length) == 0)
+				{
+					c += length;
+					return true;
+				}
+				return false;
+			}
+
+			void ParseString(std::string& string)
+			{
+				Expect('"');
+
+				while (c < end && *c != '"')
+				{
+					if (*c != '\\')
+					{
+						string.push_back(*c++);
+						continue;
+					}
+
+					if (++c >= end)
+					{
+						Fail();
+					}
+
+					switch (*c++)
+					{
+						case '"': string.push_back('"'); break;
+						case '\\': string.push_back('\\'); break;
+						case '/': string.push_back('/'); break;
+						case 'b': string.push_back('\b'); break;
+						case 'f': string.push_back('\f'); break;
+						case 'n': string.push_back('\n'); break;
+						case 'r': string.push_back('\r'); break;
+						case 't': string.push_back('\t'); break;
+						case 'u':
+						{
+							//Only ever used in names, so surrogate pairs are just written as two code points
+							uint32_t codePoint = 0;
+							if (end - c < 4 || std::from_chars(c, c + 4, codePoint, 16).ptr != c + 4)
+							{
+								Fail();
+							}
+							c += 4;
+
+							if (codePoint < 0x80)
+							{
+								string.push_back(static_cast<char>(codePoint));
+							}
+							else if (codePoint < 0x800)
+							{
+								string.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+								string.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+							}
+							else
+							{
+								string.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+								string.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+								string.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+							}
+							break;
+						}
+						default: Fail();
+					}
+				}
+
+				Expect('"');
+			}
+
+			void ParseValue(JsonValue& value, uint32_t depth)
+			{
+				if (depth > MAX_DEPTH)
+				{
+					Fail();
+				}
+
+				SkipSpaces();
+				if (c >= end)
+				{
+					Fail();
+				}
+
+				if (*c == '{')
+				{
+					value.type = JsonValue::Type::OBJECT;
+					c++;
+					SkipSpaces();
+					if (c < end && *c == '}')
+					{
+						c++;
+						return;
+					}
+
+					do
+					{
+						value.object.emplace_back();
+						ParseString(value.object.back().first);
+						Expect(':');
+						ParseValue(value.object.back().second, depth + 1);
+						SkipSpaces();
+					} while (c < end && *c == ',' && ++c);
+
+					Expect('}');
+				}
+				else if (*c == '[')
+				{
+					value.type = JsonValue::Type::ARRAY;
+					c++;
+					SkipSpaces();
+					if (c < end && *c == ']')
+					{
+						c++;
+						return;
+					}
+
+					do
+					{
+						value.array.emplace_back();
+						ParseValue(value.array.back(), depth + 1);
+						SkipSpaces();
+					} while (c < end && *c == ',' && ++c);
+
+					Expect(']');
+				}
+				else if (*c == '"')
+				{
+					value.type = JsonValue::Type::STRING;
+					ParseString(value.string);
+				}
+				else if (Match("true"))
+				{
+					value.type = JsonValue::Type::BOOLEAN;
+					value.boolean = true;
+				}
+				else if (Match("false"))
+				{
+					value.type = JsonValue::Type::BOOLEAN;
+				}
+				else if (Match("null"))
+				{
+					value.type = JsonValue::Type::NUL;
+				}
+				else
+				{
+					value.type = JsonValue::Type::NUMBER;
+					//from_chars doesn't take a leading plus, and JSON doesn't allow one anyway
+					const std::from_chars_result result = std::from_chars(c, end, value.number);
+					if (result.ec != std::errc())
+					{
+						Fail();
+					}
+					c = result.ptr;
+				}
+			}
+		};
+
+	#pragma endregion
+
+	#pragma region Accessors
+
+		//Where an accessor's elements are in the binary chunk
+		struct AccessorView
+		{
+			//Null for accessors without a buffer view, which are all zeros
+			const uint8_t* data;
+			size_t count;
+			size_t stride;
+			uint32_t componentType;
+			uint32_t componentCount;
+			bool normalized;
+		};
+
+		uint32_t GetComponentSize(uint32_t componentType)
+		{
+			switch (componentType)
+			{
+				case COMPONENT_BYTE:
+				case COMPONENT_UNSIGNED_BYTE: return 1;
+				case COMPONENT_SHORT:
+				case COMPONENT_UNSIGNED_SHORT: return 2;
+				case COMPONENT_UNSIGNED_INT:
+				case COMPONENT_FLOAT: return 4;
+				default: throw std::runtime_error("glTF accessor has an unknown component type!");
+			}
+		}
+
+		uint32_t GetComponentCount(const std::string& type)
+		{
+			if (type == "SCALAR") return 1;
+			if (type == "VEC2") return 2;
+			if (type == "VEC3") return 3;
+			if (type == "VEC4") return 4;
+			throw std::runtime_error("glTF accessor type " + type + " can't be used for vertices or indices!");
+		}
+
+		AccessorView GetAccessor(const JsonValue& root, size_t index, const uint8_t* bin, size_t binSize)
+		{
+			const std::vector<JsonValue>& accessors = root.GetArray("accessors");
+			if (index >= accessors.size())
+			{
+				throw std::runtime_error("glTF accessor index out of range!");
+			}
+
+			const JsonValue& accessor = accessors[index];
+			if (accessor.Find("sparse") != nullptr)
+			{
+				throw std::runtime_error("Sparse glTF accessors aren't supported!");
+			}
+
+			const JsonValue* type = accessor.Find("type");
+
+			AccessorView view{};
+			view.count = static_cast<size_t>(accessor.GetNumber("count", 0));
+			view.componentType = static_cast<uint32_t>(accessor.GetNumber("componentType", 0));
+			view.componentCount = GetComponentCount(type != nullptr ? type->string : "");
+			view.normalized = accessor.GetBool("normalized", false);
+
+			const size_t elementSize = GetComponentSize(view.componentType) * view.componentCount;
+			view.stride = elementSize;
+
+			if (accessor.Find("bufferView") == nullptr)
+			{
+				return view;
+			}
+
+			const std::vector<JsonValue>& bufferViews = root.GetArray("bufferViews");
+			const size_t bufferViewIndex = static_cast<size_t>(accessor.GetNumber("bufferView", 0));
+			if (bufferViewIndex >= bufferViews.size())
+			{
+				throw std::runtime_error("glTF buffer view index out of range!");
+			}
+
+			const JsonValue& bufferView = bufferViews[bufferViewIndex];
+			//Only the glb's own binary chunk, external .bin files aren't looked up
+			if (bufferView.GetNumber("buffer", 0) != 0 || bin == nullptr)
+			{
+				throw std::runtime_error("glTF buffer view doesn't point into the glb's binary chunk!");
+			}
+
+			const size_t viewOffset = static_cast<size_t>(bufferView.GetNumber("byteOffset", 0));
+			const size_t viewLength = static_cast<size_t>(bufferView.GetNumber("byteLength", 0));
+			const size_t accessorOffset = static_cast<size_t>(accessor.GetNumber("byteOffset", 0));
+			view.stride = static_cast<size_t>(bufferView.GetNumber("byteStride", static_cast<double>(elementSize)));
+
+			if (viewOffset + viewLength > binSize || (view.count > 0 && accessorOffset + view.stride * (view.count - 1) + elementSize > viewLength))
+			{
+				throw std::runtime_error("glTF accessor reads past the end of its buffer view!");
+			}
+
+			view.data = bin + viewOffset + accessorOffset;
+			return view;
+		}
+
+		float ReadComponent(const uint8_t* source, uint32_t componentType, bool normalized)
+		{
+			//Memcpy since strides only guarantee component alignment in well formed files
+			switch (componentType)
+			{
+				case COMPONENT_BYTE: { int8_t v; memcpy(&v, source, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+				case COMPONENT_UNSIGNED_BYTE: { uint8_t v; memcpy(&v, source, 1); return normalized ? v / 255.0f : v; }
+				case COMPONENT_SHORT: { int16_t v; memcpy(&v, source, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+				case COMPONENT_UNSIGNED_SHORT: { uint16_t v; memcpy(&v, source, 2); return normalized ? v / 65535.0f : v; }
+				case COMPONENT_UNSIGNED_INT: { uint32_t v; memcpy(&v, source, 4); return static_cast<float>(v); }
+				default: { float v; memcpy(&v, source, 4); return v; }
+			}
+		}
+
+		//Reads up to componentCount floats of element i, missing components are left alone
+		void ReadFloats(const AccessorView& view, size_t i, float* out, uint32_t componentCount)
+		{
+			if (view.data == nullptr)
+			{
+				return;
+			}
+
+			const uint8_t* element = view.data + view.stride * i;
+			const uint32_t count = std::min(componentCount, view.componentCount);
+
+			if (view.componentType == COMPONENT_FLOAT)
+			{
+				memcpy(out, element, sizeof(float) * count);
+				return;
+			}
+
+			const uint32_t componentSize = GetComponentSize(view.componentType);
+			for (uint32_t c = 0; c < count; c++)
+			{
+				out[c] = ReadComponent(element + componentSize * c, view.componentType, view.normalized);
+			}
+		}
+
+		void ReadIndices(const AccessorView& view, uint32_t baseVertex, std::vector<uint32_t>& indices)
+		{
+			const size_t first = indices.size();
+			indices.resize(first + view.count);
+			uint32_t* out = indices.data() + first;
+
+			if (view.data == nullptr)
+			{
+				std::fill(out, out + view.count, baseVertex);
+				return;
+			}
+
+			//Already what the index buffer wants, one copy and done
+			if (view.componentType == COMPONENT_UNSIGNED_INT && view.stride == sizeof(uint32_t))
+			{
+				memcpy(out, view.data, sizeof(uint32_t) * view.count);
+			}
+			else if (view.componentType == COMPONENT_UNSIGNED_SHORT || view.componentType == COMPONENT_UNSIGNED_BYTE || view.componentType == COMPONENT_UNSIGNED_INT)
+			{
+				for (size_t i = 0; i < view.count; i++)
+				{
+					out[i] = static_cast<uint32_t>(ReadComponent(view.data + view.stride * i, view.componentType, false));
+				}
+			}
+			else
+			{
+				throw std::runtime_error("glTF indices have to be unsigned integers!");
+			}
+
+			if (baseVertex != 0)
+			{
+				for (size_t i = 0; i < view.count; i++)
+				{
+					out[i] += baseVertex;
+				}
+			}
+		}
+
+	#pragma endregion
+
+	#pragma region Primitives
+
+		glm::mat4 GetLocalMatrix(const JsonValue& node)
+		{
+			const std::vector<JsonValue>& matrix = node.GetArray("matrix");
+			if (matrix.size() == 16)
+			{
+				//Column major, same as glm
+				glm::mat4 result(1.0f);
+				for (int i = 0; i < 16; i++)
+				{
+					result[i / 4][i % 4] = static_cast<float>(matrix[i].number);
+				}
+				return result;
+			}
+
+			glm::vec3 translation(0.0f);
+			float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			glm::vec3 scale(1.0f);
+
+			const std::vector<JsonValue>& t = node.GetArray("translation");
+			const std::vector<JsonValue>& r = node.GetArray("rotation");
+			const std::vector<JsonValue>& s = node.GetArray("scale");
+			for (size_t i = 0; i < 3 && i < t.size(); i++) translation[static_cast<int>(i)] = static_cast<float>(t[i].number);
+			for (size_t i = 0; i < 4 && i < r.size(); i++) rotation[i] = static_cast<float>(r[i].number);
+			for (size_t i = 0; i < 3 && i < s.size(); i++) scale[static_cast<int>(i)] = static_cast<float>(s[i].number);
+
+			//Rotation is an xyzw unit quaternion
+			const float x = rotation[0], y = rotation[1], z = rotation[2], w = rotation[3];
+			glm::mat4 result(1.0f);
+			result[0] = glm::vec4(1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0.0f) * scale.x;
+			result[1] = glm::vec4(2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0.0f) * scale.y;
+			result[2] = glm::vec4(2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0.0f) * scale.z;
+			result[3] = glm::vec4(translation, 1.0f);
+			return result;
+		}
+
+		void AppendPrimitive(const JsonValue& root, const JsonValue& primitive, const glm::mat4& world, const uint8_t* bin, size_t binSize, MeshData& data)
+		{
+			if (primitive.GetNumber("mode", MODE_TRIANGLES) != MODE_TRIANGLES)
+			{
+				Helper::Warning("- Skipping glTF primitive that isn't a triangle list");
+				return;
+			}
+
+			const JsonValue* attributes = primitive.Find("attributes");
+			const JsonValue* positionIndex = (attributes != nullptr) ? attributes->Find("POSITION") : nullptr;
+			if (positionIndex == nullptr)
+			{
+				Helper::Warning("- Skipping glTF primitive without positions");
+				return;
+			}
+
+			const AccessorView positions = GetAccessor(root, static_cast<size_t>(positionIndex->number), bin, binSize);
+			AccessorView uvs{};
+			AccessorView normals{};
+			AccessorView tangents{};
+			if (const JsonValue* index = attributes->Find("TEXCOORD_0")) uvs = GetAccessor(root, static_cast<size_t>(index->number), bin, binSize);
+			if (const JsonValue* index = attributes->Find("NORMAL")) normals = GetAccessor(root, static_cast<size_t>(index->number), bin, binSize);
+			if (const JsonValue* index = attributes->Find("TANGENT")) tangents = GetAccessor(root, static_cast<size_t>(index->number), bin, binSize);
+
+			const uint32_t baseVertex = static_cast<uint32_t>(data.vertices.size());
+			const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+			const bool mirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+			data.vertices.resize(baseVertex + positions.count);
+
+			for (size_t i = 0; i < positions.count; i++)
+			{
+				Vertex& vertex = data.vertices[baseVertex + i];
+				vertex = Vertex{};
+
+				ReadFloats(positions, i, &vertex.position.x, 3);
+				ReadFloats(uvs, i, &vertex.UV.x, 2);
+				ReadFloats(normals, i, &vertex.normal.x, 3);
+				//xyzw, w is the handedness
+				ReadFloats(tangents, i, &vertex.tangent.x, 4);
+
+				vertex.position = glm::vec3(world * glm::vec4(vertex.position, 1.0f));
+				if (normals.data != nullptr)
+				{
+					vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+				}
+				if (tangents.data != nullptr)
+				{
+					vertex.tangent = glm::vec4(glm::normalize(glm::mat3(world) * glm::vec3(vertex.tangent)), mirrored ? -vertex.tangent.w : vertex.tangent.w);
+				}
+			}
+
+			Submesh submesh{};
+			submesh.firstIndex = static_cast<uint32_t>(data.indices.size());
+
+			if (const JsonValue* index = primitive.Find("indices"))
+			{
+				ReadIndices(GetAccessor(root, static_cast<size_t>(index->number), bin, binSize), baseVertex, data.indices);
+			}
+			else
+			{
+				//Non indexed primitives draw their vertices in order
+				for (size_t i = 0; i < positions.count; i++)
+				{
+					data.indices.push_back(baseVertex + static_cast<uint32_t>(i));
+				}
+			}
+
+			//Drop any trailing partial triangle
+			data.indices.resize(submesh.firstIndex + (data.indices.size() - submesh.firstIndex) / 3 * 3);
+			submesh.indexCount = static_cast<uint32_t>(data.indices.size()) - submesh.firstIndex;
+
+			for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i++)
+			{
+				if (data.indices[i] >= data.vertices.size())
+				{
+					throw std::runtime_error("glTF primitive has an index past the end of its vertices!");
+				}
+			}
+
+			//Mirroring transforms turn the triangles inside out
+			if (mirrored)
+			{
+				for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i += 3)
+				{
+					std::swap(data.indices[i + 1], data.indices[i + 2]);
+				}
+			}
+
+			//The spec says to use flat normals when there are none, so every corner gets its own copy of its vertex with the triangle's normal
+			//Positions are already in world space and wound counter clockwise, the cross product points out of the front face
+			if (normals.data == nullptr)
+			{
+				std::vector<Vertex> corners(submesh.indexCount);
+				for (uint32_t i = 0; i < submesh.indexCount; i += 3)
+				{
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						corners[i + c] = data.vertices[data.indices[submesh.firstIndex + i + c]];
+					}
+
+					const glm::vec3 faceNormal = glm::cross(corners[i + 1].position - corners[i].position, corners[i + 2].position - corners[i].position);
+					const float length = glm::length(faceNormal);
+					//Degenerate triangles cover no pixels, any unit normal keeps later normalizes from making NaNs
+					const glm::vec3 normal = (length > FLT_EPSILON) ? faceNormal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						corners[i + c].normal = normal;
+					}
+				}
+
+				data.vertices.resize(baseVertex);
+				data.vertices.insert(data.vertices.end(), corners.begin(), corners.end());
+				for (uint32_t i = 0; i < submesh.indexCount; i++)
+				{
+					data.indices[submesh.firstIndex + i] = baseVertex + i;
+				}
+			}
+
+			if (submesh.indexCount > 0)
+			{
+				data.submeshes.push_back(submesh);
+			}
+		}
+
+		void AppendNode(const JsonValue& root, size_t nodeIndex, const glm::mat4& parent, uint32_t depth, const uint8_t* bin, size_t binSize, MeshData& data)
+		{
+			const std::vector<JsonValue>& nodes = root.GetArray("nodes");
+			if (nodeIndex >= nodes.size() || depth > MAX_DEPTH)
+			{
+				throw std::runtime_error("glTF node hierarchy is broken!");
+			}
+
+			const JsonValue& node = nodes[nodeIndex];
+			const glm::mat4 world = parent * GetLocalMatrix(node);
+
+			if (const JsonValue* meshIndex = node.Find("mesh"))
+			{
+				const std::vector<JsonValue>& meshes = root.GetArray("meshes");
+				if (static_cast<size_t>(meshIndex->number) >= meshes.size())
+				{
+					throw std::runtime_error("glTF mesh index out of range!");
+				}
+
+				for (const auto& primitive : meshes[static_cast<size_t>(meshIndex->number)].GetArray("primitives"))
+				{
+					AppendPrimitive(root, primitive, world, bin, binSize, data);
+				}
+			}
+
+			for (const auto& child : node.GetArray("children"))
+			{
+				AppendNode(root, static_cast<size_t>(child.number), world, depth + 1, bin, binSize, data);
+			}
+		}
+
+	#pragma endregion
+}
+
+void GltfImporter::Import(const std::string& path, MeshData& data)
+{
+	MappedFile file(path);
+	const uint8_t* bytes = file.GetData();
+	const size_t size = file.GetSize();
+
+	#pragma region GLB Chunks
+		//12 byte header, then chunks of (length, type, data) padded to 4 bytes
+		uint32_t header[3];
+		if (size < sizeof(header))
+		{
+			throw std::runtime_error(path + " is too small to be a glb!");
+		}
+		memcpy(header, bytes, sizeof(header));
+
+		if (header[0] != GLB_MAGIC || header[1] != GLB_VERSION || header[2] > size)
+		{
+			throw std::runtime_error(path + " isn't a glTF 2.0 binary file!");
+		}
+
+		const char* json = nullptr;
+		size_t jsonSize = 0;
+		const uint8_t* bin = nullptr;
+		size_t binSize = 0;
+
+		for (size_t offset = sizeof(header); offset + 8 <= header[2];)
+		{
+			uint32_t chunk[2];
+			memcpy(chunk, bytes + offset, sizeof(chunk));
+			offset += sizeof(chunk);
+
+			if (chunk[0] > header[2] - offset)
+			{
+				throw std::runtime_error(path + " has a chunk running past the end of the file!");
+			}
+
+			if (chunk[1] == GLB_CHUNK_JSON && json == nullptr)
+			{
+				json = reinterpret_cast<const char*>(bytes + offset);
+				jsonSize = chunk[0];
+			}
+			else if (chunk[1] == GLB_CHUNK_BIN && bin == nullptr)
+			{
+				bin = bytes + offset;
+				binSize = chunk[0];
+			}
+
+			offset += (chunk[0] + 3) & ~3u;
+		}
+
+		if (json == nullptr)
+		{
+			throw std::runtime_error(path + " has no JSON chunk!");
+		}
+	#pragma endregion
+
+	JsonValue root;
+	JsonParser(json, json + jsonSize).Parse(root);
+
+	data.vertices.clear();
+	data.indices.clear();
+	data.submeshes.clear();
+
+	//Default scene's node trees, or every mesh untransformed if the file has no scenes
+	const std::vector<JsonValue>& scenes = root.GetArray("scenes");
+	if (!scenes.empty())
+	{
+		const size_t sceneIndex = static_cast<size_t>(root.GetNumber("scene", 0));
+		if (sceneIndex >= scenes.size())
+		{
+			throw std::runtime_error(path + " has no scene " + std::to_string(sceneIndex) + "!");
+		}
+
+		for (const auto& node : scenes[sceneIndex].GetArray("nodes"))
+		{
+			AppendNode(root, static_cast<size_t>(node.number), glm::mat4(1.0f), 0, bin, binSize, data);
+		}
+	}
+	else
+	{
+		for (const auto& mesh : root.GetArray("meshes"))
+		{
+			for (const auto& primitive : mesh.GetArray("primitives"))
+			{
+				AppendPrimitive(root, primitive, glm::mat4(1.0f), bin, binSize, data);
+			}
+		}
+	}
+
+	if (data.indices.empty())
+	{
+		throw std::runtime_error(path + " has no triangles!");
+	}
+
+	Helper::Cout("- Parsed " + std::to_string(data.vertices.size()) + " vertices, " + std::to_string(data.indices.size() / 3) + " triangles, "
+		+ std::to_string(data.submeshes.size()) + " primitives");
+}
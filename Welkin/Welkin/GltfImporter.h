@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+#include "MeshCache.h"
+
+//Binary glTF 2.0 (.glb) importer
+//The file is memory mapped and accessors are read straight out of the binary chunk, tightly packed float and uint32 data is copied without converting
+//https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html
+namespace GltfImporter
+{
+	//Fills vertices, indices and submeshes (one per triangle primitive), throws if the file isn't a glb this can read
+	//Node transforms of the default scene are baked into the vertices, so every primitive ends up in the same model space
+	void Import(const std::string& path, MeshData& data);
+};
@@ -8,20 +8,77 @@
 namespace Welkin_Settings
 {
 	static const unsigned int MAX_OBJECTS = 2048;
+	//Import textures into BC compressed KTX2 files and upload those instead of the source pngs
+	static const bool USE_COMPRESSED_TEXTURES = true;
+	static const unsigned int TEXTURE_STREAMING_THREADS = 2;
+	//Bytes of texture data the streamer submits per frame
+	static const unsigned long long TEXTURE_UPLOAD_BUDGET_PER_FRAME = 64ull * 1024 * 1024;
+	//Streamed textures start at the largest mip that fits this, finer mips come in once something needs them
+	static const unsigned int TEXTURE_INITIAL_MAX_SIZE = 256;
+	static const unsigned int TEXTURE_MIP_CHANGES_PER_FRAME = 4;
+	//Fixed texture memory budget in bytes, 0 sizes it from VK_EXT_memory_budget
+	static const unsigned long long TEXTURE_MEMORY_BUDGET = 0;
+	static const float TEXTURE_MEMORY_BUDGET_FRACTION = 0.5f;
+	//Used when the device doesn't have VK_EXT_memory_budget
+	static const unsigned long long TEXTURE_MEMORY_BUDGET_FALLBACK = 512ull * 1024 * 1024;
+	//Import meshes with quantized 20 byte vertices instead of 44 byte ones
+	static const bool USE_COMPACT_VERTICES = true;
+	//Import meshes with 16 bit indices, splitting any submesh that uses more than 65536 vertices
+	static const bool USE_16_BIT_INDICES = true;
+	//Write mesh caches with MeshCodec compressed vertices and indices, decoded on worker threads straight into the staging buffers
+	//Caches written either way can still be read
+	static const bool USE_COMPRESSED_MESHES = true;
+	//Levels of detail built per mesh at import, including the full mesh
+	static const unsigned int MESH_LOD_COUNT = 5;
+	//A LOD is used once its error covers fewer pixels than this
+	static const float MESH_LOD_ERROR_PIXELS = 1.0f;
+	//Going to a coarser LOD needs the error this much under the threshold, stops objects flicking between LODs at the boundary
+	static const float MESH_LOD_HYSTERESIS = 0.25f;
+	//LODs with at least this many triangles are split into meshlets and culled per meshlet on the GPU
+	static const unsigned int MESHLET_MIN_TRIANGLES = 8192;
+	//Indirect draws the meshlet culling pass can write per frame, objects past this are drawn whole
+	static const unsigned int MESHLET_MAX_DRAWS = 65536;
+	//Lay down depth with position only pipelines before shading, so each pixel is only shaded once
+	static const bool USE_DEPTH_PREPASS = true;
+	//World space size of the grid cells static objects are batched by, each cell is culled on its own
+	static const float STATIC_BATCH_CELL_SIZE = 32.0f;
+	//Objects whose bounding sphere covers fewer pixels than this radius are drawn as a baked impostor quad instead of their mesh
+	static const bool USE_IMPOSTORS = true;
+	static const float IMPOSTOR_MAX_PIXELS = 48.0f;
+	//Impostor atlases hold IMPOSTOR_FRAMES x IMPOSTOR_FRAMES views of IMPOSTOR_FRAME_SIZE pixels each, one atlas per mesh and material pair
+	static const unsigned int IMPOSTOR_FRAMES = 8;
+	static const unsigned int IMPOSTOR_FRAME_SIZE = 128;
+	static const unsigned int IMPOSTOR_MAX_ATLASES = 64;
+	//World matrices for the shaders are built by a compute pass from each transform's position, rotation and scale instead of uploaded per object
+	//Culling still reads TransformSystem's CPU matrices, this only moves the per object matrix upload
+	static const bool USE_GPU_TRANSFORMS = false;
+	//Job system workers, 0 is one per core minus the main thread's
+	static const unsigned int JOB_WORKER_COUNT = 0;
+	static const bool PIN_JOB_THREADS = false;
+	//The main thread runs jobs while it waits on them instead of sleeping
+	static const bool JOB_MAIN_THREAD_HELPS = true;
+	//Simulation runs in fixed steps of this many milliseconds, the renderer blends between the last two
+	static const float SIMULATION_STEP_MS = 1000.0f / 60.0f;
+	//Draws on its own thread so waiting on fences and presenting never holds up the simulation, off draws after each simulation update on the main thread
+	static const bool USE_RENDER_THREAD = true;
 };
 
 namespace Welkin_BufferStructs
 {
+	//World matrix without its constant bottom row, one vec4 per row, 48 bytes instead of two mat4s
+	//Shaders rebuild the normal matrix from it
 	struct PerTransformStruct
 	{
-		alignas(16) glm::mat4 world;
-		alignas(16) glm::mat4 worldInverseTranspose;
+		alignas(16) glm::vec4 worldRows[3];
 	};
 
 	struct PushConstant
 	{
 		alignas(4) unsigned int instanceID;
 		alignas(4) unsigned int materialID;
+		//Dequantizes COMPACT vertex positions, w is unused
+		alignas(16) glm::vec4 positionScale;
+		alignas(16) glm::vec4 positionOffset;
 	};
 };
 
@@ -0,0 +1,752 @@
+#include "ImpostorRenderer.h"
+
+namespace
+{
+	const VkFormat IMPOSTOR_ATLAS_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+	//Full sphere octahedral mapping of the baked view directions, Impostor.vert has the same functions
+	//https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+	glm::vec3 DecodeOctahedral(glm::vec2 encoded)
+	{
+		glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+
+		const float t = std::max(-direction.z, 0.0f);
+		direction.x += (direction.x >= 0.0f) ? -t : t;
+		direction.y += (direction.y >= 0.0f) ? -t : t;
+
+		return glm::normalize(direction);
+	}
+
+	//Direction from the mesh to the camera that frame (x, y) was baked from
+	glm::vec3 GetFrameDirection(uint32_t x, uint32_t y)
+	{
+		const float frames = static_cast<float>(Welkin_Settings::IMPOSTOR_FRAMES);
+		return DecodeOctahedral(glm::vec2((x + 0.5f) / frames, (y + 0.5f) / frames) * 2.0f - glm::vec2(1.0f));
+	}
+}
+
+ImpostorRenderer::ImpostorRenderer(VulkanCore* vCore, FileManager* fm, VkRenderPass renderPass) : vCore{ vCore }, fm{ fm }
+{
+	device = vCore->GetLogicalDevice();
+
+	if (!Welkin_Settings::USE_IMPOSTORS)
+	{
+		return;
+	}
+
+	if (fm->TryFindShaderModule("(C)ImpostorVert.spv") == nullptr || fm->TryFindShaderModule("(C)ImpostorFrag.spv") == nullptr
+		|| fm->TryFindShaderModule("(C)ImpostorBakeVert.spv") == nullptr || fm->TryFindShaderModule("(C)ImpostorBakeFrag.spv") == nullptr)
+	{
+		Helper::Warning("Impostor shaders not found, far away objects are drawn as meshes");
+		return;
+	}
+
+	Helper::Cout("Creating Impostor Renderer");
+	enabled = true;
+
+	atlases.reserve(Welkin_Settings::IMPOSTOR_MAX_ATLASES);
+
+	CreateFrameBuffers();
+	CreateDescriptorSetLayouts();
+	CreateDescriptorPools();
+	CreateDescriptorSets();
+	CreateSampler();
+	CreateBakeRenderPass();
+	CreateBakeDepthImage();
+	CreatePipelines(renderPass);
+}
+
+ImpostorRenderer::~ImpostorRenderer()
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	for (auto& atlas : atlases)
+	{
+		vkDestroyImageView(*device, atlas.albedoView, nullptr);
+		vkDestroyImage(*device, atlas.albedoImage, nullptr);
+		vkFreeMemory(*device, atlas.albedoMemory, nullptr);
+		vkDestroyImageView(*device, atlas.normalView, nullptr);
+		vkDestroyImage(*device, atlas.normalImage, nullptr);
+		vkFreeMemory(*device, atlas.normalMemory, nullptr);
+	}
+
+	vkDestroyPipeline(*device, pipeline, nullptr);
+	vkDestroyPipeline(*device, bakePipelines[0], nullptr);
+	vkDestroyPipeline(*device, bakePipelines[1], nullptr);
+	vkDestroyPipelineLayout(*device, pipelineLayout, nullptr);
+	vkDestroyPipelineLayout(*device, bakePipelineLayout, nullptr);
+
+	vkDestroyImageView(*device, bakeDepthView, nullptr);
+	vkDestroyImage(*device, bakeDepthImage, nullptr);
+	vkFreeMemory(*device, bakeDepthMemory, nullptr);
+	vkDestroyRenderPass(*device, bakeRenderPass, nullptr);
+
+	vkDestroySampler(*device, atlasSampler, nullptr);
+	vkDestroyDescriptorPool(*device, descriptorPool, nullptr);
+	vkDestroyDescriptorPool(*device, bakeDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(*device, instanceDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(*device, atlasDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(*device, bakeDescriptorSetLayout, nullptr);
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		vkDestroyBuffer(*device, instanceBuffers[i], nullptr);
+		vkFreeMemory(*device, instanceBufferMemory[i], nullptr);
+	}
+}
+
+#pragma region Setup
+
+void ImpostorRenderer::CreateFrameBuffers()
+{
+	instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	instanceBufferMemory.resize(MAX_FRAMES_IN_FLIGHT);
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		vCore->CreateBuffer(sizeof(ImpostorInstance) * Welkin_Settings::MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i], instanceBufferMemory[i]);
+	}
+}
+
+void ImpostorRenderer::CreateDescriptorSetLayouts()
+{
+	VkDescriptorSetLayoutBinding instanceBinding{};
+	instanceBinding.binding = 0;
+	instanceBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instanceBinding.descriptorCount = 1;
+	instanceBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &instanceBinding;
+
+	if (vkCreateDescriptorSetLayout(*device, &layoutInfo, nullptr, &instanceDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor instance descriptor set layout!");
+	}
+
+	//Albedo, then normal with the depth in alpha
+	VkDescriptorSetLayoutBinding atlasBindings[2]{};
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		atlasBindings[i].binding = i;
+		atlasBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		atlasBindings[i].descriptorCount = 1;
+		atlasBindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = atlasBindings;
+
+	if (vkCreateDescriptorSetLayout(*device, &layoutInfo, nullptr, &atlasDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor atlas descriptor set layout!");
+	}
+
+	//Material texture the bake samples
+	VkDescriptorSetLayoutBinding bakeBinding{};
+	bakeBinding.binding = 0;
+	bakeBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bakeBinding.descriptorCount = 1;
+	bakeBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &bakeBinding;
+
+	if (vkCreateDescriptorSetLayout(*device, &layoutInfo, nullptr, &bakeDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor bake descriptor set layout!");
+	}
+}
+
+void ImpostorRenderer::CreateDescriptorPools()
+{
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = Welkin_Settings::IMPOSTOR_MAX_ATLASES * 2;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) + Welkin_Settings::IMPOSTOR_MAX_ATLASES;
+
+	if (vkCreateDescriptorPool(*device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor descriptor pool!");
+	}
+
+	VkDescriptorPoolSize bakePoolSize{};
+	bakePoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bakePoolSize.descriptorCount = 1;
+
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &bakePoolSize;
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(*device, &poolInfo, nullptr, &bakeDescriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor bake descriptor pool!");
+	}
+}
+
+void ImpostorRenderer::CreateDescriptorSets()
+{
+	std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, instanceDescriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	allocInfo.pSetLayouts = layouts.data();
+
+	instanceDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	if (vkAllocateDescriptorSets(*device, &allocInfo, instanceDescriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate impostor instance descriptor sets!");
+	}
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = instanceBuffers[i];
+		bufferInfo.offset = 0;
+		bufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = instanceDescriptorSets[i];
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(*device, 1, &descriptorWrite, 0, nullptr);
+	}
+}
+
+void ImpostorRenderer::CreateSampler()
+{
+	//Atlases have no mips, the frames are only ever drawn at about their baked size
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	//Frames sit next to each other, so sampling has to stay inside the atlas edges at least
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(*device, &samplerInfo, nullptr, &atlasSampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor atlas sampler!");
+	}
+}
+
+void ImpostorRenderer::CreateBakeRenderPass()
+{
+	//Albedo and normal, left ready to be sampled
+	VkAttachmentDescription attachments[3]{};
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		attachments[i].format = IMPOSTOR_ATLAS_FORMAT;
+		attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	attachments[2].format = vCore->GetDepthFormat();
+	attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[2].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRefs[2]{};
+	colorAttachmentRefs[0].attachment = 0;
+	colorAttachmentRefs[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentRefs[1].attachment = 1;
+	colorAttachmentRefs[1].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 2;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 2;
+	subpass.pColorAttachments = colorAttachmentRefs;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	//The atlases are read by the impostor fragment shader afterwards
+	VkSubpassDependency dependency{};
+	dependency.srcSubpass = 0;
+	dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 3;
+	renderPassInfo.pAttachments = attachments;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies = &dependency;
+
+	if (vkCreateRenderPass(*device, &renderPassInfo, nullptr, &bakeRenderPass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor bake render pass!");
+	}
+}
+
+void ImpostorRenderer::CreateBakeDepthImage()
+{
+	const uint32_t atlasSize = Welkin_Settings::IMPOSTOR_FRAMES * Welkin_Settings::IMPOSTOR_FRAME_SIZE;
+
+	vCore->CreateImage(atlasSize, atlasSize, vCore->GetDepthFormat(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bakeDepthImage, bakeDepthMemory);
+	bakeDepthView = vCore->CreateImageView(bakeDepthImage, vCore->GetDepthFormat(), 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+}
+
+void ImpostorRenderer::CreatePipelines(VkRenderPass renderPass)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ImpostorPushConstant);
+
+	const VkDescriptorSetLayout setLayouts[] = { instanceDescriptorSetLayout, atlasDescriptorSetLayout };
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor pipeline layout!");
+	}
+
+	pushConstantRange.size = sizeof(ImpostorBakePushConstant);
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &bakeDescriptorSetLayout;
+
+	if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &bakePipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor bake pipeline layout!");
+	}
+
+	pipeline = CreateGraphicsPipeline(fm->FindShaderModule("(C)ImpostorVert.spv"), fm->FindShaderModule("(C)ImpostorFrag.spv"), pipelineLayout, renderPass, false, VertexFormat::STANDARD);
+
+	//One bake shader reads both vertex formats, only the vertex input differs
+	for (VertexFormat format : { VertexFormat::STANDARD, VertexFormat::COMPACT })
+	{
+		bakePipelines[static_cast<int>(format)] = CreateGraphicsPipeline(fm->FindShaderModule("(C)ImpostorBakeVert.spv"), fm->FindShaderModule("(C)ImpostorBakeFrag.spv"), bakePipelineLayout, bakeRenderPass, true, format);
+	}
+}
+
+VkPipeline ImpostorRenderer::CreateGraphicsPipeline(VkShaderModule* vertShaderModule, VkShaderModule* fragShaderModule, VkPipelineLayout layout, VkRenderPass renderPass, bool bake, VertexFormat format)
+{
+	VkPipelineShaderStageCreateInfo shaderStages[2]{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = *vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = *fragShaderModule;
+	shaderStages[1].pName = "main";
+
+	//Impostor quads are made from gl_VertexIndex, the bake reads both of the mesh's vertex streams
+	auto bindingDescriptions = Vertex::getBindingDescriptions(format);
+	auto attributeDescriptions = Vertex::getAttributeDescriptions(format);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = bake ? static_cast<uint32_t>(bindingDescriptions.size()) : 0;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = bake ? static_cast<uint32_t>(attributeDescriptions.size()) : 0;
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	//Quads are seen from both sides. The bake projection isn't Y flipped like Camera's, so front faces wind the other way on screen
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = bake ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
+	rasterizer.frontFace = bake ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	//Impostors aren't in the depth prepass, so they write their own depth
+	VkPipelineDepthStencilStateCreateInfo depthInfo{};
+	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthInfo.depthTestEnable = VK_TRUE;
+	depthInfo.depthWriteEnable = VK_TRUE;
+	depthInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthInfo.depthBoundsTestEnable = VK_FALSE;
+	depthInfo.stencilTestEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachments[2]{};
+	for (auto& colorBlendAttachment : colorBlendAttachments)
+	{
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.blendEnable = VK_FALSE;
+	}
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = bake ? 2 : 1;
+	colorBlending.pAttachments = colorBlendAttachments;
+
+	//The bake moves the viewport to each frame of the atlas
+	std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthInfo;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = layout;
+	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.subpass = 0;
+
+	VkPipeline newPipeline;
+	if (vkCreateGraphicsPipelines(*device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create impostor pipeline!");
+	}
+
+	return newPipeline;
+}
+
+#pragma endregion
+
+#pragma region Baking
+
+void ImpostorRenderer::BakePending()
+{
+	for (size_t i = 0; i < pendingBakes.size();)
+	{
+		Mesh* mesh = pendingBakes[i].first;
+		Material* material = pendingBakes[i].second;
+
+		//Baking the streaming placeholder would keep its flat color forever
+		if (material->GetTexture() != nullptr && !material->GetTexture()->IsResident())
+		{
+			i++;
+			continue;
+		}
+
+		atlases.emplace_back();
+		Bake(mesh, material, atlases.back());
+		atlasIndices[pendingBakes[i]] = static_cast<int32_t>(atlases.size()) - 1;
+
+		pendingBakes.erase(pendingBakes.begin() + i);
+	}
+}
+
+void ImpostorRenderer::Bake(Mesh* mesh, Material* material, ImpostorAtlas& atlas)
+{
+	const uint32_t frameSize = Welkin_Settings::IMPOSTOR_FRAME_SIZE;
+	const uint32_t atlasSize = Welkin_Settings::IMPOSTOR_FRAMES * frameSize;
+
+	#pragma region Atlas Images
+		vCore->CreateImage(atlasSize, atlasSize, IMPOSTOR_ATLAS_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, atlas.albedoImage, atlas.albedoMemory);
+		atlas.albedoView = vCore->CreateImageView(atlas.albedoImage, IMPOSTOR_ATLAS_FORMAT);
+
+		vCore->CreateImage(atlasSize, atlasSize, IMPOSTOR_ATLAS_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, atlas.normalImage, atlas.normalMemory);
+		atlas.normalView = vCore->CreateImageView(atlas.normalImage, IMPOSTOR_ATLAS_FORMAT);
+
+		const VkImageView attachments[] = { atlas.albedoView, atlas.normalView, bakeDepthView };
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = bakeRenderPass;
+		framebufferInfo.attachmentCount = 3;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = atlasSize;
+		framebufferInfo.height = atlasSize;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer;
+		if (vkCreateFramebuffer(*device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create impostor bake framebuffer!");
+		}
+	#pragma endregion
+
+	#pragma region Descriptor Sets
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = 1;
+
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.pSetLayouts = &atlasDescriptorSetLayout;
+		if (vkAllocateDescriptorSets(*device, &allocInfo, &atlas.descriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate impostor atlas descriptor set!");
+		}
+
+		VkDescriptorSet bakeDescriptorSet;
+		allocInfo.descriptorPool = bakeDescriptorPool;
+		allocInfo.pSetLayouts = &bakeDescriptorSetLayout;
+		if (vkAllocateDescriptorSets(*device, &allocInfo, &bakeDescriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate impostor bake descriptor set!");
+		}
+
+		//Atlas albedo, atlas normal, then the material texture for the bake
+		VkDescriptorImageInfo imageInfos[3]{};
+		imageInfos[0].imageView = atlas.albedoView;
+		imageInfos[0].sampler = atlasSampler;
+		imageInfos[1].imageView = atlas.normalView;
+		imageInfos[1].sampler = atlasSampler;
+		imageInfos[2].imageView = (material->GetTexture() != nullptr) ? *material->GetTexture()->GetTextureImageView() : *fm->GetTextureStreamer()->GetPlaceholder()->GetTextureImageView();
+		imageInfos[2].sampler = *material->GetSampler();
+
+		VkWriteDescriptorSet descriptorWrites[3]{};
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = (i < 2) ? atlas.descriptorSet : bakeDescriptorSet;
+			descriptorWrites[i].dstBinding = (i < 2) ? i : 0;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrites[i].descriptorCount = 1;
+			descriptorWrites[i].pImageInfo = &imageInfos[i];
+		}
+
+		vkUpdateDescriptorSets(*device, 3, descriptorWrites, 0, nullptr);
+	#pragma endregion
+
+	#pragma region Recording
+		VkCommandBuffer commandBuffer = vCore->BeginSingleTimeCommands(*vCore->GetCommandPool(0));
+
+		//Transparent black, the impostor shader discards anything with no coverage
+		VkClearValue clearValues[3]{};
+		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 0.0f} };
+		clearValues[1].color = { {0.0f, 0.0f, 0.0f, 0.0f} };
+		clearValues[2].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = bakeRenderPass;
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = { atlasSize, atlasSize };
+		renderPassInfo.clearValueCount = 3;
+		renderPassInfo.pClearValues = clearValues;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bakePipelines[static_cast<int>(mesh->GetVertexFormat())]);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bakePipelineLayout, 0, 1, &bakeDescriptorSet, 0, nullptr);
+
+		const VkBuffer vertexBuffers[] = { *mesh->GetVertexBuffer(), *mesh->GetVertexBuffer() };
+		const VkDeviceSize offsets[] = { 0, mesh->GetAttributeStreamOffset() };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, *mesh->GetIndexBuffer(), 0, mesh->GetIndexType());
+
+		ImpostorBakePushConstant push{};
+		push.positionScale = glm::vec4(mesh->GetPositionScale(), 0.0f);
+		push.positionOffset = glm::vec4(mesh->GetPositionOffset(), 0.0f);
+		push.compact = (mesh->GetVertexFormat() == VertexFormat::COMPACT) ? 1 : 0;
+
+		//Orthographic box around the bounding sphere, depth 0 to 1 runs from the near side of the sphere to the far side
+		const glm::vec3 center = mesh->GetBoundsCenter();
+		const float radius = std::max(mesh->GetBoundsRadius(), 0.001f);
+		const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, radius * 2.0f);
+
+		for (uint32_t y = 0; y < Welkin_Settings::IMPOSTOR_FRAMES; y++)
+		{
+			for (uint32_t x = 0; x < Welkin_Settings::IMPOSTOR_FRAMES; x++)
+			{
+				VkViewport viewport{};
+				viewport.x = static_cast<float>(x * frameSize);
+				viewport.y = static_cast<float>(y * frameSize);
+				viewport.width = static_cast<float>(frameSize);
+				viewport.height = static_cast<float>(frameSize);
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+				VkRect2D scissor{};
+				scissor.offset = { static_cast<int32_t>(x * frameSize), static_cast<int32_t>(y * frameSize) };
+				scissor.extent = { frameSize, frameSize };
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+				//Up is picked the same way in Impostor.vert, so the quad lines up with the frame
+				const glm::vec3 direction = GetFrameDirection(x, y);
+				const glm::vec3 up = (std::abs(direction.y) > 0.999f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				push.viewProjection = projection * glm::lookAt(center + direction * radius, center, up);
+				vkCmdPushConstants(commandBuffer, bakePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ImpostorBakePushConstant), &push);
+
+				const MeshLod& lod = mesh->GetLods()[0];
+				for (uint32_t s = lod.firstSubmesh; s < lod.firstSubmesh + lod.submeshCount; s++)
+				{
+					const Submesh& submesh = mesh->GetSubmeshes()[s];
+					vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, static_cast<int32_t>(submesh.vertexOffset), 0);
+				}
+			}
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+		vCore->EndSingleTimeCommands(commandBuffer, *vCore->GetQueue(0), *vCore->GetCommandPool(0));
+	#pragma endregion
+
+	vkFreeDescriptorSets(*device, bakeDescriptorPool, 1, &bakeDescriptorSet);
+	vkDestroyFramebuffer(*device, framebuffer, nullptr);
+
+	Helper::Cout("- Baked Impostor Atlas, " + std::to_string(Welkin_Settings::IMPOSTOR_FRAMES * Welkin_Settings::IMPOSTOR_FRAMES) + " Views");
+}
+
+#pragma endregion
+
+void ImpostorRenderer::BeginFrame()
+{
+	for (auto& atlas : atlases)
+	{
+		atlas.instances.clear();
+	}
+	instanceCount = 0;
+}
+
+bool ImpostorRenderer::AddInstance(Mesh* mesh, Material* material, const glm::mat4& world)
+{
+	const auto key = std::make_pair(mesh, material);
+	auto found = atlasIndices.find(key);
+
+	if (found == atlasIndices.end())
+	{
+		if (atlasIndices.size() < Welkin_Settings::IMPOSTOR_MAX_ATLASES)
+		{
+			atlasIndices[key] = -1;
+			pendingBakes.push_back(key);
+		}
+		return false;
+	}
+
+	if (found->second < 0 || instanceCount >= Welkin_Settings::MAX_OBJECTS)
+	{
+		return false;
+	}
+
+	ImpostorInstance instance{};
+	instance.center = glm::vec4(glm::vec3(world * glm::vec4(mesh->GetBoundsCenter(), 1.0f)), mesh->GetBoundsRadius());
+	instance.axes[0] = world[0];
+	instance.axes[1] = world[1];
+	instance.axes[2] = world[2];
+
+	atlases[found->second].instances.push_back(instance);
+	instanceCount++;
+	return true;
+}
+
+void ImpostorRenderer::UpdateInstanceBuffer(unsigned short currentFrame)
+{
+	void* data;
+	vkMapMemory(*device, instanceBufferMemory[currentFrame], 0, sizeof(ImpostorInstance) * Welkin_Settings::MAX_OBJECTS, 0, &data);
+
+	//Each atlas's instances end up in one run, drawn with firstInstance
+	uint32_t firstInstance = 0;
+	for (auto& atlas : atlases)
+	{
+		atlas.firstInstance = firstInstance;
+		memcpy(static_cast<ImpostorInstance*>(data) + firstInstance, atlas.instances.data(), sizeof(ImpostorInstance) * atlas.instances.size());
+		firstInstance += static_cast<uint32_t>(atlas.instances.size());
+	}
+
+	vkUnmapMemory(*device, instanceBufferMemory[currentFrame]);
+}
+
+void ImpostorRenderer::RecordDraw(VkCommandBuffer commandBuffer, unsigned short currentFrame, const glm::mat4& viewProjection, glm::vec3 cameraPosition)
+{
+	if (instanceCount == 0)
+	{
+		return;
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &instanceDescriptorSets[currentFrame], 0, nullptr);
+
+	ImpostorPushConstant push{};
+	push.viewProjection = viewProjection;
+	push.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+	push.framesPerSide = Welkin_Settings::IMPOSTOR_FRAMES;
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ImpostorPushConstant), &push);
+
+	for (auto& atlas : atlases)
+	{
+		if (atlas.instances.empty())
+		{
+			continue;
+		}
+
+		//Two triangles per instance
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &atlas.descriptorSet, 0, nullptr);
+		vkCmdDraw(commandBuffer, 6, static_cast<uint32_t>(atlas.instances.size()), 0, atlas.firstInstance);
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include "VulkanCore.h"
+#include "FileManager.h"
+#include "Helper.h"
+
+//One far away object, laid out to match the std430 struct in Impostor.vert
+struct ImpostorInstance
+{
+	//Mesh bounds center in world space, w is the mesh's bounding radius in model space
+	alignas(16) glm::vec4 center;
+	//Columns of the object's world matrix without the translation
+	alignas(16) glm::vec4 axes[3];
+};
+
+struct ImpostorPushConstant
+{
+	alignas(16) glm::mat4 viewProjection;
+	alignas(16) glm::vec4 cameraPosition;
+	alignas(4) uint32_t framesPerSide;
+};
+
+struct ImpostorBakePushConstant
+{
+	alignas(16) glm::mat4 viewProjection;
+	//Same as in Welkin_BufferStructs::PushConstant
+	alignas(16) glm::vec4 positionScale;
+	alignas(16) glm::vec4 positionOffset;
+	alignas(4) uint32_t compact;
+};
+
+//Baked views of one mesh and material pair
+struct ImpostorAtlas
+{
+	//rgb is the texture color, a is coverage
+	VkImage albedoImage;
+	VkDeviceMemory albedoMemory;
+	VkImageView albedoView;
+	//rgb is the model space normal, a is the depth along the view direction, 0 nearest
+	VkImage normalImage;
+	VkDeviceMemory normalMemory;
+	VkImageView normalView;
+	VkDescriptorSet descriptorSet;
+
+	//Filled by culling, drawn as one instanced quad
+	std::vector<ImpostorInstance> instances;
+	uint32_t firstInstance;
+};
+
+//Renders far away objects as one camera facing quad each, textured from an octahedral atlas of views baked from the real mesh
+//The quad picks the baked view closest to the direction it is seen from, and writes the baked depth so it still intersects the scene properly
+class ImpostorRenderer
+{
+public:
+	ImpostorRenderer(VulkanCore* vCore, FileManager* fm, VkRenderPass renderPass);
+	~ImpostorRenderer();
+
+	//False when USE_IMPOSTORS is off or the impostor shaders weren't compiled
+	bool IsEnabled() { return this->enabled; };
+
+	//Bakes the pairs AddInstance asked for, once their textures are resident. Waits for the graphics queue, so it has to be called before recording
+	void BakePending();
+
+	//Clears last frame's instances
+	void BeginFrame();
+	//Returns false when the pair has no atlas yet, the object is then drawn as its mesh. The first call for a pair queues its bake
+	bool AddInstance(Mesh* mesh, Material* material, const glm::mat4& world);
+	void UpdateInstanceBuffer(unsigned short currentFrame);
+
+	//Inside the main render pass, one instanced draw per atlas
+	void RecordDraw(VkCommandBuffer commandBuffer, unsigned short currentFrame, const glm::mat4& viewProjection, glm::vec3 cameraPosition);
+
+private:
+	VulkanCore* vCore;
+	VkDevice* device;
+	FileManager* fm;
+	bool enabled = false;
+	uint32_t instanceCount = 0;
+
+	//-1 while the pair waits for its bake
+	std::map<std::pair<Mesh*, Material*>, int32_t> atlasIndices;
+	std::vector<std::pair<Mesh*, Material*>> pendingBakes;
+	std::vector<ImpostorAtlas> atlases;
+
+	//Per frame in flight
+	std::vector<VkBuffer> instanceBuffers;
+	std::vector<VkDeviceMemory> instanceBufferMemory;
+	std::vector<VkDescriptorSet> instanceDescriptorSets;
+
+	VkSampler atlasSampler;
+	VkDescriptorSetLayout instanceDescriptorSetLayout;
+	VkDescriptorSetLayout atlasDescriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+
+	#pragma region Baking
+		//Every atlas is baked with the same render pass, framebuffer attachments are made per atlas
+		VkRenderPass bakeRenderPass;
+		VkImage bakeDepthImage;
+		VkDeviceMemory bakeDepthMemory;
+		VkImageView bakeDepthView;
+		VkDescriptorSetLayout bakeDescriptorSetLayout;
+		//Freed after every bake
+		VkDescriptorPool bakeDescriptorPool;
+		VkPipelineLayout bakePipelineLayout;
+		//Indexed by VertexFormat
+		VkPipeline bakePipelines[2];
+
+		void Bake(Mesh* mesh, Material* material, ImpostorAtlas& atlas);
+	#pragma endregion
+
+	void CreateFrameBuffers();
+	void CreateDescriptorSetLayouts();
+	void CreateDescriptorPools();
+	void CreateDescriptorSets();
+	void CreateSampler();
+	void CreateBakeRenderPass();
+	void CreateBakeDepthImage();
+	void CreatePipelines(VkRenderPass renderPass);
+	VkPipeline CreateGraphicsPipeline(VkShaderModule* vertShaderModule, VkShaderModule* fragShaderModule, VkPipelineLayout layout, VkRenderPass renderPass, bool bake, VertexFormat format);
+};
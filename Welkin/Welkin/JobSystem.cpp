@@ -0,0 +1,336 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include "Helper.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+namespace
+{
+	//Set on each worker thread, so Run and Wait know whose deque to use
+	thread_local JobSystem* workerSystem = nullptr;
+	thread_local uint32_t workerIndex = 0;
+
+	void PinThread(std::thread& thread, uint32_t core)
+	{
+#ifdef _WIN32
+		SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << core);
+#elif defined(__linux__)
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(core, &cpuSet);
+		pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet);
+#endif
+	}
+}
+
+JobSystem::JobSystem(uint32_t workerCount, bool pinThreads, bool mainThreadHelps) : mainThreadHelps{ mainThreadHelps }, stopping{ false }
+{
+	const uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+	if (workerCount == 0)
+	{
+		workerCount = coreCount - 1;
+	}
+	//Nothing would run the jobs otherwise
+	if (workerCount == 0 && !mainThreadHelps)
+	{
+		workerCount = 1;
+	}
+
+	queues = std::vector<WorkerQueue>(workerCount + 1);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+		//Core 0 is left to the main thread
+		if (pinThreads && workerCount < coreCount)
+		{
+			PinThread(workers.back(), i + 1);
+		}
+	}
+
+	Helper::Cout("Job system started with " + std::to_string(workerCount) + " workers");
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+#pragma region Jobs
+void JobSystem::Run(const std::function<void()>& function, JobCounter* counter)
+{
+	if (counter != nullptr)
+	{
+		counter->count++;
+	}
+	Push(Job{ function, counter });
+}
+
+void JobSystem::RunAfter(JobCounter* dependency, const std::function<void()>& function, JobCounter* counter)
+{
+	if (counter != nullptr)
+	{
+		counter->count++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(dependency->continuationMutex);
+		if (dependency->count.load() != 0)
+		{
+			dependency->continuations.push_back(Job{ function, counter });
+			return;
+		}
+	}
+	Push(Job{ function, counter });
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	const uint32_t queueIndex = CurrentQueue();
+	const bool helps = mainThreadHelps || queueIndex != workers.size();
+
+	while (counter->count.load() != 0)
+	{
+		if (helps)
+		{
+			if (!TryRunOne(queueIndex))
+			{
+				std::this_thread::yield();
+			}
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			doneCondition.wait(lock, [counter]() { return counter->count.load() == 0; });
+		}
+	}
+
+	//The job that reached zero may still be inside Finish, the counter can't go away before it leaves
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(counter->continuationMutex);
+		error = counter->error;
+		counter->error = nullptr;
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::ParallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& work, uint32_t grainSize)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	//A few ranges per thread, so a thread that finishes early has something left to steal
+	if (grainSize == 0)
+	{
+		grainSize = std::max(1u, count / (GetThreadCount() * 4));
+	}
+
+	JobCounter counter;
+	std::function<void(uint32_t, uint32_t)> split = [&](uint32_t begin, uint32_t end)
+	{
+		while (end - begin > grainSize)
+		{
+			const uint32_t middle = begin + (end - begin) / 2;
+			Run([&split, middle, end]() { split(middle, end); }, &counter);
+			end = middle;
+		}
+		work(begin, end);
+	};
+
+	//The first range runs on the calling thread unless it's the main thread and isn't meant to help
+	std::exception_ptr error;
+	if (mainThreadHelps || CurrentQueue() != workers.size())
+	{
+		try
+		{
+			split(0, count);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+	}
+	else
+	{
+		Run([&split, count]() { split(0, count); }, &counter);
+	}
+
+	//Ranges that are still queued point at split and counter, so this waits even after an exception
+	try
+	{
+		Wait(&counter);
+	}
+	catch (...)
+	{
+		if (!error)
+		{
+			error = std::current_exception();
+		}
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+#pragma endregion
+
+#pragma region Workers
+void JobSystem::WorkerLoop(uint32_t index)
+{
+	workerSystem = this;
+	workerIndex = index;
+
+	while (true)
+	{
+		if (TryRunOne(index))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		if (stopping && queuedJobs.load() == 0)
+		{
+			return;
+		}
+		wakeCondition.wait(lock, [this]() { return stopping || queuedJobs.load() != 0; });
+	}
+}
+
+void JobSystem::Push(Job job)
+{
+	WorkerQueue& queue = queues[CurrentQueue()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	queuedJobs++;
+
+	//Taking the lock means a worker can't miss this between checking queuedJobs and sleeping
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+	}
+	wakeCondition.notify_one();
+}
+
+bool JobSystem::TryRunOne(uint32_t queueIndex)
+{
+	Job job;
+	bool found = false;
+
+	//Newest first from its own deque, it's the one most likely still in cache
+	if (queueIndex < workers.size())
+	{
+		WorkerQueue& queue = queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	//Oldest from the others, with recursive splitting that's the biggest piece of work left
+	for (uint32_t i = 1; i <= queues.size() && !found; i++)
+	{
+		WorkerQueue& queue = queues[(queueIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+	queuedJobs--;
+	Execute(job);
+	return true;
+}
+
+void JobSystem::Execute(Job& job)
+{
+	try
+	{
+		job.function();
+	}
+	catch (...)
+	{
+		if (job.counter == nullptr)
+		{
+			Helper::Warning("Job threw with no counter to report to");
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(job.counter->continuationMutex);
+			if (!job.counter->error)
+			{
+				job.counter->error = std::current_exception();
+			}
+		}
+	}
+	Finish(job.counter);
+}
+
+void JobSystem::Finish(JobCounter* counter)
+{
+	if (counter == nullptr)
+	{
+		return;
+	}
+
+	//Decremented under the lock so Wait can't return, and the counter go away, while this is still using it
+	std::vector<Job> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->continuationMutex);
+		if (--counter->count != 0)
+		{
+			return;
+		}
+		continuations.swap(counter->continuations);
+	}
+
+	for (auto& continuation : continuations)
+	{
+		Push(std::move(continuation));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+	}
+	doneCondition.notify_all();
+}
+
+uint32_t JobSystem::CurrentQueue()
+{
+	if (workerSystem == this)
+	{
+		return workerIndex;
+	}
+	return static_cast<uint32_t>(workers.size());
+}
+#pragma endregion
@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <cstdint>
+
+class JobCounter;
+
+struct Job
+{
+	std::function<void()> function;
+	//Decremented once the function returns, can be null
+	JobCounter* counter = nullptr;
+};
+
+//Number of jobs in a group that haven't finished, JobSystem::Wait on it instead of joining threads
+//Only reuse a counter once it has been waited on
+class JobCounter
+{
+public:
+	bool IsDone() const { return count.load() == 0; };
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> count{ 0 };
+	//Jobs queued with RunAfter, started by whichever job brings the count to zero
+	std::mutex continuationMutex;
+	std::vector<Job> continuations;
+	//First exception any of the jobs threw, rethrown by Wait
+	std::exception_ptr error;
+};
+
+//Work stealing job system, each worker pushes and pops its own jobs from the back of its deque and steals from the front of the others' when it runs out
+//Jobs queued from outside the workers go to one shared deque the workers steal from
+class JobSystem
+{
+public:
+	//workerCount 0 starts one worker per core, leaving one for the main thread
+	//pinThreads keeps each worker on its own core, mainThreadHelps lets Wait run jobs on the waiting thread instead of sleeping
+	JobSystem(uint32_t workerCount = 0, bool pinThreads = false, bool mainThreadHelps = true);
+	//Finishes the queued jobs first
+	~JobSystem();
+
+	//counter is incremented now and decremented when the job has run
+	void Run(const std::function<void()>& function, JobCounter* counter = nullptr);
+	//Same as Run, but the job only starts once every job counted by dependency has finished
+	void RunAfter(JobCounter* dependency, const std::function<void()>& function, JobCounter* counter = nullptr);
+	//Returns once every job counted by counter has finished, rethrows the first exception one of them threw
+	//Safe to call from inside a job, the waiting worker keeps running other jobs
+	void Wait(JobCounter* counter);
+
+	//Calls work(begin, end) on ranges covering [0, count) and waits for all of them
+	//Ranges are split in half until they're grainSize or smaller, so idle workers can steal the other halves, 0 picks a grain from the count and worker count
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& work, uint32_t grainSize = 0);
+
+	//Workers plus the main thread when it helps
+	uint32_t GetThreadCount() { return static_cast<uint32_t>(workers.size()) + (mainThreadHelps ? 1 : 0); };
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	bool mainThreadHelps;
+	std::vector<std::thread> workers;
+	//One per worker, plus a last one shared by threads that aren't workers
+	std::vector<WorkerQueue> queues;
+
+	std::atomic<uint32_t> queuedJobs{ 0 };
+	bool stopping;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	//Signalled whenever a counter reaches zero, for threads that wait without helping
+	std::condition_variable doneCondition;
+
+	void WorkerLoop(uint32_t index);
+	void Push(Job job);
+	//Own queue's newest job first, then the oldest from the others
+	bool TryRunOne(uint32_t queueIndex);
+	void Execute(Job& job);
+	void Finish(JobCounter* counter);
+	//Index of the calling worker's queue, the shared queue's for any other thread
+	uint32_t CurrentQueue();
+};
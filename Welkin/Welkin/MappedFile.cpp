@@ -0,0 +1,89 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::string PATH) : data{ nullptr }, size{ 0 }
+{
+#ifdef _WIN32
+	fileHandle = CreateFileA(PATH.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	mappingHandle = nullptr;
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("failed to open " + PATH + " for mapping!");
+	}
+
+	LARGE_INTEGER fileSize{};
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	if (size == 0)
+	{
+		CloseHandle(fileHandle);
+		throw std::runtime_error("Can't map empty file " + PATH);
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle != nullptr)
+	{
+		data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (data == nullptr)
+	{
+		if (mappingHandle != nullptr)
+		{
+			CloseHandle(mappingHandle);
+		}
+		CloseHandle(fileHandle);
+		throw std::runtime_error("failed to map " + PATH);
+	}
+#else
+	fileDescriptor = open(PATH.c_str(), O_RDONLY);
+
+	if (fileDescriptor < 0)
+	{
+		throw std::runtime_error("failed to open " + PATH + " for mapping!");
+	}
+
+	struct stat fileInfo {};
+	fstat(fileDescriptor, &fileInfo);
+	size = static_cast<size_t>(fileInfo.st_size);
+
+	if (size == 0)
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("Can't map empty file " + PATH);
+	}
+
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapped == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("failed to map " + PATH);
+	}
+
+	data = static_cast<const uint8_t*>(mapped);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+#else
+	munmap(const_cast<uint8_t*>(data), size);
+	close(fileDescriptor);
+#endif
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+//Read only memory mapped view of a file on disk
+//Used for cached assets so their bytes can be copied straight into a staging buffer without reading them into a vector first
+class MappedFile
+{
+public:
+	MappedFile(std::string PATH);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* GetData() { return this->data; };
+	size_t GetSize() { return this->size; };
+
+private:
+	const uint8_t* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
@@ -3,6 +3,10 @@
 Material::Material(Texture* color, std::string materialName, VulkanCore* vCore, glm::vec2 uvScale)
 	: tex_Color {color}, materialName {materialName}, uvScale {uvScale}, vCore{vCore}
 {
+	if (color != nullptr)
+	{
+		textures.push_back(color);
+	}
 	CreateTextureSampler();
 }
 
@@ -34,7 +38,7 @@ void Material::CreateTextureSampler()
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
 	if (vkCreateSampler(*vCore->GetLogicalDevice(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
 	{
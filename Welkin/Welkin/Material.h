@@ -3,6 +3,7 @@
 #include "Helper.h"
 #include "Texture.h"
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include "VulkanCore.h"
 
@@ -12,6 +13,8 @@ public:
 	Material(Texture* color, std::string materialName, VulkanCore* vCore, glm::vec2 uvScale);
 	std::string GetMaterialName() { return this->materialName; };
 	Texture* GetTexture() { return this->tex_Color; };
+	//Every texture the material binds, color first, missing ones left out
+	const std::vector<Texture*>& GetTextures() { return this->textures; };
 	VkSampler* GetSampler() { return &this->textureSampler; };
 	virtual ~Material();
 protected:
@@ -27,5 +30,6 @@ protected:
 
 	//Images
 	Texture* tex_Color;
+	std::vector<Texture*> textures;
 
 };
\ No newline at end of file
@@ -1,14 +1,122 @@
 #include "Mesh.h"
 #include "VulkanCore.h"
+#include "MappedFile.h"
+#include "ObjImporter.h"
+#include "GltfImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshQuantizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include <cfloat>
+#include <filesystem>
+
+Mesh::Mesh(string MODEL_PATH, VertexFormat format, JobSystem* jobSystem) : jobSystem(jobSystem)
+{
+	cachePath = MeshCache::GetCachePath(MODEL_PATH);
+	const VkIndexType wantedIndexType = Welkin_Settings::USE_16_BIT_INDICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	if (!MeshCache::IsCacheUpToDate(MODEL_PATH, cachePath, format, wantedIndexType))
+	{
+		MeshData data;
+		LoadModel(MODEL_PATH, data);
+		MeshOptimizer::Optimize(data);
+		CalculateBounds(data);
+
+		Helper::Cout("- Optimized Mesh: ACMR " + std::to_string(data.statsBefore.acmr) + " -> " + std::to_string(data.statsAfter.acmr)
+			+ ", ATVR " + std::to_string(data.statsBefore.atvr) + " -> " + std::to_string(data.statsAfter.atvr));
+
+		MeshSimplifier::BuildLods(data, Welkin_Settings::MESH_LOD_COUNT);
+		Helper::Cout("- Built " + std::to_string(data.lods.size()) + " LODs");
+
+		//Splitting can duplicate vertices, so this goes before they are packed
+		if (wantedIndexType == VK_INDEX_TYPE_UINT16)
+		{
+			MeshQuantizer::QuantizeIndices(data);
+		}
+
+		//Works on the final index ranges, so it goes after splitting
+		MeshletBuilder::BuildMeshlets(data, Welkin_Settings::MESHLET_MIN_TRIANGLES);
+		if (!data.meshlets.empty())
+		{
+			Helper::Cout("- Built " + std::to_string(data.meshlets.size()) + " Meshlets");
+		}
+
+		//Bounds and UV density above still come from the full precision vertices
+		if (format == VertexFormat::COMPACT)
+		{
+			MeshQuantizer::Quantize(data);
+		}
+
+		if (!MeshCache::WriteCache(MODEL_PATH, cachePath, data))
+		{
+			//Still usable this run, just imported again next launch
+			cachePath.clear();
+			LoadFromData(data);
+			pendingData = std::make_unique<MeshData>(std::move(data));
+			return;
+		}
+
+		Helper::Cout("- Wrote Mesh Cache: [" + cachePath + "]");
+	}
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+	//Cache is already in the GPU layout, so Upload copies or decodes the mapped bytes straight into the staging buffers
+	cacheFile = std::make_unique<MappedFile>(cachePath);
+	MeshCacheView& view = cacheView;
 
-Mesh::Mesh(string MODEL_PATH, VulkanCore* vCore): vCore(vCore)
+	if (!MeshCache::ReadCache(cacheFile->GetData(), cacheFile->GetSize(), view))
+	{
+		throw std::runtime_error("Mesh cache " + cachePath + " is corrupt!");
+	}
+
+	vertexCount = view.header->vertexCount;
+	indexCount = view.header->indexCount;
+	submeshes.assign(view.submeshes, view.submeshes + view.header->submeshCount);
+	lods.assign(view.lods, view.lods + view.header->lodCount);
+	meshlets.assign(view.meshlets, view.meshlets + view.header->meshletCount);
+	boundsCenter = glm::vec3(view.header->boundsCenter[0], view.header->boundsCenter[1], view.header->boundsCenter[2]);
+	boundsRadius = view.header->boundsRadius;
+	uvDensity = view.header->uvDensity;
+	vertexFormat = view.header->vertexFormat;
+	indexType = view.header->indexType;
+	positionScale = glm::vec3(view.header->positionScale[0], view.header->positionScale[1], view.header->positionScale[2]);
+	positionOffset = glm::vec3(view.header->positionOffset[0], view.header->positionOffset[1], view.header->positionOffset[2]);
+
+	Helper::Cout("Loaded Mesh: [" + cachePath + "]");
+}
+
+void Mesh::Upload(VulkanCore* vCore)
 {
-	LoadModel(MODEL_PATH);
-	CreateVertexBuffer();
-	CreateIndexBuffer();
+	this->vCore = vCore;
+
+	if (pendingData)
+	{
+		UploadFromData(*pendingData);
+		pendingData.reset();
+		return;
+	}
+
+	CreateBuffers([&](uint8_t* destination) { MeshCache::ReadVertexData(cacheView, destination, jobSystem); }, [&](uint8_t* destination) { MeshCache::ReadIndexData(cacheView, destination, jobSystem); });
+	cacheFile.reset();
+}
+
+Mesh::Mesh(string name, MeshData& data, VulkanCore* vCore) : vCore(vCore)
+{
+	const VkIndexType wantedIndexType = Welkin_Settings::USE_16_BIT_INDICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	//Generated geometry only has the one level of detail
+	CalculateBounds(data);
+	data.lods = { MeshLod{ 0, static_cast<uint32_t>(data.submeshes.size()), 0.0f, 0, 0 } };
+
+	if (wantedIndexType == VK_INDEX_TYPE_UINT16)
+	{
+		MeshQuantizer::QuantizeIndices(data);
+	}
+
+	//No meshlets, MeshletCuller only uploads the ones of meshes FileManager loaded
+	LoadFromData(data);
+	UploadFromData(data);
+
+	Helper::Cout("Built Mesh: [" + name + "]");
 }
 
 VkBuffer* Mesh::GetVertexBuffer()
@@ -23,16 +131,22 @@ VkBuffer* Mesh::GetIndexBuffer()
 
 uint32_t Mesh::GetVerticesSize()
 {
-	return vertices.size();
+	return this->vertexCount;
 }
 
 uint32_t Mesh::GetIndeicesSize()
 {
-	return this->indices.size();
+	return this->indexCount;
 }
 
 Mesh::~Mesh()
 {
+	//Never uploaded
+	if (vCore == nullptr)
+	{
+		return;
+	}
+
 	vkDestroyBuffer(*vCore->GetLogicalDevice(), vertexBuffer, nullptr);
 	vkFreeMemory(*vCore->GetLogicalDevice(), vertexBufferMemory, nullptr);
 
@@ -40,124 +154,90 @@ Mesh::~Mesh()
 	vkFreeMemory(*vCore->GetLogicalDevice(), indexBufferMemory, nullptr);
 }
 
-void Mesh::LoadModel(std::string MODEL_PATH)
+void Mesh::LoadModel(std::string MODEL_PATH, MeshData& data)
 {
-
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
-
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, MODEL_PATH.c_str()))
+	if (std::filesystem::path(MODEL_PATH).extension() == ".glb")
 	{
-		throw std::runtime_error(err);
+		GltfImporter::Import(MODEL_PATH, data);
 	}
-
-	vertices.clear();
-	indices.clear();
-
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-	for (const auto& shape : shapes) {
-		for (const auto& index : shape.mesh.indices) {
-			Vertex vertex{};
-
-			if (index.vertex_index >= 0)
-			{
-				vertex.position = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2],
-				};
-			}
-			
-			if (index.texcoord_index >= 0)
-			{
-				vertex.UV = 
-				{
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-			}
-
-			if (index.normal_index >= 0)
-			{
-				vertex.normal =
-				{
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2],
-				};
-			}
-
-
-			if (uniqueVertices.count(vertex) == 0) 
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
-
-			indices.push_back(uniqueVertices[vertex]);
-		}
+	else
+	{
+		ObjImporter::Import(MODEL_PATH, data, jobSystem);
 	}
 
-	Helper::Cout("Loaded Mesh: [" + MODEL_PATH + "]");
-
+	Helper::Cout("Imported Mesh: [" + MODEL_PATH + "]");
 }
 
-void Mesh::CreateVertexBuffer()
+void Mesh::CalculateBounds(MeshData& data)
 {
-	VkDevice device = *vCore->GetLogicalDevice();
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+	const std::vector<Vertex>& vertices = data.vertices;
+	const std::vector<uint32_t>& indices = data.indices;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	vCore->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		stagingBuffer, stagingBufferMemory);
+	glm::vec3 minPosition(FLT_MAX);
+	glm::vec3 maxPosition(-FLT_MAX);
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
-
-	vCore->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | 
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-		vertexBuffer, vertexBufferMemory);
+	for (const auto& vertex : vertices)
+	{
+		minPosition = glm::min(minPosition, vertex.position);
+		maxPosition = glm::max(maxPosition, vertex.position);
+	}
 
-	vCore->CopyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+	data.boundsCenter = (minPosition + maxPosition) * 0.5f;
+	data.boundsRadius = 0.0f;
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	for (const auto& vertex : vertices)
+	{
+		data.boundsRadius = std::max(data.boundsRadius, glm::length(vertex.position - data.boundsCenter));
+	}
 
-	Helper::Cout("- Vertex Buffer Memory Bound and Created");
+	//Ratio of the total UV area to the total surface area
+	float surfaceArea = 0.0f;
+	float uvArea = 0.0f;
 
-}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const Vertex& v0 = vertices[indices[i]];
+		const Vertex& v1 = vertices[indices[i + 1]];
+		const Vertex& v2 = vertices[indices[i + 2]];
 
-void Mesh::CreateIndexBuffer()
-{
-	VkDevice device = *vCore->GetLogicalDevice();
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+		surfaceArea += glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position)) * 0.5f;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	vCore->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingBufferMemory);
+		const glm::vec2 uvEdge1 = v1.UV - v0.UV;
+		const glm::vec2 uvEdge2 = v2.UV - v0.UV;
+		uvArea += std::abs(uvEdge1.x * uvEdge2.y - uvEdge1.y * uvEdge2.x) * 0.5f;
+	}
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
+	data.uvDensity = (surfaceArea > 0.0f && uvArea > 0.0f) ? std::sqrt(uvArea / surfaceArea) : 1.0f;
+}
 
-	vCore->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBuffer, indexBufferMemory);
+void Mesh::LoadFromData(const MeshData& data)
+{
+	vertexCount = static_cast<uint32_t>(data.vertices.size());
+	indexCount = static_cast<uint32_t>(data.indices.size());
+	submeshes = data.submeshes;
+	lods = data.lods;
+	meshlets = data.meshlets;
+	boundsCenter = data.boundsCenter;
+	boundsRadius = data.boundsRadius;
+	uvDensity = data.uvDensity;
+	vertexFormat = data.vertexFormat;
+	indexType = data.indexType;
+	positionScale = data.positionScale;
+	positionOffset = data.positionOffset;
+}
 
-	vCore->CopyBuffer(stagingBuffer, indexBuffer, bufferSize);
+void Mesh::UploadFromData(const MeshData& data)
+{
+	const void* indexData = (indexType == VK_INDEX_TYPE_UINT16) ? static_cast<const void*>(data.indices16.data()) : data.indices.data();
+	CreateBuffers([&](uint8_t* destination) { MeshCache::WriteVertexStreams(data, destination); },
+		[&](uint8_t* destination) { memcpy(destination, indexData, static_cast<size_t>(indexCount) * MeshCache::GetIndexStride(indexType)); });
+}
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+void Mesh::CreateBuffers(const function<void(uint8_t*)>& writeVertices, const function<void(uint8_t*)>& writeIndices)
+{
+	vCore->CreateDeviceLocalBuffer(Vertex::getStride(vertexFormat) * static_cast<VkDeviceSize>(vertexCount), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer, vertexBufferMemory, writeVertices);
+	Helper::Cout("- Vertex Buffer Memory Bound and Created");
 
+	vCore->CreateDeviceLocalBuffer(MeshCache::GetIndexStride(indexType) * static_cast<VkDeviceSize>(indexCount), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer, indexBufferMemory, writeIndices);
 	Helper::Cout("- Index Buffer Memory Bound and Created");
 }
@@ -1,60 +1,93 @@
 #pragma once
 #include "Vertex.h"
-#include <unordered_map>
+#include "MeshCache.h"
+#include "MappedFile.h"
 #include "Helper.h"
 #include <vulkan/vulkan.h>
-#include <glm/gtx/hash.hpp>
+#include <functional>
+#include <memory>
 
 using namespace std;
 
-namespace std
-{
-	inline void hash_combine(std::size_t& seed) { }
-
-	template <typename T, typename... Rest>
-	inline void hash_combine(std::size_t& seed, const T& v, Rest... rest) {
-		std::hash<T> hasher;
-		seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-		hash_combine(seed, rest...);
-	}
-
-	template<> struct hash<Vertex>
-	{
-		size_t operator()(Vertex const& vertex) const
-		{
-			size_t seed = 0;
-			hash_combine(seed, vertex.position, vertex.UV, vertex.normal);
-			return seed;
-		}
-	};
-}
-
 class VulkanCore;
+class JobSystem;
 
 class Mesh
 {
 public:
-	Mesh(string MODEL_PATH, VulkanCore* vCore);
+	//Imports the model or maps its cache, doesn't touch the device so it can run on any thread before it exists
+	//Nothing is drawable until Upload
+	//Parsing and decoding the cache spread over jobSystem, which has to outlive Upload, null keeps both on the calling thread
+	Mesh(string MODEL_PATH, VertexFormat format = VertexFormat::STANDARD, JobSystem* jobSystem = nullptr);
+	//For geometry built at runtime, like static batches, data only needs vertices, indices and submeshes filled and is never cached
+	Mesh(string name, MeshData& data, VulkanCore* vCore);
+	//Creates the vertex and index buffers, several meshes can upload at once inside a VulkanCore upload batch
+	void Upload(VulkanCore* vCore);
+	//Holds both vertex streams, bind it again at GetAttributeStreamOffset for binding 1
 	VkBuffer* GetVertexBuffer();
+	VkDeviceSize GetAttributeStreamOffset() { return MeshCache::GetAttributeStreamOffset(this->vertexFormat, this->vertexCount); };
 	VkBuffer* GetIndexBuffer();
 	uint32_t GetVerticesSize();
 	uint32_t GetIndeicesSize();
 
+	const vector<Submesh>& GetSubmeshes() { return this->submeshes; };
+	//LOD 0 is the full mesh, each LOD is a range of submeshes
+	const vector<MeshLod>& GetLods() { return this->lods; };
+	//Indexed by MeshLod::firstMeshlet, empty when no LOD was big enough to split
+	const vector<Meshlet>& GetMeshlets() { return this->meshlets; };
+
+	//Bounding sphere in model space
+	glm::vec3 GetBoundsCenter() { return this->boundsCenter; };
+	float GetBoundsRadius() { return this->boundsRadius; };
+	//Average UV units per model space unit, used to work out texel density on screen
+	float GetUVDensity() { return this->uvDensity; };
+
+	VertexFormat GetVertexFormat() { return this->vertexFormat; };
+	VkIndexType GetIndexType() { return this->indexType; };
+	//Only used by COMPACT meshes, model position = offset + scale * quantized position
+	glm::vec3 GetPositionScale() { return this->positionScale; };
+	glm::vec3 GetPositionOffset() { return this->positionOffset; };
+	//Empty for meshes that weren't loaded through a cache, their source data is only on the GPU
+	const string& GetCachePath() { return this->cachePath; };
+
 	~Mesh();
 private:
-	VulkanCore* vCore;
-	vector<Vertex> vertices;
-	vector<uint32_t> indices;
+	VulkanCore* vCore = nullptr;
+	JobSystem* jobSystem = nullptr;
+	string cachePath;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	vector<Submesh> submeshes;
+	vector<MeshLod> lods;
+	vector<Meshlet> meshlets;
+	VertexFormat vertexFormat;
+	VkIndexType indexType;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
 
 	VkBuffer vertexBuffer;
 	VkDeviceMemory vertexBufferMemory;
 	VkBuffer indexBuffer;
 	VkDeviceMemory indexBufferMemory;
 
+	//Kept between the constructor and Upload, the mapped cache or the imported data when the cache couldn't be written
+	std::unique_ptr<MappedFile> cacheFile;
+	MeshCacheView cacheView;
+	std::unique_ptr<MeshData> pendingData;
+
+	glm::vec3 boundsCenter;
+	float boundsRadius;
+	float uvDensity;
 
-	void LoadModel(string MODEL_PATH);
-	void CreateVertexBuffer();
-	void CreateIndexBuffer();
+	//Source import, only runs when the cache is missing or out of date
+	void LoadModel(string MODEL_PATH, MeshData& data);
+	void CalculateBounds(MeshData& data);
+	//Takes everything from data, for meshes that didn't go through the cache
+	void LoadFromData(const MeshData& data);
+	//Uploads what LoadFromData took
+	void UploadFromData(const MeshData& data);
+	//Each function fills its mapped staging buffer, vertexCount * stride and indexCount * index stride bytes
+	void CreateBuffers(const function<void(uint8_t*)>& writeVertices, const function<void(uint8_t*)>& writeIndices);
 	//http://foundationsofgameenginedev.com/FGED2-sample.pdf
 	//void CalculateTangents();
 };
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "MeshCache.h"
+#include "Helper.h"
+#include "MeshQuantizer.h"
+#include "MeshCodec.h"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const char MESH_CACHE_MAGIC[4] = { 'W', 'K', 'M', 'S' };
+	//Bump whenever the layout of the file or of Vertex changes
+	const uint32_t MESH_CACHE_VERSION = 9;
+
+	uint64_t Align(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool GetSourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& timestamp)
+	{
+		std::error_code error;
+		size = fs::file_size(sourcePath, error);
+		if (error)
+		{
+			return false;
+		}
+
+		timestamp = static_cast<int64_t>(fs::last_write_time(sourcePath, error).time_since_epoch().count());
+		return !error;
+	}
+}
+
+uint32_t MeshCache::GetIndexStride(VkIndexType indexType)
+{
+	return (indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+VkDeviceSize MeshCache::GetAttributeStreamOffset(VertexFormat format, uint32_t vertexCount)
+{
+	return static_cast<VkDeviceSize>(vertexCount) * Vertex::getPositionStride(format);
+}
+
+void MeshCache::WriteVertexStreams(const MeshData& data, uint8_t* destination)
+{
+	const uint32_t vertexCount = static_cast<uint32_t>(data.vertices.size());
+	uint8_t* positions = destination;
+	uint8_t* attributes = destination + GetAttributeStreamOffset(data.vertexFormat, vertexCount);
+
+	if (data.vertexFormat == VertexFormat::COMPACT)
+	{
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			const CompactVertex& vertex = data.compactVertices[i];
+			CompactVertexAttributes vertexAttributes;
+			memcpy(vertexAttributes.UV, vertex.UV, sizeof(vertex.UV));
+			memcpy(vertexAttributes.normal, vertex.normal, sizeof(vertex.normal));
+			memcpy(vertexAttributes.tangent, vertex.tangent, sizeof(vertex.tangent));
+
+			memcpy(positions + sizeof(vertex.position) * i, vertex.position, sizeof(vertex.position));
+			memcpy(attributes + sizeof(CompactVertexAttributes) * i, &vertexAttributes, sizeof(CompactVertexAttributes));
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& vertex = data.vertices[i];
+		const VertexAttributes vertexAttributes{ vertex.UV, vertex.normal, vertex.tangent };
+
+		memcpy(positions + sizeof(vertex.position) * i, &vertex.position, sizeof(vertex.position));
+		memcpy(attributes + sizeof(VertexAttributes) * i, &vertexAttributes, sizeof(VertexAttributes));
+	}
+}
+
+void MeshCache::ReadVertexData(const MeshCacheView& view, uint8_t* destination, JobSystem* jobSystem)
+{
+	const MeshCacheHeader& header = *view.header;
+	if (!header.compressed)
+	{
+		memcpy(destination, view.vertices, static_cast<size_t>(header.vertexDataSize));
+		return;
+	}
+
+	const size_t positionStreamSize = MeshCodec::DecodeVertexStream(view.vertices, static_cast<size_t>(header.vertexDataSize), destination,
+		header.vertexCount, Vertex::getPositionStride(header.vertexFormat), jobSystem);
+	MeshCodec::DecodeVertexStream(view.vertices + positionStreamSize, static_cast<size_t>(header.vertexDataSize) - positionStreamSize,
+		destination + GetAttributeStreamOffset(header.vertexFormat, header.vertexCount), header.vertexCount, Vertex::getAttributeStride(header.vertexFormat), jobSystem);
+}
+
+void MeshCache::ReadIndexData(const MeshCacheView& view, uint8_t* destination, JobSystem* jobSystem)
+{
+	const MeshCacheHeader& header = *view.header;
+	if (!header.compressed)
+	{
+		memcpy(destination, view.indices, static_cast<size_t>(header.indexDataSize));
+		return;
+	}
+
+	MeshCodec::DecodeIndices(view.indices, static_cast<size_t>(header.indexDataSize), destination, header.indexCount, header.indexStride, jobSystem);
+}
+
+void MeshCache::ReadVertexStreams(const MeshCacheView& view, std::vector<Vertex>& vertices, JobSystem* jobSystem)
+{
+	const MeshCacheHeader& header = *view.header;
+	std::vector<uint8_t> vertexData(static_cast<size_t>(header.vertexCount) * header.vertexStride);
+	ReadVertexData(view, vertexData.data(), jobSystem);
+
+	const uint8_t* positions = vertexData.data();
+	const uint8_t* attributes = vertexData.data() + GetAttributeStreamOffset(header.vertexFormat, header.vertexCount);
+	vertices.resize(header.vertexCount);
+
+	if (header.vertexFormat == VertexFormat::COMPACT)
+	{
+		const glm::vec3 positionScale(header.positionScale[0], header.positionScale[1], header.positionScale[2]);
+		const glm::vec3 positionOffset(header.positionOffset[0], header.positionOffset[1], header.positionOffset[2]);
+
+		for (uint32_t i = 0; i < header.vertexCount; i++)
+		{
+			uint16_t quantizedPosition[4];
+			CompactVertexAttributes vertexAttributes;
+			memcpy(quantizedPosition, positions + sizeof(quantizedPosition) * i, sizeof(quantizedPosition));
+			memcpy(&vertexAttributes, attributes + sizeof(CompactVertexAttributes) * i, sizeof(CompactVertexAttributes));
+
+			Vertex& vertex = vertices[i];
+			vertex.position = positionOffset + positionScale * glm::vec3(quantizedPosition[0], quantizedPosition[1], quantizedPosition[2]) / 65535.0f;
+			vertex.UV = glm::vec2(MeshQuantizer::HalfToFloat(vertexAttributes.UV[0]), MeshQuantizer::HalfToFloat(vertexAttributes.UV[1]));
+			vertex.normal = MeshQuantizer::DecodeOctahedral(vertexAttributes.normal);
+			vertex.tangent = glm::vec4(MeshQuantizer::DecodeOctahedral(vertexAttributes.tangent), (quantizedPosition[3] < 32768) ? -1.0f : 1.0f);
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < header.vertexCount; i++)
+	{
+		VertexAttributes vertexAttributes;
+		memcpy(&vertices[i].position, positions + sizeof(glm::vec3) * i, sizeof(glm::vec3));
+		memcpy(&vertexAttributes, attributes + sizeof(VertexAttributes) * i, sizeof(VertexAttributes));
+
+		vertices[i].UV = vertexAttributes.UV;
+		vertices[i].normal = vertexAttributes.normal;
+		vertices[i].tangent = vertexAttributes.tangent;
+	}
+}
+
+void MeshCache::ReadIndices(const MeshCacheView& view, std::vector<uint32_t>& indices, JobSystem* jobSystem)
+{
+	const MeshCacheHeader& header = *view.header;
+	indices.resize(header.indexCount);
+
+	if (header.indexType == VK_INDEX_TYPE_UINT16)
+	{
+		std::vector<uint16_t> indices16(header.indexCount);
+		ReadIndexData(view, reinterpret_cast<uint8_t*>(indices16.data()), jobSystem);
+		indices.assign(indices16.begin(), indices16.end());
+		return;
+	}
+
+	ReadIndexData(view, reinterpret_cast<uint8_t*>(indices.data()), jobSystem);
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".wkmesh";
+}
+
+bool MeshCache::IsCacheUpToDate(const std::string& sourcePath, const std::string& cachePath, VertexFormat format, VkIndexType indexType)
+{
+	uint64_t sourceSize;
+	int64_t sourceTimestamp;
+
+	if (!fs::exists(cachePath) || !GetSourceStamp(sourcePath, sourceSize, sourceTimestamp))
+	{
+		return false;
+	}
+
+	//Only the header is needed, so read it instead of mapping the whole file
+	MeshCacheHeader header{};
+	std::ifstream file(cachePath, std::ios::binary);
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+	{
+		return false;
+	}
+
+	return memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0
+		&& header.version == MESH_CACHE_VERSION
+		&& header.vertexFormat == format
+		&& header.indexType == indexType
+		&& header.vertexStride == Vertex::getStride(format)
+		&& header.sourceSize == sourceSize
+		&& header.sourceTimestamp == sourceTimestamp;
+}
+
+bool MeshCache::WriteCache(const std::string& sourcePath, const std::string& cachePath, const MeshData& data)
+{
+	MeshCacheHeader header{};
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+
+	if (!GetSourceStamp(sourcePath, header.sourceSize, header.sourceTimestamp))
+	{
+		return false;
+	}
+
+	header.boundsCenter[0] = data.boundsCenter.x;
+	header.boundsCenter[1] = data.boundsCenter.y;
+	header.boundsCenter[2] = data.boundsCenter.z;
+	header.boundsRadius = data.boundsRadius;
+	header.uvDensity = data.uvDensity;
+	header.vertexFormat = data.vertexFormat;
+	header.indexType = data.indexType;
+	header.indexStride = GetIndexStride(data.indexType);
+	header.vertexStride = Vertex::getStride(data.vertexFormat);
+	header.statsBefore = data.statsBefore;
+	header.statsAfter = data.statsAfter;
+
+	for (int i = 0; i < 3; i++)
+	{
+		header.positionScale[i] = data.positionScale[i];
+		header.positionOffset[i] = data.positionOffset[i];
+	}
+
+	header.vertexCount = static_cast<uint32_t>(data.vertices.size());
+	header.indexCount = static_cast<uint32_t>(data.indices.size());
+	header.submeshCount = static_cast<uint32_t>(data.submeshes.size());
+	header.lodCount = static_cast<uint32_t>(data.lods.size());
+	header.meshletCount = static_cast<uint32_t>(data.meshlets.size());
+
+	header.lodOffset = Align(sizeof(MeshCacheHeader), 16);
+	header.meshletOffset = Align(header.lodOffset + data.lods.size() * sizeof(MeshLod), 16);
+	header.submeshOffset = Align(header.meshletOffset + data.meshlets.size() * sizeof(Meshlet), 16);
+	header.vertexOffset = Align(header.submeshOffset + data.submeshes.size() * sizeof(Submesh), 16);
+
+	std::vector<uint8_t> vertexData(static_cast<size_t>(header.vertexCount) * header.vertexStride);
+	WriteVertexStreams(data, vertexData.data());
+	std::vector<uint8_t> indexData(static_cast<size_t>(header.indexCount) * header.indexStride);
+	memcpy(indexData.data(), (data.indexType == VK_INDEX_TYPE_UINT16) ? static_cast<const void*>(data.indices16.data()) : data.indices.data(), indexData.size());
+
+	if (Welkin_Settings::USE_COMPRESSED_MESHES)
+	{
+		//Both streams go in one section, the position stream records its own size so the attribute stream can be found after it
+		std::vector<uint8_t> compressedVertices;
+		MeshCodec::EncodeVertexStream(vertexData.data(), header.vertexCount, Vertex::getPositionStride(data.vertexFormat), compressedVertices);
+		MeshCodec::EncodeVertexStream(vertexData.data() + GetAttributeStreamOffset(data.vertexFormat, header.vertexCount), header.vertexCount,
+			Vertex::getAttributeStride(data.vertexFormat), compressedVertices);
+
+		std::vector<uint8_t> compressedIndices;
+		MeshCodec::EncodeIndices(data.indices.data(), header.indexCount, data.submeshes, compressedIndices);
+
+		Helper::Cout("- Compressed Mesh: " + std::to_string(vertexData.size() + indexData.size()) + " -> " + std::to_string(compressedVertices.size() + compressedIndices.size()) + " bytes");
+		vertexData.swap(compressedVertices);
+		indexData.swap(compressedIndices);
+		header.compressed = 1;
+	}
+
+	header.vertexDataSize = vertexData.size();
+	header.indexDataSize = indexData.size();
+	header.indexOffset = Align(header.vertexOffset + header.vertexDataSize, 16);
+	const uint64_t fileSize = header.indexOffset + header.indexDataSize;
+
+	std::vector<uint8_t> file(fileSize, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + header.lodOffset, data.lods.data(), data.lods.size() * sizeof(MeshLod));
+	memcpy(file.data() + header.meshletOffset, data.meshlets.data(), data.meshlets.size() * sizeof(Meshlet));
+	memcpy(file.data() + header.submeshOffset, data.submeshes.data(), data.submeshes.size() * sizeof(Submesh));
+	memcpy(file.data() + header.vertexOffset, vertexData.data(), vertexData.size());
+	memcpy(file.data() + header.indexOffset, indexData.data(), indexData.size());
+
+	std::ofstream output(cachePath, std::ios::binary | std::ios::trunc);
+	if (!output.is_open())
+	{
+		Helper::Warning("Couldn't write mesh cache " + cachePath);
+		return false;
+	}
+
+	output.write(reinterpret_cast<const char*>(file.data()), file.size());
+	return output.good();
+}
+
+bool MeshCache::ReadCache(const uint8_t* data, size_t size, MeshCacheView& view)
+{
+	if (size < sizeof(MeshCacheHeader))
+	{
+		return false;
+	}
+
+	view.header = reinterpret_cast<const MeshCacheHeader*>(data);
+	const MeshCacheHeader& header = *view.header;
+
+	if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 || header.version != MESH_CACHE_VERSION || header.vertexStride != Vertex::getStride(header.vertexFormat)
+		|| header.indexStride != GetIndexStride(header.indexType))
+	{
+		return false;
+	}
+
+	if (header.lodOffset + header.lodCount * sizeof(MeshLod) > size
+		|| header.meshletOffset + header.meshletCount * sizeof(Meshlet) > size
+		|| header.submeshOffset + header.submeshCount * sizeof(Submesh) > size
+		|| header.vertexOffset + header.vertexDataSize > size
+		|| header.indexOffset + header.indexDataSize > size)
+	{
+		return false;
+	}
+
+	//Compressed sections can only be checked by decoding them, which ReadVertexData and ReadIndexData do
+	if (!header.compressed && (header.vertexDataSize != static_cast<uint64_t>(header.vertexCount) * header.vertexStride
+		|| header.indexDataSize != static_cast<uint64_t>(header.indexCount) * header.indexStride))
+	{
+		return false;
+	}
+
+	view.lods = reinterpret_cast<const MeshLod*>(data + header.lodOffset);
+	for (uint32_t i = 0; i < header.lodCount; i++)
+	{
+		if (static_cast<uint64_t>(view.lods[i].firstSubmesh) + view.lods[i].submeshCount > header.submeshCount
+			|| static_cast<uint64_t>(view.lods[i].firstMeshlet) + view.lods[i].meshletCount > header.meshletCount)
+		{
+			return false;
+		}
+	}
+
+	//Draw ranges are used as they are, so one past the buffers would read out of bounds on the GPU
+	view.submeshes = reinterpret_cast<const Submesh*>(data + header.submeshOffset);
+	for (uint32_t i = 0; i < header.submeshCount; i++)
+	{
+		if (static_cast<uint64_t>(view.submeshes[i].firstIndex) + view.submeshes[i].indexCount > header.indexCount
+			|| view.submeshes[i].vertexOffset >= header.vertexCount)
+		{
+			return false;
+		}
+	}
+
+	view.meshlets = reinterpret_cast<const Meshlet*>(data + header.meshletOffset);
+	for (uint32_t i = 0; i < header.meshletCount; i++)
+	{
+		if (static_cast<uint64_t>(view.meshlets[i].firstIndex) + view.meshlets[i].indexCount > header.indexCount
+			|| view.meshlets[i].vertexOffset >= header.vertexCount)
+		{
+			return false;
+		}
+	}
+
+	view.vertices = data + header.vertexOffset;
+	view.indices = data + header.indexOffset;
+	return true;
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Vertex.h"
+
+class JobSystem;
+
+//Range of the index buffer drawn as one piece, one per shape in the source file
+//Shapes too big for 16 bit indices are split into several
+struct Submesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	//Added to every index in the range, lets 16 bit indices address meshes with more than 65536 vertices
+	uint32_t vertexOffset;
+};
+
+//Post-transform cache efficiency of an index buffer, measured on a 16 entry FIFO
+struct VertexCacheStats
+{
+	//Average cache misses per triangle, 0.5 is the best a regular grid can do, 3 is no reuse at all
+	float acmr;
+	//Average cache misses per vertex, 1 is ideal
+	float atvr;
+};
+
+//One level of detail, a run of submeshes that all index the shared vertex buffer
+struct MeshLod
+{
+	uint32_t firstSubmesh;
+	uint32_t submeshCount;
+	//Largest distance the surface moved from LOD 0, in model space units
+	float error;
+	//Range of MeshData::meshlets covering this LOD, meshletCount is 0 when the mesh is too small to be split
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+};
+
+//Small run of a submesh's triangles that is culled on its own on the GPU, see MeshletBuilder
+//Laid out to match the std430 struct in MeshletCull.comp
+struct Meshlet
+{
+	//Bounding sphere in model space
+	float center[3];
+	float radius;
+	//Every triangle faces away from the camera when dot(normalize(center - camera), coneAxis) >= coneCutoff + radius / distance
+	//coneCutoff is 1 when the triangles face too many ways to ever be culled like this
+	float coneAxis[3];
+	float coneCutoff;
+
+	//Same meaning as in Submesh, so a visible meshlet is drawn like one
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexOffset;
+	uint32_t padding;
+};
+
+//Everything the GPU needs from an imported model
+struct MeshData
+{
+	//Full precision vertices, always filled by the import so the passes below can work on them
+	std::vector<Vertex> vertices;
+	//Only filled for COMPACT meshes, this is what gets uploaded for them
+	std::vector<CompactVertex> compactVertices;
+	VertexFormat vertexFormat = VertexFormat::STANDARD;
+	//position = positionOffset + positionScale * quantized position
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+
+	//Relative to each submesh's vertexOffset
+	std::vector<uint32_t> indices;
+	//Same indices, only filled for UINT16 meshes
+	std::vector<uint16_t> indices16;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	std::vector<Submesh> submeshes;
+	//Filled by MeshSimplifier, LOD 0 is the full mesh
+	std::vector<MeshLod> lods;
+	//Filled by MeshletBuilder, grouped by LOD
+	std::vector<Meshlet> meshlets;
+
+	glm::vec3 boundsCenter;
+	float boundsRadius;
+	float uvDensity;
+
+	//Filled by MeshOptimizer, kept so the import doesn't have to be repeated to see them
+	VertexCacheStats statsBefore;
+	VertexCacheStats statsAfter;
+};
+
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	//Cache is rebuilt when the source's size or timestamp no longer match
+	uint64_t sourceSize;
+	int64_t sourceTimestamp;
+
+	float boundsCenter[3];
+	float boundsRadius;
+	float uvDensity;
+	uint32_t vertexStride;
+
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t submeshCount;
+	VertexFormat vertexFormat;
+
+	float positionScale[3];
+	float positionOffset[3];
+
+	VkIndexType indexType;
+	uint32_t indexStride;
+	uint32_t lodCount;
+	uint32_t meshletCount;
+
+	VertexCacheStats statsBefore;
+	VertexCacheStats statsAfter;
+
+	//Offsets from the start of the file
+	uint64_t lodOffset;
+	uint64_t meshletOffset;
+	uint64_t submeshOffset;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	//Bytes the two sections take in the file, only smaller than vertexCount * vertexStride and indexCount * indexStride when compressed
+	uint64_t vertexDataSize;
+	uint64_t indexDataSize;
+	//Vertex section is the two vertex streams and the index section the indices as MeshCodec streams, see USE_COMPRESSED_MESHES
+	uint32_t compressed;
+};
+
+//Points into a mapped cache file, only valid while the file stays mapped
+struct MeshCacheView
+{
+	const MeshCacheHeader* header;
+	const MeshLod* lods;
+	const Meshlet* meshlets;
+	const Submesh* submeshes;
+	const uint8_t* vertices;
+	const uint8_t* indices;
+};
+
+//Versioned binary copy of an imported model (.wkmesh), laid out so vertices and indices can be copied or decoded straight into staging buffers
+namespace MeshCache
+{
+	//Cache lives next to the source model, SmoothCube.obj -> SmoothCube.obj.wkmesh, so models that only differ in extension get their own
+	std::string GetCachePath(const std::string& sourcePath);
+	//Also out of date if it was written with a different vertex format or index type
+	bool IsCacheUpToDate(const std::string& sourcePath, const std::string& cachePath, VertexFormat format, VkIndexType indexType);
+	uint32_t GetIndexStride(VkIndexType indexType);
+	//Vertex buffers are the position stream followed by the attribute stream, this is where the second one starts
+	VkDeviceSize GetAttributeStreamOffset(VertexFormat format, uint32_t vertexCount);
+	//Splits the mesh's vertices into the two streams, destination needs room for vertexCount * Vertex::getStride(format) bytes
+	void WriteVertexStreams(const MeshData& data, uint8_t* destination);
+	//Copies the vertex section into destination in the GPU layout, decoding it first if the cache is compressed
+	//Compressed blocks are spread over jobSystem's workers, null decodes them on the calling thread
+	void ReadVertexData(const MeshCacheView& view, uint8_t* destination, JobSystem* jobSystem = nullptr);
+	//Same for the index section, destination needs room for indexCount * indexStride bytes
+	void ReadIndexData(const MeshCacheView& view, uint8_t* destination, JobSystem* jobSystem = nullptr);
+	//Inverse of WriteVertexStreams for a mapped cache, COMPACT vertices are dequantized back to full precision
+	void ReadVertexStreams(const MeshCacheView& view, std::vector<Vertex>& vertices, JobSystem* jobSystem = nullptr);
+	//Widens UINT16 indices, still relative to each submesh's vertexOffset
+	void ReadIndices(const MeshCacheView& view, std::vector<uint32_t>& indices, JobSystem* jobSystem = nullptr);
+
+	bool WriteCache(const std::string& sourcePath, const std::string& cachePath, const MeshData& data);
+	//Returns false if the data isn't a cache this version can read
+	bool ReadCache(const uint8_t* data, size_t size, MeshCacheView& view);
+};
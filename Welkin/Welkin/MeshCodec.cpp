@@ -0,0 +1,784 @@
+#include "MeshCodec.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	//Probabilities are 12 bit fixed point, keeps the decode lookup tables at 4KB
+	const uint32_t PROB_BITS = 12;
+	const uint32_t PROB_SCALE = 1u << PROB_BITS;
+	//rANS state stays in [RANS_LOWER_BOUND, RANS_LOWER_BOUND << 8) between symbols
+	const uint32_t RANS_LOWER_BOUND = 1u << 23;
+
+	//Elements per block, small enough that a mesh splits over a few threads and big enough that the frequency tables don't matter
+	const uint32_t BLOCK_VERTICES = 16384;
+	const uint32_t BLOCK_INDICES = 3 * 16384;
+
+	//Index coding, see EncodeIndices
+	const uint32_t EDGE_FIFO_SIZE = 15;
+	const uint32_t VERTEX_FIFO_SIZE = 14;
+	//Triangle codes below this are an edge FIFO hit, edge * 16 + how the third vertex is coded
+	const uint8_t TRIANGLE_MISS = 0xF0;
+	//Vertex codes, anything between these two is a vertex FIFO position
+	const uint8_t VERTEX_NEXT = 0;
+	const uint8_t VERTEX_EXPLICIT = 15;
+
+	struct StreamHeader
+	{
+		uint32_t blockCount;
+		uint32_t elementCount;
+		uint32_t stride;
+		uint32_t padding;
+		//Whole stream including this header and the block table
+		uint64_t size;
+	};
+
+	//Blocks cover the elements back to back, offsets are from the start of the stream
+	struct BlockEntry
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t firstElement;
+		uint32_t elementCount;
+	};
+
+	struct SymbolModel
+	{
+		uint32_t frequency[256];
+		uint32_t start[256];
+	};
+
+	struct DecodeModel
+	{
+		SymbolModel model;
+		uint8_t symbol[PROB_SCALE];
+	};
+
+#pragma region Helpers
+	void WriteVarint(std::vector<uint8_t>& output, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			output.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		output.push_back(static_cast<uint8_t>(value));
+	}
+
+	uint64_t ReadVarint(const uint8_t*& data, const uint8_t* end)
+	{
+		uint64_t value = 0;
+		for (uint32_t shift = 0; shift < 64; shift += 7)
+		{
+			if (data == end)
+			{
+				throw std::runtime_error("Compressed mesh data ends inside a number!");
+			}
+
+			const uint8_t byte = *data++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return value;
+			}
+		}
+		throw std::runtime_error("Compressed mesh data has a number that is too long!");
+	}
+
+	void WriteUint32(std::vector<uint8_t>& output, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			output.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+	uint32_t ReadUint32(const uint8_t*& data, const uint8_t* end)
+	{
+		if (end - data < 4)
+		{
+			throw std::runtime_error("Compressed mesh data is truncated!");
+		}
+
+		const uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+		data += 4;
+		return value;
+	}
+
+	uint16_t ZigZag16(uint16_t value)
+	{
+		return static_cast<uint16_t>((value << 1) ^ static_cast<uint16_t>(static_cast<int16_t>(value) >> 15));
+	}
+
+	uint16_t UnZigZag16(uint16_t value)
+	{
+		return static_cast<uint16_t>((value >> 1) ^ (0u - (value & 1u)));
+	}
+
+	//Runs work(0) to work(count - 1) on jobSystem's threads, or one after the other on the calling thread when there is none
+	//Rethrows the first exception any of them threw once they have all finished
+	void ParallelFor(JobSystem* jobSystem, uint32_t count, const std::function<void(uint32_t)>& work)
+	{
+		if (jobSystem == nullptr)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				work(i);
+			}
+			return;
+		}
+
+		//Blocks are already about the same size, one per range
+		jobSystem->ParallelFor(count, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				work(i);
+			}
+		}, 1);
+	}
+#pragma endregion
+
+#pragma region Entropy Coding
+	//Scales the counts so they add up to PROB_SCALE, every symbol that was seen keeps at least 1
+	void BuildModel(const uint32_t counts[256], size_t total, SymbolModel& model)
+	{
+		uint32_t sum = 0;
+		uint32_t largest = 0;
+		for (uint32_t s = 0; s < 256; s++)
+		{
+			model.frequency[s] = (counts[s] == 0) ? 0 : std::max<uint32_t>(1, static_cast<uint32_t>(static_cast<uint64_t>(counts[s]) * PROB_SCALE / total));
+			sum += model.frequency[s];
+			largest = (model.frequency[s] > model.frequency[largest]) ? s : largest;
+		}
+
+		if (sum < PROB_SCALE)
+		{
+			model.frequency[largest] += PROB_SCALE - sum;
+		}
+
+		//Rounding up all the rare symbols can go over, take it back from whichever symbol is most common at the time
+		while (sum > PROB_SCALE)
+		{
+			uint32_t* most = std::max_element(model.frequency, model.frequency + 256);
+			(*most)--;
+			sum--;
+		}
+
+		uint32_t start = 0;
+		for (uint32_t s = 0; s < 256; s++)
+		{
+			model.start[s] = start;
+			start += model.frequency[s];
+		}
+	}
+
+	//Symbol i is coded with model i % contextCount, so interleaved data with different statistics, like low and high bytes, each get their own
+	//Layout: symbol count, frequency tables, final encoder state, then the renormalisation bytes in the order the decoder reads them
+	void EncodeSymbols(const std::vector<uint8_t>& symbols, uint32_t contextCount, std::vector<uint8_t>& output)
+	{
+		WriteUint32(output, static_cast<uint32_t>(symbols.size()));
+		if (symbols.empty())
+		{
+			return;
+		}
+
+		std::vector<SymbolModel> models(contextCount);
+		for (uint32_t c = 0; c < contextCount; c++)
+		{
+			uint32_t counts[256] = {};
+			size_t total = 0;
+			for (size_t i = c; i < symbols.size(); i += contextCount)
+			{
+				counts[symbols[i]]++;
+				total++;
+			}
+
+			if (total > 0)
+			{
+				BuildModel(counts, total, models[c]);
+			}
+			else
+			{
+				//Never read, still written so the decoder always finds a valid table
+				memset(&models[c], 0, sizeof(SymbolModel));
+				models[c].frequency[0] = PROB_SCALE;
+			}
+
+			//Most tables are sparse, so a zero is followed by how many more zeros come after it
+			for (uint32_t s = 0; s < 256; s++)
+			{
+				WriteVarint(output, models[c].frequency[s]);
+				if (models[c].frequency[s] == 0)
+				{
+					uint32_t run = 0;
+					while (s + 1 < 256 && models[c].frequency[s + 1] == 0)
+					{
+						run++;
+						s++;
+					}
+					output.push_back(static_cast<uint8_t>(run));
+				}
+			}
+		}
+
+		//rANS works backwards, the bytes are collected in reverse and flipped at the end
+		std::vector<uint8_t> reversed;
+		reversed.reserve(symbols.size());
+		uint32_t state = RANS_LOWER_BOUND;
+
+		for (size_t i = symbols.size(); i-- > 0;)
+		{
+			const SymbolModel& model = models[i % contextCount];
+			const uint32_t frequency = model.frequency[symbols[i]];
+			const uint32_t stateMax = ((RANS_LOWER_BOUND >> PROB_BITS) << 8) * frequency;
+
+			while (state >= stateMax)
+			{
+				reversed.push_back(static_cast<uint8_t>(state));
+				state >>= 8;
+			}
+			state = ((state / frequency) << PROB_BITS) + (state % frequency) + model.start[symbols[i]];
+		}
+
+		for (int i = 3; i >= 0; i--)
+		{
+			reversed.push_back(static_cast<uint8_t>(state >> (8 * i)));
+		}
+		output.insert(output.end(), reversed.rbegin(), reversed.rend());
+	}
+
+	//Leaves data just past the symbols, the encoder's state ends where it started so the decoder reads exactly what was written
+	//maxSymbols is checked before anything is allocated, a corrupt count would otherwise ask for gigabytes
+	void DecodeSymbols(const uint8_t*& data, const uint8_t* end, uint32_t contextCount, size_t maxSymbols, std::vector<uint8_t>& symbols)
+	{
+		const uint32_t symbolCount = ReadUint32(data, end);
+		if (symbolCount > maxSymbols)
+		{
+			throw std::runtime_error("Compressed mesh block is bigger than the mesh it belongs to!");
+		}
+
+		symbols.resize(symbolCount);
+		if (symbols.empty())
+		{
+			return;
+		}
+
+		std::vector<DecodeModel> models(contextCount);
+		for (DecodeModel& decodeModel : models)
+		{
+			uint32_t start = 0;
+			uint32_t zeroRun = 0;
+			for (uint32_t s = 0; s < 256; s++)
+			{
+				uint64_t frequency = 0;
+				if (zeroRun > 0)
+				{
+					zeroRun--;
+				}
+				else
+				{
+					frequency = ReadVarint(data, end);
+					if (frequency == 0)
+					{
+						if (data == end)
+						{
+							throw std::runtime_error("Compressed mesh data is truncated!");
+						}
+						zeroRun = *data++;
+					}
+				}
+
+				if (frequency > PROB_SCALE - start)
+				{
+					throw std::runtime_error("Compressed mesh data has a broken frequency table!");
+				}
+
+				decodeModel.model.frequency[s] = static_cast<uint32_t>(frequency);
+				decodeModel.model.start[s] = start;
+				memset(decodeModel.symbol + start, static_cast<int>(s), static_cast<size_t>(frequency));
+				start += static_cast<uint32_t>(frequency);
+			}
+
+			if (start != PROB_SCALE)
+			{
+				throw std::runtime_error("Compressed mesh data has a broken frequency table!");
+			}
+		}
+
+		uint32_t state = ReadUint32(data, end);
+		for (size_t i = 0; i < symbols.size(); i++)
+		{
+			const DecodeModel& decodeModel = models[i % contextCount];
+			const uint32_t slot = state & (PROB_SCALE - 1);
+			const uint8_t symbol = decodeModel.symbol[slot];
+			symbols[i] = symbol;
+			state = decodeModel.model.frequency[symbol] * (state >> PROB_BITS) + slot - decodeModel.model.start[symbol];
+
+			while (state < RANS_LOWER_BOUND)
+			{
+				if (data == end)
+				{
+					throw std::runtime_error("Compressed mesh data is truncated!");
+				}
+				state = (state << 8) | *data++;
+			}
+		}
+	}
+#pragma endregion
+
+
+#pragma region Blocks
+	struct BlockRange
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	//Cuts [0, elementCount) at every restart and then into pieces of at most blockSize
+	std::vector<BlockRange> SplitBlocks(uint32_t elementCount, uint32_t blockSize, std::vector<uint32_t> restarts)
+	{
+		restarts.push_back(0);
+		restarts.push_back(elementCount);
+		std::sort(restarts.begin(), restarts.end());
+		restarts.erase(std::unique(restarts.begin(), restarts.end()), restarts.end());
+
+		std::vector<BlockRange> ranges;
+		for (size_t r = 0; r + 1 < restarts.size(); r++)
+		{
+			for (uint32_t first = restarts[r]; first < restarts[r + 1]; first += blockSize)
+			{
+				ranges.push_back({ first, std::min(blockSize, restarts[r + 1] - first) });
+			}
+		}
+		return ranges;
+	}
+
+	//encodeBlock(range, output) appends the block for range
+	template<typename EncodeBlock>
+	void EncodeBlocks(uint32_t elementCount, uint32_t stride, const std::vector<BlockRange>& ranges, std::vector<uint8_t>& output, EncodeBlock encodeBlock)
+	{
+		const size_t streamStart = output.size();
+		StreamHeader header{};
+		header.blockCount = static_cast<uint32_t>(ranges.size());
+		header.elementCount = elementCount;
+		header.stride = stride;
+
+		std::vector<BlockEntry> blocks(ranges.size());
+		output.resize(streamStart + sizeof(StreamHeader) + blocks.size() * sizeof(BlockEntry));
+
+		for (size_t b = 0; b < ranges.size(); b++)
+		{
+			blocks[b].offset = output.size() - streamStart;
+			blocks[b].firstElement = ranges[b].first;
+			blocks[b].elementCount = ranges[b].count;
+			encodeBlock(ranges[b], output);
+			blocks[b].size = output.size() - streamStart - blocks[b].offset;
+		}
+
+		header.size = output.size() - streamStart;
+		memcpy(output.data() + streamStart, &header, sizeof(header));
+		memcpy(output.data() + streamStart + sizeof(StreamHeader), blocks.data(), blocks.size() * sizeof(BlockEntry));
+	}
+
+	//decodeBlock(range, blockData, blockEnd) is called for each block, from several threads at once when there is a jobSystem
+	template<typename DecodeBlock>
+	size_t DecodeBlocks(const uint8_t* data, size_t size, uint32_t elementCount, uint32_t stride, JobSystem* jobSystem, DecodeBlock decodeBlock)
+	{
+		StreamHeader header;
+		if (size < sizeof(StreamHeader))
+		{
+			throw std::runtime_error("Compressed mesh data is truncated!");
+		}
+		memcpy(&header, data, sizeof(header));
+
+		if (header.elementCount != elementCount || header.stride != stride || header.size > size
+			|| sizeof(StreamHeader) + static_cast<uint64_t>(header.blockCount) * sizeof(BlockEntry) > header.size)
+		{
+			throw std::runtime_error("Compressed mesh data doesn't match the mesh it belongs to!");
+		}
+
+		std::vector<BlockEntry> blocks(header.blockCount);
+		memcpy(blocks.data(), data + sizeof(StreamHeader), blocks.size() * sizeof(BlockEntry));
+
+		//Blocks have to cover every element exactly once, otherwise part of the destination would be left unwritten
+		uint64_t covered = 0;
+		for (const BlockEntry& block : blocks)
+		{
+			if (block.offset > header.size || block.size > header.size - block.offset || block.firstElement != covered || block.elementCount == 0)
+			{
+				throw std::runtime_error("Compressed mesh data has a broken block table!");
+			}
+			covered += block.elementCount;
+		}
+
+		if (covered != elementCount)
+		{
+			throw std::runtime_error("Compressed mesh data has a broken block table!");
+		}
+
+		ParallelFor(jobSystem, header.blockCount, [&](uint32_t b)
+		{
+			const uint8_t* blockData = data + blocks[b].offset;
+			decodeBlock(BlockRange{ blocks[b].firstElement, blocks[b].elementCount }, blockData, blockData + blocks[b].size);
+		});
+
+		return static_cast<size_t>(header.size);
+	}
+#pragma endregion
+
+#pragma region Index Coding
+	//Recently seen edges and vertices, the encoder and decoder update theirs the same way so they always agree
+	struct IndexCoderState
+	{
+		uint32_t edges[EDGE_FIFO_SIZE][2];
+		uint32_t edgeCount = 0;
+		uint32_t vertices[VERTEX_FIFO_SIZE];
+		uint32_t vertexCount = 0;
+		//Lowest vertex that hasn't been used yet
+		uint64_t next = 0;
+		//Last vertex that was next or explicit, explicit vertices are stored relative to it
+		int64_t last = 0;
+
+		void PushEdge(uint32_t a, uint32_t b)
+		{
+			edges[edgeCount % EDGE_FIFO_SIZE][0] = a;
+			edges[edgeCount % EDGE_FIFO_SIZE][1] = b;
+			edgeCount++;
+		}
+
+		//0 is the most recent
+		const uint32_t* GetEdge(uint32_t i) const
+		{
+			return edges[(edgeCount - 1 - i) % EDGE_FIFO_SIZE];
+		}
+
+		uint32_t GetEdgeCount() const
+		{
+			return std::min(edgeCount, EDGE_FIFO_SIZE);
+		}
+
+		void PushVertex(uint32_t v)
+		{
+			vertices[vertexCount % VERTEX_FIFO_SIZE] = v;
+			vertexCount++;
+		}
+
+		uint32_t GetVertex(uint32_t i) const
+		{
+			return vertices[(vertexCount - 1 - i) % VERTEX_FIFO_SIZE];
+		}
+
+		uint32_t GetVertexCount() const
+		{
+			return std::min(vertexCount, VERTEX_FIFO_SIZE);
+		}
+	};
+
+	uint8_t EncodeVertex(IndexCoderState& state, uint32_t v, std::vector<uint8_t>& extra)
+	{
+		if (v == state.next)
+		{
+			state.next++;
+			state.last = v;
+			state.PushVertex(v);
+			return VERTEX_NEXT;
+		}
+
+		for (uint32_t i = 0; i < state.GetVertexCount(); i++)
+		{
+			if (state.GetVertex(i) == v)
+			{
+				return static_cast<uint8_t>(VERTEX_NEXT + 1 + i);
+			}
+		}
+
+		const int64_t delta = static_cast<int64_t>(v) - state.last;
+		WriteVarint(extra, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+		state.next = std::max<uint64_t>(state.next, static_cast<uint64_t>(v) + 1);
+		state.last = v;
+		state.PushVertex(v);
+		return VERTEX_EXPLICIT;
+	}
+
+	uint32_t DecodeVertex(IndexCoderState& state, uint8_t code, const uint8_t*& extra, const uint8_t* extraEnd, uint64_t maxIndex)
+	{
+		if (code == VERTEX_NEXT)
+		{
+			if (state.next > maxIndex)
+			{
+				throw std::runtime_error("Compressed index is out of range!");
+			}
+
+			const uint32_t v = static_cast<uint32_t>(state.next++);
+			state.last = v;
+			state.PushVertex(v);
+			return v;
+		}
+
+		if (code < VERTEX_EXPLICIT)
+		{
+			const uint32_t i = code - VERTEX_NEXT - 1;
+			if (i >= state.GetVertexCount())
+			{
+				throw std::runtime_error("Compressed index refers to a vertex that hasn't been seen!");
+			}
+			return state.GetVertex(i);
+		}
+
+		if (code != VERTEX_EXPLICIT)
+		{
+			throw std::runtime_error("Compressed index has an unknown vertex code!");
+		}
+
+		const uint64_t zigzag = ReadVarint(extra, extraEnd);
+		const int64_t v = state.last + static_cast<int64_t>((zigzag >> 1) ^ (0 - (zigzag & 1)));
+		if (v < 0 || static_cast<uint64_t>(v) > maxIndex)
+		{
+			throw std::runtime_error("Compressed index is out of range!");
+		}
+
+		state.next = std::max<uint64_t>(state.next, static_cast<uint64_t>(v) + 1);
+		state.last = v;
+		state.PushVertex(static_cast<uint32_t>(v));
+		return static_cast<uint32_t>(v);
+	}
+#pragma endregion
+}
+
+//Each 16 bit lane is stored for the whole block before the next one, as the zigzagged difference from the same lane of the vertex before
+//After MeshOptimizer's fetch reordering neighbouring vertices are usually close, so most high bytes end up 0
+//Every lane gets its own low and high byte models, positions, UVs and normals don't move the same way
+void MeshCodec::EncodeVertexStream(const uint8_t* vertices, uint32_t vertexCount, uint32_t stride, std::vector<uint8_t>& output)
+{
+	if (stride % 2 != 0)
+	{
+		throw std::runtime_error("Vertex stride has to be a multiple of 2 to be compressed!");
+	}
+
+	EncodeBlocks(vertexCount, stride, SplitBlocks(vertexCount, BLOCK_VERTICES, {}), output, [&](BlockRange range, std::vector<uint8_t>& blockOutput)
+	{
+		std::vector<uint8_t> symbols(static_cast<size_t>(range.count) * 2);
+		for (uint32_t lane = 0; lane < stride / 2; lane++)
+		{
+			uint16_t previous = 0;
+			for (uint32_t i = 0; i < range.count; i++)
+			{
+				uint16_t value;
+				memcpy(&value, vertices + static_cast<size_t>(range.first + i) * stride + lane * 2, sizeof(value));
+				const uint16_t delta = ZigZag16(static_cast<uint16_t>(value - previous));
+				symbols[i * 2] = static_cast<uint8_t>(delta);
+				symbols[i * 2 + 1] = static_cast<uint8_t>(delta >> 8);
+				previous = value;
+			}
+
+			EncodeSymbols(symbols, 2, blockOutput);
+		}
+	});
+}
+
+size_t MeshCodec::DecodeVertexStream(const uint8_t* data, size_t size, uint8_t* destination, uint32_t vertexCount, uint32_t stride, JobSystem* jobSystem)
+{
+	return DecodeBlocks(data, size, vertexCount, stride, jobSystem, [&](BlockRange range, const uint8_t* blockData, const uint8_t* blockEnd)
+	{
+		std::vector<uint8_t> symbols;
+		for (uint32_t lane = 0; lane < stride / 2; lane++)
+		{
+			DecodeSymbols(blockData, blockEnd, 2, static_cast<size_t>(range.count) * 2, symbols);
+			if (symbols.size() != static_cast<size_t>(range.count) * 2)
+			{
+				throw std::runtime_error("Compressed vertex block has the wrong size!");
+			}
+
+			uint8_t* laneDestination = destination + static_cast<size_t>(range.first) * stride + lane * 2;
+			uint16_t previous = 0;
+			uint32_t i = 0;
+
+		#ifdef MESH_CODEC_SSE2
+			//Eight deltas at a time, undo the zigzag then a log step prefix sum turns them into values
+			const __m128i one = _mm_set1_epi16(1);
+			for (; i + 8 <= range.count; i += 8)
+			{
+				__m128i deltas = _mm_loadu_si128(reinterpret_cast<const __m128i*>(symbols.data() + i * 2));
+				deltas = _mm_xor_si128(_mm_srli_epi16(deltas, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(deltas, one)));
+				deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 2));
+				deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 4));
+				deltas = _mm_add_epi16(deltas, _mm_slli_si128(deltas, 8));
+				deltas = _mm_add_epi16(deltas, _mm_set1_epi16(static_cast<short>(previous)));
+
+				alignas(16) uint16_t values[8];
+				_mm_store_si128(reinterpret_cast<__m128i*>(values), deltas);
+				for (uint32_t k = 0; k < 8; k++)
+				{
+					memcpy(laneDestination + static_cast<size_t>(i + k) * stride, &values[k], sizeof(uint16_t));
+				}
+				previous = values[7];
+			}
+		#endif
+
+			for (; i < range.count; i++)
+			{
+				const uint16_t delta = static_cast<uint16_t>(symbols[i * 2] | (symbols[i * 2 + 1] << 8));
+				previous = static_cast<uint16_t>(previous + UnZigZag16(delta));
+				memcpy(laneDestination + static_cast<size_t>(i) * stride, &previous, sizeof(uint16_t));
+			}
+		}
+	});
+}
+
+//Triangles that share an edge with one of the last few triangles, which cache ordering makes most of them, only need that edge's FIFO position and their third vertex
+//Vertices are coded as the next one that hasn't been used yet, a position in a FIFO of recent vertices, or explicitly as a varint in a second stream
+//Every block and every submesh starts from empty FIFOs, 16 bit split submeshes number their vertices from 0 again
+//https://fgiesen.wordpress.com/2013/12/14/simple-lossless-index-buffer-compression/
+void MeshCodec::EncodeIndices(const uint32_t* indices, uint32_t indexCount, const std::vector<Submesh>& submeshes, std::vector<uint8_t>& output)
+{
+	if (indexCount % 3 != 0)
+	{
+		throw std::runtime_error("Only triangle lists can be compressed!");
+	}
+
+	std::vector<uint32_t> restarts;
+	for (const Submesh& submesh : submeshes)
+	{
+		if (submesh.firstIndex % 3 == 0 && submesh.firstIndex < indexCount)
+		{
+			restarts.push_back(submesh.firstIndex);
+		}
+	}
+
+	EncodeBlocks(indexCount, sizeof(uint32_t), SplitBlocks(indexCount, BLOCK_INDICES, restarts), output, [&](BlockRange range, std::vector<uint8_t>& blockOutput)
+	{
+		IndexCoderState state;
+		std::vector<uint8_t> codes;
+		std::vector<uint8_t> extra;
+		codes.reserve(range.count / 3);
+
+		for (uint32_t i = range.first; i < range.first + range.count; i += 3)
+		{
+			uint32_t triangle[3] = { indices[i], indices[i + 1], indices[i + 2] };
+
+			//Looks for the edge in every rotation of the triangle, the rotation found is the one written, which draws the same thing
+			uint32_t edge = EDGE_FIFO_SIZE;
+			for (uint32_t e = 0; e < state.GetEdgeCount() && edge == EDGE_FIFO_SIZE; e++)
+			{
+				for (uint32_t rotation = 0; rotation < 3; rotation++)
+				{
+					const uint32_t* fifoEdge = state.GetEdge(e);
+					if (fifoEdge[0] == triangle[0] && fifoEdge[1] == triangle[1])
+					{
+						edge = e;
+						break;
+					}
+					std::rotate(triangle, triangle + 1, triangle + 3);
+				}
+			}
+
+			const uint32_t a = triangle[0], b = triangle[1], c = triangle[2];
+			if (edge < EDGE_FIFO_SIZE)
+			{
+				codes.push_back(static_cast<uint8_t>(edge * 16 + EncodeVertex(state, c, extra)));
+			}
+			else
+			{
+				codes.push_back(TRIANGLE_MISS);
+				codes.push_back(EncodeVertex(state, a, extra));
+				codes.push_back(EncodeVertex(state, b, extra));
+				codes.push_back(EncodeVertex(state, c, extra));
+				state.PushEdge(b, a);
+			}
+
+			//Stored reversed, the neighbour across an edge goes along it the other way
+			state.PushEdge(c, b);
+			state.PushEdge(a, c);
+		}
+
+		EncodeSymbols(codes, 1, blockOutput);
+		EncodeSymbols(extra, 1, blockOutput);
+	});
+}
+
+size_t MeshCodec::DecodeIndices(const uint8_t* data, size_t size, uint8_t* destination, uint32_t indexCount, uint32_t indexStride, JobSystem* jobSystem)
+{
+	const uint64_t maxIndex = (indexStride == sizeof(uint16_t)) ? 0xFFFF : 0xFFFFFFFF;
+
+	//The stream records 4 byte indices whatever they are decoded to
+	return DecodeBlocks(data, size, indexCount, sizeof(uint32_t), jobSystem, [&](BlockRange range, const uint8_t* blockData, const uint8_t* blockEnd)
+	{
+		if (range.count % 3 != 0)
+		{
+			throw std::runtime_error("Compressed index block doesn't hold whole triangles!");
+		}
+
+		std::vector<uint8_t> codes;
+		std::vector<uint8_t> extra;
+		//At most a miss and three vertex codes per triangle, and a varint of up to 10 bytes per explicit vertex
+		DecodeSymbols(blockData, blockEnd, 1, static_cast<size_t>(range.count / 3) * 4, codes);
+		DecodeSymbols(blockData, blockEnd, 1, static_cast<size_t>(range.count) * 10, extra);
+
+		IndexCoderState state;
+		const uint8_t* code = codes.data();
+		const uint8_t* codeEnd = code + codes.size();
+		const uint8_t* extraData = extra.data();
+		const uint8_t* extraEnd = extraData + extra.size();
+
+		auto readCode = [&]()
+		{
+			if (code == codeEnd)
+			{
+				throw std::runtime_error("Compressed index block is truncated!");
+			}
+			return *code++;
+		};
+
+		for (uint32_t i = range.first; i < range.first + range.count; i += 3)
+		{
+			uint32_t a, b, c;
+			const uint8_t triangleCode = readCode();
+
+			if (triangleCode < TRIANGLE_MISS)
+			{
+				const uint32_t edge = triangleCode >> 4;
+				if (edge >= state.GetEdgeCount())
+				{
+					throw std::runtime_error("Compressed index refers to an edge that hasn't been seen!");
+				}
+
+				a = state.GetEdge(edge)[0];
+				b = state.GetEdge(edge)[1];
+				c = DecodeVertex(state, triangleCode & 15, extraData, extraEnd, maxIndex);
+			}
+			else
+			{
+				a = DecodeVertex(state, readCode(), extraData, extraEnd, maxIndex);
+				b = DecodeVertex(state, readCode(), extraData, extraEnd, maxIndex);
+				c = DecodeVertex(state, readCode(), extraData, extraEnd, maxIndex);
+				state.PushEdge(b, a);
+			}
+
+			state.PushEdge(c, b);
+			state.PushEdge(a, c);
+
+			const uint32_t triangle[3] = { a, b, c };
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				if (indexStride == sizeof(uint16_t))
+				{
+					const uint16_t index16 = static_cast<uint16_t>(triangle[k]);
+					memcpy(destination + (static_cast<size_t>(i) + k) * sizeof(uint16_t), &index16, sizeof(uint16_t));
+				}
+				else
+				{
+					memcpy(destination + (static_cast<size_t>(i) + k) * sizeof(uint32_t), &triangle[k], sizeof(uint32_t));
+				}
+			}
+		}
+	});
+}
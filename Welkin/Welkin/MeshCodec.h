@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "MeshCache.h"
+
+class JobSystem;
+
+//Lossless compression for the vertex and index sections of the mesh cache
+//Vertices are delta coded per 16 bit lane and triangles against recently seen edges and vertices, the small numbers that leaves are then rANS coded
+//Streams are split into blocks that decode on their own, so decoding spreads over the job system's workers
+//https://fgiesen.wordpress.com/2014/02/02/rans-notes/
+namespace MeshCodec
+{
+	//Appends the encoded stream to output, stride has to be a multiple of 2
+	void EncodeVertexStream(const uint8_t* vertices, uint32_t vertexCount, uint32_t stride, std::vector<uint8_t>& output);
+	//Returns how many bytes of data the stream used, so streams written back to back can be read one after the other
+	//Throws if the stream is corrupt or doesn't match vertexCount and stride
+	//Blocks are decoded with jobSystem->ParallelFor, or on the calling thread alone when it's null
+	size_t DecodeVertexStream(const uint8_t* data, size_t size, uint8_t* destination, uint32_t vertexCount, uint32_t stride, JobSystem* jobSystem = nullptr);
+
+	//Indices are relative to each submesh's vertexOffset, the submeshes are only used to restart the coding where the numbering does
+	void EncodeIndices(const uint32_t* indices, uint32_t indexCount, const std::vector<Submesh>& submeshes, std::vector<uint8_t>& output);
+	//Writes indexStride sized indices, 2 or 4 bytes, triangles can come back rotated but every one keeps its winding
+	size_t DecodeIndices(const uint8_t* data, size_t size, uint8_t* destination, uint32_t indexCount, uint32_t indexStride, JobSystem* jobSystem = nullptr);
+};
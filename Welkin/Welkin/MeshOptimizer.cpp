@@ -0,0 +1,413 @@
+#include "MeshOptimizer.h"
+#include "Helper.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//FIFO size used for the ACMR/ATVR numbers, close to what current hardware behaves like
+	const size_t ANALYZE_CACHE_SIZE = 16;
+	//LRU size the Forsyth scores are tuned for
+	const size_t FORSYTH_CACHE_SIZE = 32;
+	//How much worse ACMR is allowed to get to win back overdraw
+	const float OVERDRAW_THRESHOLD = 1.05f;
+
+	#pragma region Forsyth Scoring
+
+		const float CACHE_DECAY_POWER = 1.5f;
+		const float LAST_TRIANGLE_SCORE = 0.75f;
+		const float VALENCE_BOOST_SCALE = 2.0f;
+		const float VALENCE_BOOST_POWER = 0.5f;
+		const uint32_t MAX_VALENCE = 32;
+
+		struct ScoreTable
+		{
+			float cache[FORSYTH_CACHE_SIZE];
+			float valence[MAX_VALENCE];
+
+			ScoreTable()
+			{
+				for (size_t i = 0; i < FORSYTH_CACHE_SIZE; i++)
+				{
+					//The three most recent vertices are the triangle just drawn, using them again is good but not best
+					if (i < 3)
+					{
+						cache[i] = LAST_TRIANGLE_SCORE;
+					}
+					else
+					{
+						const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+						cache[i] = std::pow(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+					}
+				}
+
+				//Vertices with few triangles left are finished off first so they stop taking up cache
+				valence[0] = 0.0f;
+				for (uint32_t i = 1; i < MAX_VALENCE; i++)
+				{
+					valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+				}
+			}
+		};
+
+		const ScoreTable& GetScoreTable()
+		{
+			static const ScoreTable table;
+			return table;
+		}
+
+		inline float VertexScore(int cachePosition, uint32_t remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+			{
+				return -1.0f;
+			}
+
+			const ScoreTable& table = GetScoreTable();
+			const float cacheScore = (cachePosition < 0) ? 0.0f : table.cache[cachePosition];
+			return cacheScore + table.valence[std::min(remainingTriangles, MAX_VALENCE - 1)];
+		}
+
+	#pragma endregion
+
+	void ComputeTriangleCentroids(const uint32_t* indices, size_t triangleCount, const std::vector<Vertex>& vertices, std::vector<glm::vec3>& centroids, std::vector<glm::vec3>& normals)
+	{
+		centroids.resize(triangleCount);
+		normals.resize(triangleCount);
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			const glm::vec3& a = vertices[indices[t * 3 + 0]].position;
+			const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+
+			centroids[t] = (a + b + c) / 3.0f;
+			//Left unnormalised so bigger triangles count for more when summed into a cluster
+			normals[t] = glm::cross(b - a, c - a);
+		}
+	}
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	VertexCacheStats stats{};
+	if (indexCount < 3 || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	//Timestamp of when each vertex entered the FIFO, it's still there if that was less than a cache size ago
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	size_t time = ANALYZE_CACHE_SIZE + 1;
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		const uint32_t index = indices[i];
+
+		if (time - cacheTime[index] > ANALYZE_CACHE_SIZE)
+		{
+			cacheTime[index] = time++;
+			misses++;
+		}
+
+		if (!used[index])
+		{
+			used[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / (indexCount / 3);
+	stats.atvr = static_cast<float>(misses) / uniqueVertices;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	#pragma region Adjacency
+		//Every triangle that uses each vertex, packed into one array
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			remaining[indices[i]]++;
+		}
+
+		std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+		}
+
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> adjacencyFill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (size_t k = 0; k < 3; k++)
+			{
+				const uint32_t v = indices[t * 3 + k];
+				adjacency[adjacencyFill[v]++] = static_cast<uint32_t>(t);
+			}
+		}
+	#pragma endregion
+
+	#pragma region Scores
+		std::vector<float> vertexScore(vertexCount);
+		std::vector<int> cachePosition(vertexCount, -1);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			vertexScore[v] = VertexScore(-1, remaining[v]);
+		}
+
+		std::vector<float> triangleScore(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		}
+	#pragma endregion
+
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	//One extra slot for the vertices pushed out when a triangle is added
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	size_t cacheCount = 0;
+
+	//Used to find a fresh start when nothing in the cache has triangles left
+	size_t nextUnemitted = 0;
+	int64_t bestTriangle = 0;
+
+	for (size_t t = 1; t < triangleCount; t++)
+	{
+		if (triangleScore[t] > triangleScore[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	while (bestTriangle >= 0)
+	{
+		const uint32_t* triangle = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		#pragma region Update Cache
+			uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+			size_t newCacheCount = 0;
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				const uint32_t v = triangle[k];
+				newCache[newCacheCount++] = v;
+
+				//Take the triangle out of the vertex's adjacency list
+				uint32_t* begin = &adjacency[adjacencyOffset[v]];
+				uint32_t* end = begin + remaining[v];
+				*std::find(begin, end, static_cast<uint32_t>(bestTriangle)) = *(end - 1);
+				remaining[v]--;
+			}
+
+			for (size_t i = 0; i < cacheCount; i++)
+			{
+				const uint32_t v = cache[i];
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				{
+					newCache[newCacheCount++] = v;
+				}
+			}
+
+			std::copy(newCache, newCache + newCacheCount, cache);
+			cacheCount = std::min(newCacheCount, FORSYTH_CACHE_SIZE);
+		#pragma endregion
+
+		#pragma region Rescore
+			//Vertices that fell out of the cache need their scores updated too
+			for (size_t i = 0; i < newCacheCount; i++)
+			{
+				const uint32_t v = cache[i];
+				cachePosition[v] = (i < FORSYTH_CACHE_SIZE) ? static_cast<int>(i) : -1;
+				vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+			}
+
+			bestTriangle = -1;
+			float bestScore = -1.0f;
+
+			for (size_t i = 0; i < newCacheCount; i++)
+			{
+				const uint32_t v = cache[i];
+				for (uint32_t a = 0; a < remaining[v]; a++)
+				{
+					const uint32_t t = adjacency[adjacencyOffset[v] + a];
+					const float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+					triangleScore[t] = score;
+
+					if (score > bestScore)
+					{
+						bestScore = score;
+						bestTriangle = t;
+					}
+				}
+			}
+		#pragma endregion
+
+		//Nothing left that touches the cache, carry on from the first triangle not drawn yet
+		if (bestTriangle < 0)
+		{
+			while (nextUnemitted < triangleCount && emitted[nextUnemitted])
+			{
+				nextUnemitted++;
+			}
+
+			if (nextUnemitted < triangleCount)
+			{
+				bestTriangle = nextUnemitted;
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices, float threshold)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	const float acmrBefore = AnalyzeVertexCache(indices, indexCount, vertices.size()).acmr;
+
+	#pragma region Clusters
+		//A new cluster starts wherever the cache order had to start over, a triangle with no vertex in the cache
+		std::vector<size_t> clusterStarts;
+		std::vector<size_t> cacheTime(vertices.size(), 0);
+		size_t time = ANALYZE_CACHE_SIZE + 1;
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			size_t misses = 0;
+			for (size_t k = 0; k < 3; k++)
+			{
+				const uint32_t v = indices[t * 3 + k];
+				if (time - cacheTime[v] > ANALYZE_CACHE_SIZE)
+				{
+					cacheTime[v] = time++;
+					misses++;
+				}
+			}
+
+			if (t == 0 || misses == 3)
+			{
+				clusterStarts.push_back(t);
+			}
+		}
+
+		if (clusterStarts.size() < 2)
+		{
+			return;
+		}
+		clusterStarts.push_back(triangleCount);
+	#pragma endregion
+
+	#pragma region Sort
+		std::vector<glm::vec3> centroids;
+		std::vector<glm::vec3> normals;
+		ComputeTriangleCentroids(indices, triangleCount, vertices, centroids, normals);
+
+		glm::vec3 meshCenter(0.0f);
+		for (const auto& centroid : centroids)
+		{
+			meshCenter += centroid;
+		}
+		meshCenter /= static_cast<float>(triangleCount);
+
+		const size_t clusterCount = clusterStarts.size() - 1;
+		std::vector<float> sortKey(clusterCount);
+
+		for (size_t c = 0; c < clusterCount; c++)
+		{
+			glm::vec3 center(0.0f);
+			glm::vec3 normal(0.0f);
+
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+			{
+				center += centroids[t];
+				normal += normals[t];
+			}
+
+			center /= static_cast<float>(clusterStarts[c + 1] - clusterStarts[c]);
+			const float normalLength = glm::length(normal);
+
+			//Clusters facing away from the middle are the ones most likely to be in front, so they go first
+			sortKey[c] = (normalLength > 0.0f) ? glm::dot(center - meshCenter, normal / normalLength) : 0.0f;
+		}
+
+		std::vector<size_t> order(clusterCount);
+		for (size_t c = 0; c < clusterCount; c++)
+		{
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+	#pragma endregion
+
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	for (const size_t c : order)
+	{
+		output.insert(output.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+	}
+
+	if (AnalyzeVertexCache(output.data(), output.size(), vertices.size()).acmr <= acmrBefore * threshold)
+	{
+		std::copy(output.begin(), output.end(), indices);
+	}
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const uint32_t UNUSED = 0xFFFFFFFFu;
+	std::vector<uint32_t> remap(vertices.size(), UNUSED);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == UNUSED)
+		{
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+void MeshOptimizer::Optimize(MeshData& data)
+{
+	data.statsBefore = AnalyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+
+	//Submeshes are drawn separately, so each one is ordered on its own
+	for (const auto& submesh : data.submeshes)
+	{
+		uint32_t* indices = data.indices.data() + submesh.firstIndex;
+		OptimizeVertexCache(indices, submesh.indexCount, data.vertices.size());
+		OptimizeOverdraw(indices, submesh.indexCount, data.vertices, OVERDRAW_THRESHOLD);
+	}
+
+	OptimizeVertexFetch(data.vertices, data.indices);
+
+	data.statsAfter = AnalyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "MeshCache.h"
+
+//Import time reordering of a mesh for the GPU, only changes the order of triangles and vertices, never the shape
+//Runs once per import, the result is what gets written to the mesh cache
+namespace MeshOptimizer
+{
+	//Runs every pass below on each submesh and fills in statsBefore/statsAfter
+	void Optimize(MeshData& data);
+
+	//Forsyth's linear speed vertex cache optimisation, reorders triangles so vertices are reused while still in the post-transform cache
+	//https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+	//Splits the cache ordered triangles into clusters and sorts them front to back from the outside in, so early-Z rejects more
+	//Keeps the original order if that costs more than threshold times the ACMR
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices, float threshold);
+	//Renumbers vertices in the order they are first used so fetches walk forward through memory, drops unused vertices
+	void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount);
+};
@@ -0,0 +1,300 @@
+#include "MeshQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+namespace
+{
+	//Vertices one 16 bit index range can reach
+	const size_t MAX_16_BIT_VERTICES = 65536;
+	const uint32_t UNUSED = 0xFFFFFFFFu;
+
+	inline int16_t FloatToSnorm16(float value)
+	{
+		return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	inline float Snorm16ToFloat(int16_t value)
+	{
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	inline float SignNotZero(float value)
+	{
+		return (value >= 0.0f) ? 1.0f : -1.0f;
+	}
+}
+
+uint16_t MeshQuantizer::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000u;
+	const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFFu) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFFu;
+
+	//NaN and infinity
+	if (((bits >> 23) & 0xFFu) == 0xFFu)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+	}
+	//Too big, clamp to infinity
+	if (exponent >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00u);
+	}
+	//Too small for a normal half, make a denormal or zero
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+
+		mantissa |= 0x800000u;
+		const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		//Round to nearest even
+		const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		const uint32_t halfway = 1u << (shift - 1u);
+		if (remainder > halfway || (remainder == halfway && (half & 1u)))
+		{
+			half++;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	//Round to nearest even, a carry into the exponent is still correct
+	const uint32_t remainder = mantissa & 0x1FFFu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+	{
+		half++;
+	}
+	return static_cast<uint16_t>(half);
+}
+
+float MeshQuantizer::HalfToFloat(uint16_t value)
+{
+	const uint32_t sign = (value & 0x8000u) << 16;
+	uint32_t exponent = (value >> 10) & 0x1Fu;
+	uint32_t mantissa = value & 0x3FFu;
+	uint32_t bits;
+
+	if (exponent == 0x1Fu)
+	{
+		bits = sign | 0x7F800000u | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)
+	{
+		bits = sign;
+	}
+	else
+	{
+		//Denormal, shift it up into a normal float
+		exponent = 127 - 15 + 1;
+		while ((mantissa & 0x400u) == 0)
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void MeshQuantizer::EncodeOctahedral(const glm::vec3& direction, int16_t encoded[2])
+{
+	const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+
+	//Unset tangents are all zero, they decode to +Z
+	if (length <= FLT_EPSILON)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = direction.x / length;
+	float y = direction.y / length;
+
+	//Fold the lower hemisphere over the diagonals
+	if (direction.z < 0.0f)
+	{
+		const float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+		const float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = FloatToSnorm16(x);
+	encoded[1] = FloatToSnorm16(y);
+}
+
+glm::vec3 MeshQuantizer::DecodeOctahedral(const int16_t encoded[2])
+{
+	glm::vec3 direction(Snorm16ToFloat(encoded[0]), Snorm16ToFloat(encoded[1]), 0.0f);
+	direction.z = 1.0f - std::abs(direction.x) - std::abs(direction.y);
+
+	const float t = std::max(-direction.z, 0.0f);
+	direction.x += (direction.x >= 0.0f) ? -t : t;
+	direction.y += (direction.y >= 0.0f) ? -t : t;
+
+	return glm::normalize(direction);
+}
+
+void MeshQuantizer::Quantize(MeshData& data)
+{
+	glm::vec3 minPosition(FLT_MAX);
+	glm::vec3 maxPosition(-FLT_MAX);
+
+	for (const auto& vertex : data.vertices)
+	{
+		minPosition = glm::min(minPosition, vertex.position);
+		maxPosition = glm::max(maxPosition, vertex.position);
+	}
+
+	data.positionOffset = minPosition;
+	data.positionScale = maxPosition - minPosition;
+
+	//Flat meshes still need something to divide by
+	for (int i = 0; i < 3; i++)
+	{
+		if (data.positionScale[i] <= 0.0f)
+		{
+			data.positionScale[i] = 1.0f;
+		}
+	}
+
+	data.compactVertices.resize(data.vertices.size());
+
+	for (size_t v = 0; v < data.vertices.size(); v++)
+	{
+		const Vertex& vertex = data.vertices[v];
+		CompactVertex& compact = data.compactVertices[v];
+
+		for (int i = 0; i < 3; i++)
+		{
+			const float normalized = (vertex.position[i] - data.positionOffset[i]) / data.positionScale[i];
+			compact.position[i] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+		}
+		compact.position[3] = (vertex.tangent.w < 0.0f) ? 0 : 65535;
+
+		compact.UV[0] = FloatToHalf(vertex.UV.x);
+		compact.UV[1] = FloatToHalf(vertex.UV.y);
+
+		EncodeOctahedral(vertex.normal, compact.normal);
+		EncodeOctahedral(glm::vec3(vertex.tangent), compact.tangent);
+	}
+
+	data.vertexFormat = VertexFormat::COMPACT;
+}
+
+void MeshQuantizer::QuantizeIndices(MeshData& data)
+{
+	//Almost every prop fits in one range, nothing needs to move
+	if (data.vertices.size() <= MAX_16_BIT_VERTICES)
+	{
+		data.indices16.assign(data.indices.begin(), data.indices.end());
+		data.indexType = VK_INDEX_TYPE_UINT16;
+		return;
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<Submesh> submeshes;
+	vertices.reserve(data.vertices.size());
+	indices.reserve(data.indices.size());
+
+	//Where each source vertex went in the current vertex range
+	std::vector<uint32_t> remap(data.vertices.size(), UNUSED);
+	std::vector<uint32_t> blockVertices;
+	//First piece each old submesh turned into, so the LODs can be pointed at the new ranges
+	std::vector<uint32_t> firstPiece;
+
+	//Vertex range the current pieces index into, following submeshes keep using it while it has room
+	uint32_t blockOffset = 0;
+
+	for (const auto& submesh : data.submeshes)
+	{
+		firstPiece.push_back(static_cast<uint32_t>(submeshes.size()));
+		Submesh piece{ static_cast<uint32_t>(indices.size()), 0, blockOffset };
+
+		for (uint32_t i = 0; i + 2 < submesh.indexCount; i += 3)
+		{
+			const uint32_t* triangle = &data.indices[submesh.firstIndex + i];
+
+			size_t newVertices = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				const bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+				if (remap[triangle[k]] == UNUSED && !repeated)
+				{
+					newVertices++;
+				}
+			}
+
+			//Doesn't fit, close this piece and start a new one with a fresh vertex range
+			if (blockVertices.size() + newVertices > MAX_16_BIT_VERTICES)
+			{
+				if (piece.indexCount > 0)
+				{
+					submeshes.push_back(piece);
+				}
+
+				blockOffset = static_cast<uint32_t>(vertices.size());
+				piece = { static_cast<uint32_t>(indices.size()), 0, blockOffset };
+
+				for (const uint32_t v : blockVertices)
+				{
+					remap[v] = UNUSED;
+				}
+				blockVertices.clear();
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				const uint32_t v = triangle[k];
+				if (remap[v] == UNUSED)
+				{
+					remap[v] = static_cast<uint32_t>(blockVertices.size());
+					blockVertices.push_back(v);
+					vertices.push_back(data.vertices[v]);
+				}
+
+				indices.push_back(remap[v]);
+			}
+
+			piece.indexCount += 3;
+		}
+
+		if (piece.indexCount > 0)
+		{
+			submeshes.push_back(piece);
+		}
+	}
+
+	firstPiece.push_back(static_cast<uint32_t>(submeshes.size()));
+
+	for (auto& lod : data.lods)
+	{
+		const uint32_t first = firstPiece[lod.firstSubmesh];
+		lod.submeshCount = firstPiece[lod.firstSubmesh + lod.submeshCount] - first;
+		lod.firstSubmesh = first;
+	}
+
+	data.vertices.swap(vertices);
+	data.indices.swap(indices);
+	data.submeshes.swap(submeshes);
+	data.indices16.assign(data.indices.begin(), data.indices.end());
+	data.indexType = VK_INDEX_TYPE_UINT16;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "MeshCache.h"
+
+//Packs Vertex into CompactVertex for meshes that use VertexFormat::COMPACT, and indices into 16 bits
+//Positions are quantized against the mesh's bounding box, so precision scales with the size of the mesh instead of with distance from its origin
+namespace MeshQuantizer
+{
+	//Fills compactVertices, positionScale and positionOffset from vertices and sets the format to COMPACT
+	void Quantize(MeshData& data);
+	//Switches the mesh to 16 bit indices, splitting submeshes that reference more than 65536 vertices
+	//Needs every submesh's vertexOffset to still be 0, split pieces get their own copy of the vertices they share
+	//LOD ranges are updated to cover the pieces their submeshes were split into
+	void QuantizeIndices(MeshData& data);
+
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+
+	//https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+	void EncodeOctahedral(const glm::vec3& direction, int16_t encoded[2]);
+	glm::vec3 DecodeOctahedral(const int16_t encoded[2]);
+};
@@ -0,0 +1,444 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+namespace
+{
+	//Each level aims for this fraction of the triangles of the level before
+	const float LOD_REDUCTION = 0.5f;
+	//Stop adding levels once one doesn't get below this fraction of the last
+	const float LOD_MIN_PROGRESS = 0.85f;
+	const size_t LOD_MIN_TRIANGLES = 16;
+
+	//Keeps open edges from shrinking, relative to the weight of the faces next to them
+	const double BORDER_WEIGHT = 10.0;
+	//How much UV and normal differences add to a collapse's cost, scaled by the mesh's size so it compares with the geometric error
+	const float UV_WEIGHT = 1.0f;
+	const float NORMAL_WEIGHT = 0.5f;
+	//A triangle may turn at most 60 degrees in one collapse, stops slivers folding over
+	const float MIN_NORMAL_COSINE = 0.5f;
+
+	enum class VertexKind : uint8_t
+	{
+		//Surrounded by triangles, can collapse into any neighbour
+		MANIFOLD,
+		//On an open edge, can only slide along it
+		BORDER,
+		//On a seam or non-manifold edge, never moves but others can collapse into it
+		LOCKED
+	};
+
+	//Symmetric 4x4 matrix, weighted sum of squared distances to a set of planes
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0, c = 0;
+		double weight = 0;
+
+		void AddPlane(double nx, double ny, double nz, double d, double weight)
+		{
+			a00 += weight * nx * nx; a01 += weight * nx * ny; a02 += weight * nx * nz;
+			a11 += weight * ny * ny; a12 += weight * ny * nz; a22 += weight * nz * nz;
+			b0 += weight * nx * d; b1 += weight * ny * d; b2 += weight * nz * d;
+			c += weight * d * d;
+			this->weight += weight;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02;
+			a11 += other.a11; a12 += other.a12; a22 += other.a22;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		//Weighted mean squared distance, so its square root is a distance in model space
+		double Evaluate(const glm::vec3& p) const
+		{
+			if (weight <= 0)
+			{
+				return 0;
+			}
+
+			const double x = p.x, y = p.y, z = p.z;
+			const double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + a11 * y * y + 2 * a12 * y * z + a22 * z * z
+				+ 2 * (b0 * x + b1 * y + b2 * z) + c;
+			return std::max(result / weight, 0.0);
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		//Geometric error only, the attribute penalty just changes the order
+		float error;
+		float cost;
+	};
+
+	inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	glm::vec3 TriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+
+	//Vertices that share a position with another vertex are UV or normal seams
+	void FindSeams(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<VertexKind>& kinds)
+	{
+		std::unordered_map<uint64_t, uint32_t> firstAtPosition;
+		firstAtPosition.reserve(indices.size());
+
+		for (const uint32_t index : indices)
+		{
+			uint32_t bits[3];
+			memcpy(bits, &vertices[index].position, sizeof(bits));
+			const uint64_t key = (static_cast<uint64_t>(bits[0]) * 0x9E3779B97F4A7C15ull) ^ (static_cast<uint64_t>(bits[1]) * 0xBF58476D1CE4E5B9ull) ^ bits[2];
+
+			auto found = firstAtPosition.find(key);
+			if (found == firstAtPosition.end())
+			{
+				firstAtPosition.emplace(key, index);
+			}
+			else if (found->second != index)
+			{
+				kinds[index] = VertexKind::LOCKED;
+				kinds[found->second] = VertexKind::LOCKED;
+			}
+		}
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t targetIndexCount)
+{
+	const size_t vertexCount = vertices.size();
+	std::vector<VertexKind> kinds(vertexCount, VertexKind::MANIFOLD);
+	std::vector<Quadric> quadrics(vertexCount);
+
+	FindSeams(vertices, indices, kinds);
+
+	glm::vec3 minPosition(FLT_MAX);
+	glm::vec3 maxPosition(-FLT_MAX);
+	for (const uint32_t index : indices)
+	{
+		minPosition = glm::min(minPosition, vertices[index].position);
+		maxPosition = glm::max(maxPosition, vertices[index].position);
+	}
+	const float meshSize = std::max(glm::length(maxPosition - minPosition), FLT_EPSILON);
+
+	#pragma region Quadrics
+		//Directed edge -> how many triangles use it that way round, finds open and non-manifold edges
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		edgeUses.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				edgeUses[EdgeKey(indices[i + k], indices[i + (k + 1) % 3])]++;
+			}
+		}
+
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const glm::vec3& p0 = vertices[indices[i]].position;
+			const glm::vec3& p1 = vertices[indices[i + 1]].position;
+			const glm::vec3& p2 = vertices[indices[i + 2]].position;
+
+			const glm::vec3 normal = TriangleNormal(p0, p1, p2);
+			const float doubleArea = glm::length(normal);
+			if (doubleArea <= 0.0f)
+			{
+				continue;
+			}
+
+			const glm::vec3 n = normal / doubleArea;
+			const double d = -glm::dot(n, p0);
+
+			for (int k = 0; k < 3; k++)
+			{
+				quadrics[indices[i + k]].AddPlane(n.x, n.y, n.z, d, doubleArea * 0.5);
+			}
+
+			//Open edges get a plane through them at right angles to the face, so they keep their outline
+			for (int k = 0; k < 3; k++)
+			{
+				const uint32_t a = indices[i + k];
+				const uint32_t b = indices[i + (k + 1) % 3];
+				const uint32_t forward = edgeUses[EdgeKey(a, b)];
+				const auto backward = edgeUses.find(EdgeKey(b, a));
+
+				if (forward > 1 || (backward != edgeUses.end() && backward->second > 1))
+				{
+					kinds[a] = VertexKind::LOCKED;
+					kinds[b] = VertexKind::LOCKED;
+					continue;
+				}
+
+				if (backward == edgeUses.end())
+				{
+					const glm::vec3 edge = vertices[b].position - vertices[a].position;
+					const float edgeLength = glm::length(edge);
+					if (edgeLength <= 0.0f)
+					{
+						continue;
+					}
+
+					const glm::vec3 borderNormal = glm::normalize(glm::cross(edge, n));
+					const double borderD = -glm::dot(borderNormal, vertices[a].position);
+					const double weight = BORDER_WEIGHT * edgeLength * edgeLength;
+
+					quadrics[a].AddPlane(borderNormal.x, borderNormal.y, borderNormal.z, borderD, weight);
+					quadrics[b].AddPlane(borderNormal.x, borderNormal.y, borderNormal.z, borderD, weight);
+
+					for (const uint32_t v : { a, b })
+					{
+						if (kinds[v] == VertexKind::MANIFOLD)
+						{
+							kinds[v] = VertexKind::BORDER;
+						}
+					}
+				}
+			}
+		}
+	#pragma endregion
+
+	float maxError = 0.0f;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+
+	while (indices.size() > targetIndexCount)
+	{
+		const size_t triangleCount = indices.size() / 3;
+
+		#pragma region Adjacency
+			std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+			for (const uint32_t index : indices)
+			{
+				adjacencyOffset[index + 1]++;
+			}
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				adjacencyOffset[v + 1] += adjacencyOffset[v];
+			}
+
+			adjacency.resize(indices.size());
+			std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+				}
+			}
+		#pragma endregion
+
+		#pragma region Candidates
+			collapses.clear();
+
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					const uint32_t a = indices[t * 3 + k];
+					const uint32_t b = indices[t * 3 + (k + 1) % 3];
+
+					//Every manifold edge shows up twice, once each way round, so each direction only gets looked at once
+					//Open edges only show up once, so they try both directions here
+					const bool border = (kinds[a] == VertexKind::BORDER || kinds[b] == VertexKind::BORDER);
+
+					for (int direction = 0; direction < (border ? 2 : 1); direction++)
+					{
+						const uint32_t from = direction ? b : a;
+						const uint32_t to = direction ? a : b;
+
+						if (kinds[from] == VertexKind::LOCKED)
+						{
+							continue;
+						}
+						//Border vertices only slide along open edges, this one is open if nothing uses it the other way
+						if (kinds[from] == VertexKind::BORDER && (kinds[to] == VertexKind::MANIFOLD || edgeUses.count(EdgeKey(b, a)) != 0))
+						{
+							continue;
+						}
+
+						Quadric combined = quadrics[from];
+						combined.Add(quadrics[to]);
+						const float error = static_cast<float>(std::sqrt(combined.Evaluate(vertices[to].position)));
+
+						const glm::vec2 uvDifference = vertices[from].UV - vertices[to].UV;
+						const float normalDifference = 1.0f - glm::dot(vertices[from].normal, vertices[to].normal);
+						const float attributeCost = meshSize * (UV_WEIGHT * glm::length(uvDifference) + NORMAL_WEIGHT * std::max(normalDifference, 0.0f));
+
+						collapses.push_back({ from, to, error, error + attributeCost });
+					}
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+		#pragma endregion
+
+		#pragma region Collapse
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				remap[v] = static_cast<uint32_t>(v);
+			}
+			std::fill(touched.begin(), touched.end(), false);
+
+			//Each collapse removes about two triangles, don't overshoot the target by much
+			const size_t collapseLimit = (indices.size() - targetIndexCount) / 6 + 1;
+			size_t collapseCount = 0;
+
+			for (const auto& collapse : collapses)
+			{
+				if (collapseCount >= collapseLimit)
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to])
+				{
+					continue;
+				}
+
+				//Moving the vertex mustn't flip or fold any triangle around it
+				bool flips = false;
+				for (uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1] && !flips; a++)
+				{
+					const uint32_t* triangle = &indices[adjacency[a] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					{
+						continue;
+					}
+
+					glm::vec3 before[3];
+					glm::vec3 after[3];
+					for (int k = 0; k < 3; k++)
+					{
+						before[k] = vertices[triangle[k]].position;
+						after[k] = (triangle[k] == collapse.from) ? vertices[collapse.to].position : before[k];
+					}
+
+					const glm::vec3 normalBefore = TriangleNormal(before[0], before[1], before[2]);
+					const glm::vec3 normalAfter = TriangleNormal(after[0], after[1], after[2]);
+					flips = glm::dot(normalBefore, normalAfter) <= MIN_NORMAL_COSINE * glm::length(normalBefore) * glm::length(normalAfter);
+				}
+
+				if (flips)
+				{
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				maxError = std::max(maxError, collapse.error);
+				collapseCount++;
+
+				//Everything around the moved vertex is off limits until the next pass, the flip test above relied on it
+				for (uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; a++)
+				{
+					const uint32_t* triangle = &indices[adjacency[a] * 3];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				}
+				touched[collapse.to] = true;
+			}
+
+			if (collapseCount == 0)
+			{
+				break;
+			}
+		#pragma endregion
+
+		#pragma region Rebuild
+			size_t write = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const uint32_t a = remap[indices[i]];
+				const uint32_t b = remap[indices[i + 1]];
+				const uint32_t c = remap[indices[i + 2]];
+
+				if (a != b && b != c && a != c)
+				{
+					indices[write++] = a;
+					indices[write++] = b;
+					indices[write++] = c;
+				}
+			}
+			indices.resize(write);
+
+			edgeUses.clear();
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					edgeUses[EdgeKey(indices[i + k], indices[i + (k + 1) % 3])]++;
+				}
+			}
+		#pragma endregion
+	}
+
+	return maxError;
+}
+
+void MeshSimplifier::BuildLods(MeshData& data, uint32_t levelCount)
+{
+	data.lods.clear();
+	data.lods.push_back({ 0, static_cast<uint32_t>(data.submeshes.size()), 0.0f });
+
+	for (uint32_t level = 1; level < levelCount; level++)
+	{
+		const MeshLod previous = data.lods.back();
+		MeshLod lod{ static_cast<uint32_t>(data.submeshes.size()), 0, previous.error };
+
+		size_t previousIndexCount = 0;
+		size_t indexCount = 0;
+		std::vector<Submesh> submeshes;
+		std::vector<uint32_t> lodIndices;
+
+		//Each level is simplified from the last one, much cheaper than starting from LOD 0 every time
+		for (uint32_t s = previous.firstSubmesh; s < previous.firstSubmesh + previous.submeshCount; s++)
+		{
+			const Submesh source = data.submeshes[s];
+			std::vector<uint32_t> indices(data.indices.begin() + source.firstIndex, data.indices.begin() + source.firstIndex + source.indexCount);
+			previousIndexCount += indices.size();
+
+			const size_t target = static_cast<size_t>(indices.size() / 3 * LOD_REDUCTION) * 3;
+			const float error = Simplify(data.vertices, indices, target);
+
+			//Errors of successive levels add up at worst
+			lod.error = std::max(lod.error, previous.error + error);
+
+			if (!indices.empty())
+			{
+				MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), data.vertices.size());
+				submeshes.push_back({ static_cast<uint32_t>(data.indices.size() + lodIndices.size()), static_cast<uint32_t>(indices.size()), 0 });
+				lodIndices.insert(lodIndices.end(), indices.begin(), indices.end());
+				indexCount += indices.size();
+			}
+		}
+
+		if (indexCount == 0 || indexCount > previousIndexCount * LOD_MIN_PROGRESS)
+		{
+			break;
+		}
+
+		lod.submeshCount = static_cast<uint32_t>(submeshes.size());
+		data.submeshes.insert(data.submeshes.end(), submeshes.begin(), submeshes.end());
+		data.indices.insert(data.indices.end(), lodIndices.begin(), lodIndices.end());
+		data.lods.push_back(lod);
+
+		if (indexCount / 3 < LOD_MIN_TRIANGLES)
+		{
+			break;
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "MeshCache.h"
+
+//Quadric error metric edge collapse (Garland & Heckbert), used to build LODs at import
+//https://www.cs.cmu.edu/~garland/Papers/quadrics.pdf
+//Collapses only ever move a vertex onto one of its neighbours, so every LOD indexes the same vertex buffer
+namespace MeshSimplifier
+{
+	//Collapses edges until there are at most targetIndexCount indices, or nothing else can go without tearing or folding the surface
+	//Vertices on UV/normal seams stay put, and differences in UV and normal make a collapse cost more
+	//Returns the largest distance the surface moved, in model space units
+	float Simplify(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t targetIndexCount);
+
+	//Fills lods with LOD 0 plus up to levelCount - 1 simplified levels, each about half the triangles of the one before
+	//Their indices and submeshes are appended after LOD 0's, vertexOffset must still be 0
+	void BuildLods(MeshData& data, uint32_t levelCount);
+};
@@ -0,0 +1,164 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+namespace
+{
+	//Same limits NVIDIA recommends for mesh shaders, small enough that most meshlets end up facing one way
+	const uint32_t MESHLET_MAX_VERTICES = 64;
+	const uint32_t MESHLET_MAX_TRIANGLES = 124;
+	//Cones wider than this (about 84 degrees from the axis) would almost never cull anything
+	const float MIN_CONE_DOT = 0.1f;
+
+	glm::vec3 GetPosition(const MeshData& data, const Submesh& submesh, uint32_t index)
+	{
+		return data.vertices[submesh.vertexOffset + data.indices[index]].position;
+	}
+
+	void CalculateMeshletBounds(const MeshData& data, const Submesh& submesh, Meshlet& meshlet)
+	{
+		glm::vec3 minPosition(FLT_MAX);
+		glm::vec3 maxPosition(-FLT_MAX);
+
+		for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++)
+		{
+			const glm::vec3 position = GetPosition(data, submesh, i);
+			minPosition = glm::min(minPosition, position);
+			maxPosition = glm::max(maxPosition, position);
+		}
+
+		const glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+		float radius = 0.0f;
+		for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++)
+		{
+			radius = std::max(radius, glm::length(GetPosition(data, submesh, i) - center));
+		}
+
+		#pragma region Normal Cone
+			glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+			uint32_t normalCount = 0;
+			glm::vec3 axis(0.0f);
+
+			for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+			{
+				const glm::vec3 p0 = GetPosition(data, submesh, i);
+				const glm::vec3 normal = glm::cross(GetPosition(data, submesh, i + 1) - p0, GetPosition(data, submesh, i + 2) - p0);
+				const float length = glm::length(normal);
+
+				//Degenerate triangles are never drawn, so they don't get a say in the cone
+				if (length > FLT_EPSILON)
+				{
+					normals[normalCount++] = normal / length;
+					axis += normal / length;
+				}
+			}
+
+			float minDot = 1.0f;
+			if (normalCount > 0 && glm::length(axis) > FLT_EPSILON)
+			{
+				axis = glm::normalize(axis);
+				for (uint32_t n = 0; n < normalCount; n++)
+				{
+					minDot = std::min(minDot, glm::dot(axis, normals[n]));
+				}
+			}
+			else
+			{
+				minDot = -1.0f;
+			}
+
+			//Sine of the cone's half angle, the test in MeshletCull.comp works on its complement
+			const float cutoff = (minDot <= MIN_CONE_DOT) ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+		#pragma endregion
+
+		for (int i = 0; i < 3; i++)
+		{
+			meshlet.center[i] = center[i];
+			meshlet.coneAxis[i] = axis[i];
+		}
+		meshlet.radius = radius;
+		meshlet.coneCutoff = cutoff;
+	}
+}
+
+void MeshletBuilder::BuildMeshlets(MeshData& data, uint32_t minTriangles)
+{
+	data.meshlets.clear();
+
+	//Stamp per vertex of the meshlet that last used it, saves clearing a set for every meshlet
+	std::vector<uint32_t> vertexStamps(data.vertices.size(), UINT32_MAX);
+	uint32_t stamp = 0;
+
+	for (auto& lod : data.lods)
+	{
+		lod.firstMeshlet = static_cast<uint32_t>(data.meshlets.size());
+		lod.meshletCount = 0;
+
+		uint32_t triangleCount = 0;
+		for (uint32_t s = lod.firstSubmesh; s < lod.firstSubmesh + lod.submeshCount; s++)
+		{
+			triangleCount += data.submeshes[s].indexCount / 3;
+		}
+
+		if (triangleCount < minTriangles)
+		{
+			continue;
+		}
+
+		for (uint32_t s = lod.firstSubmesh; s < lod.firstSubmesh + lod.submeshCount; s++)
+		{
+			const Submesh& submesh = data.submeshes[s];
+			Meshlet meshlet{};
+			meshlet.firstIndex = submesh.firstIndex;
+			meshlet.vertexOffset = submesh.vertexOffset;
+			uint32_t meshletVertices = 0;
+
+			//Stamps the triangle's vertices and returns how many weren't in the meshlet yet
+			auto addTriangleVertices = [&](uint32_t i)
+			{
+				uint32_t newVertices = 0;
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					uint32_t& vertexStamp = vertexStamps[submesh.vertexOffset + data.indices[i + k]];
+					if (vertexStamp != stamp)
+					{
+						vertexStamp = stamp;
+						newVertices++;
+					}
+				}
+				return newVertices;
+			};
+
+			for (uint32_t i = submesh.firstIndex; i + 2 < submesh.firstIndex + submesh.indexCount; i += 3)
+			{
+				uint32_t newVertices = addTriangleVertices(i);
+
+				if (meshletVertices + newVertices > MESHLET_MAX_VERTICES || meshlet.indexCount / 3 == MESHLET_MAX_TRIANGLES)
+				{
+					CalculateMeshletBounds(data, submesh, meshlet);
+					data.meshlets.push_back(meshlet);
+
+					//Triangle starts the next meshlet instead
+					meshlet.firstIndex = i;
+					meshlet.indexCount = 0;
+					meshletVertices = 0;
+					stamp++;
+					newVertices = addTriangleVertices(i);
+				}
+
+				meshletVertices += newVertices;
+				meshlet.indexCount += 3;
+			}
+
+			if (meshlet.indexCount > 0)
+			{
+				CalculateMeshletBounds(data, submesh, meshlet);
+				data.meshlets.push_back(meshlet);
+			}
+			stamp++;
+		}
+
+		lod.meshletCount = static_cast<uint32_t>(data.meshlets.size()) - lod.firstMeshlet;
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "MeshCache.h"
+
+//Cuts a mesh's triangles into meshlets, each small enough that culling it on its own is worth it
+//Meshlets are contiguous runs of the index buffer, so the vertex cache order from MeshOptimizer is kept and no indices are rewritten
+namespace MeshletBuilder
+{
+	//Fills meshlets and each LOD's meshlet range from vertices, indices and submeshes, vertices must still be full precision
+	//LODs with fewer than minTriangles triangles are left without meshlets and drawn whole
+	void BuildMeshlets(MeshData& data, uint32_t minTriangles);
+};
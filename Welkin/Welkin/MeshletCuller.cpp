@@ -0,0 +1,316 @@
+#include "MeshletCuller.h"
+
+MeshletCuller::MeshletCuller(VulkanCore* vCore, FileManager* fm) : vCore{ vCore }, fm{ fm }
+{
+	device = vCore->GetLogicalDevice();
+
+	size_t meshletCount = 0;
+	for (auto& mesh : *fm->GetAllMeshes())
+	{
+		meshletCount += mesh.second->GetMeshlets().size();
+	}
+
+	if (meshletCount == 0)
+	{
+		return;
+	}
+
+	VkShaderModule* shaderModule = fm->TryFindShaderModule("(C)MeshletCullComp.spv");
+	if (shaderModule == nullptr)
+	{
+		Helper::Warning("(C)MeshletCullComp.spv not found, meshes are drawn without meshlet culling");
+		return;
+	}
+
+	//Each object's meshlets are one indirect call, with or without the count extension
+	if (!vCore->IsMultiDrawIndirectEnabled())
+	{
+		Helper::Warning("Device doesn't support multiDrawIndirect, meshes are drawn without meshlet culling");
+		return;
+	}
+
+	Helper::Cout("Creating Meshlet Culler");
+	enabled = true;
+
+	if (vCore->IsDrawIndirectCountEnabled())
+	{
+		cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(*device, "vkCmdDrawIndexedIndirectCountKHR"));
+	}
+
+	maxDrawsPerJob = vCore->GetPhysicalDeviceProperties().limits.maxDrawIndirectCount;
+	jobs.reserve(Welkin_Settings::MAX_OBJECTS);
+
+	CreateMeshletBuffer();
+	CreateFrameBuffers();
+	CreateDescriptorSetLayout();
+	CreateDescriptorPool();
+	CreateDescriptorSets();
+	CreatePipeline(shaderModule);
+}
+
+MeshletCuller::~MeshletCuller()
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	vkDestroyPipeline(*device, pipeline, nullptr);
+	vkDestroyPipelineLayout(*device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(*device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(*device, descriptorSetLayout, nullptr);
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		vkDestroyBuffer(*device, jobBuffers[i], nullptr);
+		vkFreeMemory(*device, jobBufferMemory[i], nullptr);
+		vkDestroyBuffer(*device, drawBuffers[i], nullptr);
+		vkFreeMemory(*device, drawBufferMemory[i], nullptr);
+		vkDestroyBuffer(*device, countBuffers[i], nullptr);
+		vkFreeMemory(*device, countBufferMemory[i], nullptr);
+	}
+
+	vkDestroyBuffer(*device, meshletBuffer, nullptr);
+	vkFreeMemory(*device, meshletBufferMemory, nullptr);
+}
+
+#pragma region Setup
+
+void MeshletCuller::CreateMeshletBuffer()
+{
+	std::vector<Meshlet> allMeshlets;
+
+	for (auto& mesh : *fm->GetAllMeshes())
+	{
+		meshletBases[mesh.second] = static_cast<uint32_t>(allMeshlets.size());
+		allMeshlets.insert(allMeshlets.end(), mesh.second->GetMeshlets().begin(), mesh.second->GetMeshlets().end());
+	}
+
+	vCore->CreateDeviceLocalBuffer(allMeshlets.data(), allMeshlets.size() * sizeof(Meshlet), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, meshletBuffer, meshletBufferMemory);
+	Helper::Cout("- Meshlet Buffer Created, " + std::to_string(allMeshlets.size()) + " Meshlets");
+}
+
+void MeshletCuller::CreateFrameBuffers()
+{
+	jobBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	jobBufferMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	drawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	drawBufferMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	countBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	countBufferMemory.resize(MAX_FRAMES_IN_FLIGHT);
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		vCore->CreateBuffer(sizeof(MeshletCullFrame) + sizeof(MeshletCullJob) * Welkin_Settings::MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, jobBuffers[i], jobBufferMemory[i]);
+		vCore->CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * Welkin_Settings::MESHLET_MAX_DRAWS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawBuffers[i], drawBufferMemory[i]);
+		vCore->CreateBuffer(sizeof(uint32_t) * Welkin_Settings::MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, countBuffers[i], countBufferMemory[i]);
+	}
+}
+
+void MeshletCuller::CreateDescriptorSetLayout()
+{
+	//Meshlets, frame + jobs, draws, counts
+	VkDescriptorSetLayoutBinding bindings[4]{};
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 4;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(*device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create meshlet culling descriptor set layout!");
+	}
+}
+
+void MeshletCuller::CreateDescriptorPool()
+{
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 4;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+	if (vkCreateDescriptorPool(*device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create meshlet culling descriptor pool!");
+	}
+}
+
+void MeshletCuller::CreateDescriptorSets()
+{
+	std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	allocInfo.pSetLayouts = layouts.data();
+
+	descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	if (vkAllocateDescriptorSets(*device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate meshlet culling descriptor sets!");
+	}
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorBufferInfo bufferInfos[4]{};
+		bufferInfos[0].buffer = meshletBuffer;
+		bufferInfos[1].buffer = jobBuffers[i];
+		bufferInfos[2].buffer = drawBuffers[i];
+		bufferInfos[3].buffer = countBuffers[i];
+
+		VkWriteDescriptorSet descriptorWrites[4]{};
+		for (uint32_t b = 0; b < 4; b++)
+		{
+			bufferInfos[b].offset = 0;
+			bufferInfos[b].range = VK_WHOLE_SIZE;
+
+			descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[b].dstSet = descriptorSets[i];
+			descriptorWrites[b].dstBinding = b;
+			descriptorWrites[b].dstArrayElement = 0;
+			descriptorWrites[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[b].descriptorCount = 1;
+			descriptorWrites[b].pBufferInfo = &bufferInfos[b];
+		}
+
+		vkUpdateDescriptorSets(*device, 4, descriptorWrites, 0, nullptr);
+	}
+}
+
+void MeshletCuller::CreatePipeline(VkShaderModule* shaderModule)
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+	if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create meshlet culling pipeline layout!");
+	}
+
+	VkPipelineShaderStageCreateInfo stageInfo{};
+	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module = *shaderModule;
+	stageInfo.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = stageInfo;
+	pipelineInfo.layout = pipelineLayout;
+
+	if (vkCreateComputePipelines(*device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create meshlet culling pipeline!");
+	}
+}
+
+#pragma endregion
+
+void MeshletCuller::BeginFrame(const glm::vec4 planes[6], glm::vec3 cameraPosition)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		frame.planes[i] = planes[i];
+	}
+	frame.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+
+	jobs.clear();
+	drawCount = 0;
+}
+
+int32_t MeshletCuller::AddJob(Mesh* mesh, const MeshLod& lod, const glm::mat4& world, float scale)
+{
+	if (jobs.size() >= Welkin_Settings::MAX_OBJECTS || drawCount + lod.meshletCount > Welkin_Settings::MESHLET_MAX_DRAWS || lod.meshletCount > maxDrawsPerJob)
+	{
+		return -1;
+	}
+
+	MeshletCullJob job{};
+	job.world = world;
+	job.firstMeshlet = meshletBases.at(mesh) + lod.firstMeshlet;
+	job.meshletCount = lod.meshletCount;
+	job.firstDraw = drawCount;
+	job.scale = scale;
+
+	jobs.push_back(job);
+	drawCount += lod.meshletCount;
+	return static_cast<int32_t>(jobs.size()) - 1;
+}
+
+void MeshletCuller::UpdateJobBuffer(unsigned short currentFrame)
+{
+	void* data;
+	vkMapMemory(*device, jobBufferMemory[currentFrame], 0, sizeof(MeshletCullFrame) + sizeof(MeshletCullJob) * jobs.size(), 0, &data);
+
+	memcpy(data, &frame, sizeof(MeshletCullFrame));
+	memcpy(static_cast<uint8_t*>(data) + sizeof(MeshletCullFrame), jobs.data(), sizeof(MeshletCullJob) * jobs.size());
+
+	vkUnmapMemory(*device, jobBufferMemory[currentFrame]);
+}
+
+void MeshletCuller::RecordCulling(VkCommandBuffer commandBuffer, unsigned short currentFrame)
+{
+	if (jobs.empty())
+	{
+		return;
+	}
+
+	//Counts start at zero for the atomics, and without the count extension every slot is drawn so the unused ones have to be empty
+	vkCmdFillBuffer(commandBuffer, countBuffers[currentFrame], 0, sizeof(uint32_t) * jobs.size(), 0);
+	if (cmdDrawIndexedIndirectCount == nullptr)
+	{
+		vkCmdFillBuffer(commandBuffer, drawBuffers[currentFrame], 0, sizeof(VkDrawIndexedIndirectCommand) * drawCount, 0);
+	}
+
+	VkMemoryBarrier fillBarrier{};
+	fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+	vkCmdDispatch(commandBuffer, static_cast<uint32_t>(jobs.size()), 1, 1);
+
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void MeshletCuller::RecordDraw(VkCommandBuffer commandBuffer, unsigned short currentFrame, int32_t job)
+{
+	const MeshletCullJob& cullJob = jobs[job];
+	const VkDeviceSize drawOffset = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(cullJob.firstDraw);
+
+	if (cmdDrawIndexedIndirectCount != nullptr)
+	{
+		cmdDrawIndexedIndirectCount(commandBuffer, drawBuffers[currentFrame], drawOffset, countBuffers[currentFrame], sizeof(uint32_t) * static_cast<VkDeviceSize>(job),
+			cullJob.meshletCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else
+	{
+		//Culled slots are zeroed, so they draw nothing
+		vkCmdDrawIndexedIndirect(commandBuffer, drawBuffers[currentFrame], drawOffset, cullJob.meshletCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
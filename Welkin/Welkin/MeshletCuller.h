@@ -0,0 +1,90 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include "VulkanCore.h"
+#include "FileManager.h"
+#include "Helper.h"
+
+//Uploaded once per frame in front of the jobs, laid out to match MeshletCull.comp
+struct MeshletCullFrame
+{
+	alignas(16) glm::vec4 planes[6];
+	alignas(16) glm::vec4 cameraPosition;
+};
+
+//One object's LOD to cull, one workgroup each
+struct MeshletCullJob
+{
+	alignas(16) glm::mat4 world;
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	//Survivors are compacted into the draw buffer from here, meshletCount slots are reserved
+	uint32_t firstDraw;
+	//Largest axis scale of world, for the bounding spheres
+	float scale;
+};
+
+//Culls meshlets against the frustum and their normal cones in a compute pass, then draws the survivors with indirect draws
+//Works on the regular vertex pipeline, so it doesn't need mesh shaders
+class MeshletCuller
+{
+public:
+	MeshletCuller(VulkanCore* vCore, FileManager* fm);
+	~MeshletCuller();
+
+	//False when no mesh has meshlets, MeshletCull.comp wasn't compiled, or the device doesn't support multiDrawIndirect
+	bool IsEnabled() { return this->enabled; };
+
+	//Clears last frame's jobs
+	void BeginFrame(const glm::vec4 planes[6], glm::vec3 cameraPosition);
+	//Returns the job to draw the object with, or -1 if it has to be drawn whole
+	int32_t AddJob(Mesh* mesh, const MeshLod& lod, const glm::mat4& world, float scale);
+	void UpdateJobBuffer(unsigned short currentFrame);
+
+	//Has to be outside the render pass, before any RecordDraw
+	void RecordCulling(VkCommandBuffer commandBuffer, unsigned short currentFrame);
+	//Expects the job's mesh to have its vertex and index buffers bound
+	void RecordDraw(VkCommandBuffer commandBuffer, unsigned short currentFrame, int32_t job);
+
+private:
+	VulkanCore* vCore;
+	VkDevice* device;
+	FileManager* fm;
+	bool enabled = false;
+	uint32_t maxDrawsPerJob;
+
+	MeshletCullFrame frame;
+	std::vector<MeshletCullJob> jobs;
+	uint32_t drawCount = 0;
+
+	//Every mesh's meshlets live in one buffer, this is where each mesh starts
+	std::unordered_map<Mesh*, uint32_t> meshletBases;
+	VkBuffer meshletBuffer;
+	VkDeviceMemory meshletBufferMemory;
+
+	//Per frame in flight
+	std::vector<VkBuffer> jobBuffers;
+	std::vector<VkDeviceMemory> jobBufferMemory;
+	std::vector<VkBuffer> drawBuffers;
+	std::vector<VkDeviceMemory> drawBufferMemory;
+	//Survivor count per job, read by vkCmdDrawIndexedIndirectCountKHR
+	std::vector<VkBuffer> countBuffers;
+	std::vector<VkDeviceMemory> countBufferMemory;
+
+	std::vector<VkDescriptorSet> descriptorSets;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+
+	//Null without VK_KHR_draw_indirect_count, every slot is drawn and the unused ones are left zeroed instead
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+
+	void CreateMeshletBuffer();
+	void CreateFrameBuffers();
+	void CreateDescriptorSetLayout();
+	void CreateDescriptorPool();
+	void CreateDescriptorSets();
+	void CreatePipeline(VkShaderModule* shaderModule);
+};
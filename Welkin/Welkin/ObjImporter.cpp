@@ -0,0 +1,431 @@
+#include "ObjImporter.h"
+#include "MappedFile.h"
+#include "Helper.h"
+#include "JobSystem.h"
+#include <charconv>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	const uint32_t NO_INDEX = 0xFFFFFFFFu;
+	//Parsed index of an attribute the corner doesn't have
+	const int32_t MISSING_INDEX = -1;
+	//Don't bother splitting files smaller than this across threads
+	const size_t MIN_CHUNK_SIZE = 1024 * 1024;
+	//Chunks per job system thread, so a thread that finishes early can steal another
+	const size_t CHUNKS_PER_THREAD = 4;
+
+	struct Corner
+	{
+		uint32_t position;
+		uint32_t uv;
+		uint32_t normal;
+	};
+
+	//Corner as a chunk parses it, before the chunk's offsets are known
+	//Relative (negative) indices are stored as the chunk's own count plus the index, which goes below zero when they point into an earlier chunk
+	struct ParsedCorner
+	{
+		int32_t position;
+		int32_t uv;
+		int32_t normal;
+		//RELATIVE_* bits for the indices that are chunk relative
+		uint8_t relative;
+	};
+
+	const uint8_t RELATIVE_POSITION = 0x1;
+	const uint8_t RELATIVE_UV = 0x2;
+	const uint8_t RELATIVE_NORMAL = 0x4;
+
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		//Already triangulated, three corners per triangle
+		std::vector<ParsedCorner> corners;
+		//Corner index where each new object/group starts
+		std::vector<size_t> groupStarts;
+
+		//Global offsets of this chunk's v/vt/vn, filled after parsing
+		uint32_t positionOffset;
+		uint32_t uvOffset;
+		uint32_t normalOffset;
+	};
+
+	#pragma region Parsing
+
+		inline const char* SkipSpaces(const char* c, const char* end)
+		{
+			while (c < end && (*c == ' ' || *c == '\t'))
+			{
+				c++;
+			}
+			return c;
+		}
+
+		inline const char* NextLine(const char* c, const char* end)
+		{
+			while (c < end && *c != '\n')
+			{
+				c++;
+			}
+			return (c < end) ? c + 1 : end;
+		}
+
+		inline const char* ParseFloat(const char* c, const char* end, float& value)
+		{
+			c = SkipSpaces(c, end);
+			//from_chars doesn't take a leading plus
+			if (c < end && *c == '+')
+			{
+				c++;
+			}
+
+			value = 0.0f;
+			return std::from_chars(c, end, value).ptr;
+		}
+
+		//Turns a 1 based OBJ index zero based, and a negative one into an index relative to the chunk's start, setting relativeBit in relative
+		inline int32_t ResolveIndex(int index, size_t localCount, uint8_t relativeBit, uint8_t& relative)
+		{
+			if (index > 0)
+			{
+				return index - 1;
+			}
+			if (index < 0)
+			{
+				relative |= relativeBit;
+				return static_cast<int32_t>(static_cast<int64_t>(localCount) + index);
+			}
+			return MISSING_INDEX;
+		}
+
+		//v, v/vt, v//vn or v/vt/vn
+		inline const char* ParseCorner(const char* c, const char* end, const ObjChunk& chunk, ParsedCorner& corner)
+		{
+			int values[3] = { 0, 0, 0 };
+
+			for (int i = 0; i < 3; i++)
+			{
+				if (c < end && *c != '/')
+				{
+					c = std::from_chars(c, end, values[i]).ptr;
+				}
+
+				if (c < end && *c == '/')
+				{
+					c++;
+				}
+				else
+				{
+					break;
+				}
+			}
+
+			corner.relative = 0;
+			corner.position = ResolveIndex(values[0], chunk.positions.size(), RELATIVE_POSITION, corner.relative);
+			corner.uv = ResolveIndex(values[1], chunk.uvs.size(), RELATIVE_UV, corner.relative);
+			corner.normal = ResolveIndex(values[2], chunk.normals.size(), RELATIVE_NORMAL, corner.relative);
+			return c;
+		}
+
+		void ParseChunk(ObjChunk& chunk)
+		{
+			const char* c = chunk.begin;
+			const char* end = chunk.end;
+			std::vector<ParsedCorner> polygon;
+
+			while (c < end)
+			{
+				c = SkipSpaces(c, end);
+				if (c >= end)
+				{
+					break;
+				}
+
+				if (c[0] == 'v' && c + 1 < end && (c[1] == ' ' || c[1] == '\t'))
+				{
+					glm::vec3 position;
+					c = ParseFloat(c + 1, end, position.x);
+					c = ParseFloat(c, end, position.y);
+					c = ParseFloat(c, end, position.z);
+					chunk.positions.push_back(position);
+				}
+				else if (c[0] == 'v' && c + 2 < end && c[1] == 't')
+				{
+					glm::vec2 uv;
+					c = ParseFloat(c + 2, end, uv.x);
+					c = ParseFloat(c, end, uv.y);
+					chunk.uvs.push_back(uv);
+				}
+				else if (c[0] == 'v' && c + 2 < end && c[1] == 'n')
+				{
+					glm::vec3 normal;
+					c = ParseFloat(c + 2, end, normal.x);
+					c = ParseFloat(c, end, normal.y);
+					c = ParseFloat(c, end, normal.z);
+					chunk.normals.push_back(normal);
+				}
+				else if (c[0] == 'f' && c + 1 < end && (c[1] == ' ' || c[1] == '\t'))
+				{
+					polygon.clear();
+					c++;
+
+					while (true)
+					{
+						c = SkipSpaces(c, end);
+						if (c >= end || *c == '\n' || *c == '\r' || *c == '#')
+						{
+							break;
+						}
+
+						ParsedCorner corner;
+						const char* next = ParseCorner(c, end, chunk, corner);
+						if (next == c)
+						{
+							break;
+						}
+
+						c = next;
+						polygon.push_back(corner);
+					}
+
+					//Fan triangulation, same as tinyobj did
+					for (size_t i = 2; i < polygon.size(); i++)
+					{
+						chunk.corners.push_back(polygon[0]);
+						chunk.corners.push_back(polygon[i - 1]);
+						chunk.corners.push_back(polygon[i]);
+					}
+				}
+				else if (c[0] == 'o' || c[0] == 'g')
+				{
+					chunk.groupStarts.push_back(chunk.corners.size());
+				}
+
+				c = NextLine(c, end);
+			}
+		}
+
+	#pragma endregion
+
+	#pragma region Welding
+
+		//Open addressing table from a (v, vt, vn) triple to its vertex index, linear probing
+		class WeldTable
+		{
+		public:
+			WeldTable(size_t expectedVertices)
+			{
+				//Kept under half full so probes stay short
+				size_t capacity = 16;
+				while (capacity < expectedVertices * 2)
+				{
+					capacity <<= 1;
+				}
+
+				mask = capacity - 1;
+				keys.resize(capacity);
+				values.assign(capacity, NO_INDEX);
+			}
+
+			//Returns the existing vertex for the key, or inserts newIndex and returns it
+			uint32_t FindOrInsert(const Corner& key, uint32_t newIndex)
+			{
+				size_t slot = Hash(key) & mask;
+
+				while (values[slot] != NO_INDEX)
+				{
+					const Corner& existing = keys[slot];
+					if (existing.position == key.position && existing.uv == key.uv && existing.normal == key.normal)
+					{
+						return values[slot];
+					}
+
+					slot = (slot + 1) & mask;
+				}
+
+				keys[slot] = key;
+				values[slot] = newIndex;
+				return newIndex;
+			}
+
+		private:
+			size_t mask;
+			std::vector<Corner> keys;
+			std::vector<uint32_t> values;
+
+			static size_t Hash(const Corner& key)
+			{
+				uint64_t h = key.position * 0x9E3779B97F4A7C15ull;
+				h ^= (key.uv + 0x7F4A7C15ull) * 0xBF58476D1CE4E5B9ull;
+				h ^= (key.normal + 0x1CE4E5B9ull) * 0x94D049BB133111EBull;
+				return static_cast<size_t>(h ^ (h >> 31));
+			}
+		};
+
+		//NO_INDEX for missing attributes and relative indices that point before the start of the file
+		inline uint32_t ToGlobal(int32_t index, bool relative, uint32_t offset)
+		{
+			if (!relative)
+			{
+				return (index == MISSING_INDEX) ? NO_INDEX : static_cast<uint32_t>(index);
+			}
+
+			const int64_t global = static_cast<int64_t>(offset) + index;
+			return (global >= 0) ? static_cast<uint32_t>(global) : NO_INDEX;
+		}
+
+	#pragma endregion
+}
+
+void ObjImporter::Import(const std::string& path, MeshData& data, JobSystem* jobSystem)
+{
+	MappedFile file(path);
+	const char* text = reinterpret_cast<const char*>(file.GetData());
+	const size_t size = file.GetSize();
+
+	#pragma region Split and Parse
+		//Goes by file size, the job system decides how many of them run at once
+		const size_t maxChunks = (jobSystem == nullptr) ? 1 : static_cast<size_t>(jobSystem->GetThreadCount()) * CHUNKS_PER_THREAD;
+		const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(maxChunks, size / MIN_CHUNK_SIZE));
+		std::vector<ObjChunk> chunks(chunkCount);
+
+		//Chunk boundaries are moved forward to the next line start
+		const char* chunkBegin = text;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			const char* chunkEnd = (i + 1 == chunkCount) ? text + size : text + size * (i + 1) / chunkCount;
+			while (chunkEnd < text + size && chunkEnd[-1] != '\n')
+			{
+				chunkEnd++;
+			}
+
+			chunks[i].begin = chunkBegin;
+			chunks[i].end = std::max(chunkBegin, chunkEnd);
+			chunkBegin = chunks[i].end;
+		}
+
+		if (chunkCount == 1)
+		{
+			ParseChunk(chunks[0]);
+		}
+		else
+		{
+			jobSystem->ParallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					ParseChunk(chunks[i]);
+				}
+			}, 1);
+		}
+	#pragma endregion
+
+	#pragma region Merge Attributes
+		size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+		for (auto& chunk : chunks)
+		{
+			chunk.positionOffset = static_cast<uint32_t>(positionCount);
+			chunk.uvOffset = static_cast<uint32_t>(uvCount);
+			chunk.normalOffset = static_cast<uint32_t>(normalCount);
+
+			positionCount += chunk.positions.size();
+			uvCount += chunk.uvs.size();
+			normalCount += chunk.normals.size();
+			cornerCount += chunk.corners.size();
+		}
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		positions.reserve(positionCount);
+		uvs.reserve(uvCount);
+		normals.reserve(normalCount);
+
+		for (auto& chunk : chunks)
+		{
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		}
+	#pragma endregion
+
+	#pragma region Weld
+		//Every corner could be unique, so size for that. Real meshes usually end up with about a sixth of that
+		WeldTable table(cornerCount);
+
+		data.vertices.reserve(std::min(cornerCount, positionCount * 2 + 16));
+		data.indices.reserve(cornerCount);
+
+		for (auto& chunk : chunks)
+		{
+			size_t nextGroup = 0;
+
+			for (size_t i = 0; i < chunk.corners.size(); i++)
+			{
+				//New object/group, only splits if something was drawn since the last one
+				while (nextGroup < chunk.groupStarts.size() && chunk.groupStarts[nextGroup] == i)
+				{
+					if (data.submeshes.empty() || data.submeshes.back().indexCount > 0)
+					{
+						data.submeshes.push_back({ static_cast<uint32_t>(data.indices.size()), 0 });
+					}
+					nextGroup++;
+				}
+
+				const ParsedCorner& parsed = chunk.corners[i];
+				Corner corner;
+				corner.position = ToGlobal(parsed.position, parsed.relative & RELATIVE_POSITION, chunk.positionOffset);
+				corner.uv = ToGlobal(parsed.uv, parsed.relative & RELATIVE_UV, chunk.uvOffset);
+				corner.normal = ToGlobal(parsed.normal, parsed.relative & RELATIVE_NORMAL, chunk.normalOffset);
+
+				if (corner.position >= positions.size())
+				{
+					throw std::runtime_error("OBJ face references a missing vertex in " + path);
+				}
+
+				const uint32_t vertexIndex = table.FindOrInsert(corner, static_cast<uint32_t>(data.vertices.size()));
+
+				if (vertexIndex == data.vertices.size())
+				{
+					Vertex vertex{};
+					vertex.position = positions[corner.position];
+
+					if (corner.uv < uvs.size())
+					{
+						vertex.UV = { uvs[corner.uv].x, 1.0f - uvs[corner.uv].y };
+					}
+
+					if (corner.normal < normals.size())
+					{
+						vertex.normal = normals[corner.normal];
+					}
+
+					data.vertices.push_back(vertex);
+				}
+
+				if (data.submeshes.empty())
+				{
+					data.submeshes.push_back({ 0, 0 });
+				}
+
+				data.indices.push_back(vertexIndex);
+				data.submeshes.back().indexCount++;
+			}
+		}
+
+		//A group declared at the end of the file with nothing in it
+		if (!data.submeshes.empty() && data.submeshes.back().indexCount == 0)
+		{
+			data.submeshes.pop_back();
+		}
+	#pragma endregion
+
+	Helper::Cout("- Parsed " + path + " in " + std::to_string(chunkCount) + " chunks, " + std::to_string(data.vertices.size()) + " vertices, " + std::to_string(data.indices.size() / 3) + " triangles");
+}
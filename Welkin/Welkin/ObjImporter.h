@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include "MeshCache.h"
+
+class JobSystem;
+
+//Multithreaded Wavefront OBJ importer
+//The file is split into line aligned chunks that are parsed as jobs, then face corners are welded into unique vertices
+namespace ObjImporter
+{
+	//Fills vertices, indices and submeshes (one per object/group), throws if the file can't be read
+	//Without a jobSystem the whole file is parsed as one chunk on the calling thread
+	void Import(const std::string& path, MeshData& data, JobSystem* jobSystem = nullptr);
+};
@@ -4,6 +4,13 @@ PBRMaterial::PBRMaterial(Texture* tex_Color, std::string materialName, VulkanCor
 	: Material { tex_Color, materialName, vCore, uvScale },
 	tex_Roughness {tex_Roughness}, tex_AO {tex_AO}, tex_Depth {tex_Depth}, tex_Normal {tex_Normal}
 {
+	for (Texture* texture : { tex_Roughness, tex_AO, tex_Depth, tex_Normal })
+	{
+		if (texture != nullptr)
+		{
+			textures.push_back(texture);
+		}
+	}
 	CreateTextureSampler();
 }
 
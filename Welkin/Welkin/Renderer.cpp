@@ -1,18 +1,61 @@
 #include "Renderer.h"
+#include <cfloat>
+#include <array>
+#include <numeric>
 
-Renderer::Renderer(VulkanCore* vCore, FileManager* fm, Camera* mainCamera, vector<GameObject*>* gameObjects) : vCore{ vCore }, mainCamera{ mainCamera }, gameObjects{ gameObjects }, fm{fm}
+Renderer::Renderer(VulkanCore* vCore, FileManager* fm, SnapshotExchange* snapshots, JobSystem* jobSystem) : vCore{ vCore }, snapshots{ snapshots }, fm{fm}, jobSystem{ jobSystem }
 {
 	this->device = vCore->GetLogicalDevice();
 
 	Helper::Cout("Renderer", true);
 
 	CreateRenderPass();
-	allUniformBufferObjects.push_back(new UniformBufferObject(UniformBufferType::PER_FRAME, vCore, fm, this->mainCamera));
-	allUniformBufferObjects.push_back(new UniformBufferObject(UniformBufferType::ALL_TEXTURES, vCore, fm, this->mainCamera));
+	allUniformBufferObjects.push_back(new UniformBufferObject(UniformBufferType::PER_FRAME, vCore, fm));
+	allUniformBufferObjects.push_back(new UniformBufferObject(UniformBufferType::ALL_TEXTURES, vCore, fm));
 
-	allStorageBufferObjects.push_back(new StorageBufferObject(StorageBufferType::PER_TRANSFORM, vCore, fm, this->mainCamera));
+	transformEvaluator = new TransformEvaluator(vCore, fm);
+	perTransformBuffer = new StorageBufferObject(StorageBufferType::PER_TRANSFORM, vCore, fm, transformEvaluator->IsEnabled());
+	allStorageBufferObjects.push_back(perTransformBuffer);
+	if (transformEvaluator->IsEnabled())
+	{
+		transformEvaluator->SetOutputBuffers(perTransformBuffer->GetBuffers());
+	}
+
+	CreatePipelineLayout();
+
+	//FileManager only imports COMPACT meshes when this shader exists
+	VkShaderModule* compactVertShaderModule = fm->TryFindShaderModule("(C)SimpleShaderCompactVert.spv");
+
+	//Decided first, the shading pipelines test against the prepass's depth instead of writing their own
+	if (Welkin_Settings::USE_DEPTH_PREPASS)
+	{
+		VkShaderModule* depthVertShaderModule = fm->TryFindShaderModule("(C)DepthOnlyVert.spv");
+		VkShaderModule* compactDepthVertShaderModule = fm->TryFindShaderModule("(C)DepthOnlyCompactVert.spv");
+
+		if (depthVertShaderModule != nullptr && (compactVertShaderModule == nullptr || compactDepthVertShaderModule != nullptr))
+		{
+			depthPrepass = true;
+			CreateGraphicsPipeline(depthVertShaderModule, nullptr, VertexFormat::STANDARD, depthPipeline);
+			if (compactVertShaderModule != nullptr)
+			{
+				CreateGraphicsPipeline(compactDepthVertShaderModule, nullptr, VertexFormat::COMPACT, compactDepthPipeline);
+			}
+		}
+		else
+		{
+			Helper::Warning("Depth only shaders are missing, drawing without a depth prepass");
+		}
+	}
+
+	CreateGraphicsPipeline(fm->FindShaderModule("(C)SimpleShaderVert.spv"), fm->FindShaderModule("(C)SimpleShaderFrag.spv"), VertexFormat::STANDARD, graphicsPipeline);
+	if (compactVertShaderModule != nullptr)
+	{
+		CreateGraphicsPipeline(compactVertShaderModule, fm->FindShaderModule("(C)SimpleShaderFrag.spv"), VertexFormat::COMPACT, compactPipeline);
+	}
+
+	meshletCuller = new MeshletCuller(vCore, fm);
+	impostorRenderer = new ImpostorRenderer(vCore, fm, renderPass);
 
-	CreateGraphicsPipeline();
 	vCore->CreateFrameBuffers(&renderPass);
 
 	CreateCommandBuffers(*vCore->GetCommandPool(0));
@@ -26,6 +69,10 @@ Renderer::~Renderer()
 		delete UBO;
 	}
 
+	delete meshletCuller;
+	delete impostorRenderer;
+	delete transformEvaluator;
+
 	//Sync Objects 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
@@ -36,14 +83,53 @@ Renderer::~Renderer()
 
 
 	vkDestroyPipeline(*device, graphicsPipeline, nullptr);
+	for (VkPipeline pipeline : { compactPipeline, depthPipeline, compactDepthPipeline })
+	{
+		if (pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(*device, pipeline, nullptr);
+		}
+	}
 	vkDestroyPipelineLayout(*device, pipelineLayout, nullptr);
 	vkDestroyRenderPass(*device, renderPass, nullptr);
 }
 
-void Renderer::CreateGraphicsPipeline()
+//Shared by every graphics pipeline, so meshes with different vertex formats can swap pipelines without rebinding descriptors
+void Renderer::CreatePipelineLayout()
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+	vector<VkDescriptorSetLayout> allDescriptorLayouts;
+	for (auto& UBO : allUniformBufferObjects)
+	{
+		allDescriptorLayouts.push_back(*UBO->GetDescriptorSetLayout());
+	}
+	for (auto& SBO : allStorageBufferObjects)
+	{
+		allDescriptorLayouts.push_back(*SBO->GetDescriptorSetLayout());
+	}
+	pipelineLayoutInfo.setLayoutCount = allDescriptorLayouts.size();
+	pipelineLayoutInfo.pSetLayouts = allDescriptorLayouts.data();
+
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_ALL;
+	range.offset = 0;
+	range.size = sizeof(Welkin_BufferStructs::PushConstant);
+
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &range;
+
+	if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+}
+
+void Renderer::CreateGraphicsPipeline(VkShaderModule* vertShaderModule, VkShaderModule* fragShaderModule, VertexFormat format, VkPipeline& pipeline)
 {
-	VkShaderModule* vertShaderModule = fm->FindShaderModule("(C)SimpleShaderVert.spv");
-	VkShaderModule* fragShaderModule = fm->FindShaderModule("(C)SimpleShaderFrag.spv");
+	//Depth only pipelines have no fragment shader, depth is written by the fixed function tests
+	const bool depthOnly = fragShaderModule == nullptr;
 
 	#pragma region Shader Stage Creation
 
@@ -57,7 +143,7 @@ void Renderer::CreateGraphicsPipeline()
 		VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
 		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = *fragShaderModule;
+		fragShaderStageInfo.module = depthOnly ? VK_NULL_HANDLE : *fragShaderModule;
 		fragShaderStageInfo.pName = "main";
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
@@ -67,14 +153,15 @@ void Renderer::CreateGraphicsPipeline()
 	#pragma region Vertex Shader Info
 
 		//Discribes the format of the vertex data that will be passed to the vertex shader
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+		//Position stream then attribute stream, depth only pipelines stop after the first
+		auto bindingDescriptions = Vertex::getBindingDescriptions(format);
+		auto attributeDescriptions = Vertex::getAttributeDescriptions(format);
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+		vertexInputInfo.vertexBindingDescriptionCount = depthOnly ? 1 : static_cast<uint32_t>(bindingDescriptions.size());
+		vertexInputInfo.vertexAttributeDescriptionCount = depthOnly ? 1 : static_cast<uint32_t>(attributeDescriptions.size());
+		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 	#pragma endregion
 
@@ -148,13 +235,19 @@ void Renderer::CreateGraphicsPipeline()
 
 	#pragma region Depth and Stencil
 
-		//TODO implement
+		//With a prepass the depth is already final, so shading only has to match it
 		VkPipelineDepthStencilStateCreateInfo depthInfo{};
+		depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthInfo.depthTestEnable = VK_TRUE;
+		depthInfo.depthWriteEnable = (depthOnly || !depthPrepass) ? VK_TRUE : VK_FALSE;
+		depthInfo.depthCompareOp = (depthOnly || !depthPrepass) ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_LESS_OR_EQUAL;
+		depthInfo.depthBoundsTestEnable = VK_FALSE;
+		depthInfo.stencilTestEnable = VK_FALSE;
 	#pragma endregion
 
 	#pragma region Color Blending
 		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.colorWriteMask = depthOnly ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 		colorBlendAttachment.blendEnable = VK_FALSE;
 		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
 		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
@@ -185,43 +278,11 @@ void Renderer::CreateGraphicsPipeline()
 		dynamicState.pDynamicStates = dynamicStates.data();
 	#pragma endregion
 
-	#pragma region Pipeline Layout
-
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-		vector<VkDescriptorSetLayout> allDescriptorLayouts;
-		for (auto& UBO : allUniformBufferObjects)
-		{
-			allDescriptorLayouts.push_back(*UBO->GetDescriptorSetLayout());
-		}
-		for (auto& SBO : allStorageBufferObjects)
-		{
-			allDescriptorLayouts.push_back(*SBO->GetDescriptorSetLayout());
-		}
-		pipelineLayoutInfo.setLayoutCount = allDescriptorLayouts.size();
-		pipelineLayoutInfo.pSetLayouts = allDescriptorLayouts.data();
-
-		VkPushConstantRange range{};
-		range.stageFlags = VK_SHADER_STAGE_ALL;
-		range.offset = 0;
-		range.size = sizeof(Welkin_BufferStructs::PushConstant);
-
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &range;
-
-		if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to create pipeline layout!");
-		}
-
-	#pragma endregion
-
 	#pragma region Creating the Pipeline
 
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
+		pipelineInfo.stageCount = depthOnly ? 1 : 2;
 		pipelineInfo.pStages = shaderStages;
 
 		//Use all the data above 
@@ -230,7 +291,7 @@ void Renderer::CreateGraphicsPipeline()
 		pipelineInfo.pViewportState = &viewportState;
 		pipelineInfo.pRasterizationState = &rasterizer;
 		pipelineInfo.pMultisampleState = &multisampling;
-		pipelineInfo.pDepthStencilState = nullptr; // Optional
+		pipelineInfo.pDepthStencilState = &depthInfo;
 		pipelineInfo.pColorBlendState = &colorBlending;
 		pipelineInfo.pDynamicState = &dynamicState;
 		pipelineInfo.layout = pipelineLayout;
@@ -242,7 +303,7 @@ void Renderer::CreateGraphicsPipeline()
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 		pipelineInfo.basePipelineIndex = -1; // Optional
 
-		if (vkCreateGraphicsPipelines(*device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+		if (vkCreateGraphicsPipelines(*device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create graphics pipeline!");
 		}
@@ -282,13 +343,30 @@ void Renderer::CreateRenderPass()
 		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	#pragma endregion
 
+	#pragma region Depth
+		//Only needed during the pass, the prepass fills it and shading tests against it
+		VkAttachmentDescription depthAttachment{};
+		depthAttachment.format = vCore->GetDepthFormat();
+		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference depthAttachmentRef{};
+		depthAttachmentRef.attachment = 1;
+		depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	#pragma endregion
+
 	#pragma region Subpasses
 
 		VkSubpassDescription subpass{};
 		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 		subpass.colorAttachmentCount = 1;
 		subpass.pColorAttachments = &colorAttachmentRef;
-		subpass.pDepthStencilAttachment = nullptr; //TODO add
+		subpass.pDepthStencilAttachment = &depthAttachmentRef;
 	#pragma endregion
 
 	#pragma region Subpass Dependencies
@@ -299,16 +377,18 @@ void Renderer::CreateRenderPass()
 
 		//specify the operations to wait on and the stages in which these operations occur.
 		//These settings will prevent the transition from happening until it's actually necessary (and allowed): when we want to start writing colors to it.
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		//The depth clear also has to wait for the last frame's depth tests, as the depth image is shared
+		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	#pragma endregion
 
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
+	const std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
 	renderPassInfo.dependencyCount = 1;
@@ -358,6 +438,16 @@ void Renderer::RecordCommandBuffer(const VkCommandBuffer commandBuffer, const ui
 		}
 	#pragma endregion
 
+	//Compute work can't go inside the render pass
+	if (transformEvaluator->IsEnabled())
+	{
+		transformEvaluator->RecordEvaluation(commandBuffer, currentFrame);
+	}
+	if (meshletCuller->IsEnabled())
+	{
+		meshletCuller->RecordCulling(commandBuffer, currentFrame);
+	}
+
 	#pragma region Begin Render-Pass
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -367,17 +457,17 @@ void Renderer::RecordCommandBuffer(const VkCommandBuffer commandBuffer, const ui
 		renderPassInfo.renderArea.offset = { 0, 0 };
 		renderPassInfo.renderArea.extent = *vCore->GetSwapchainExtent();
 
-		//What to reset the color with
-		VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
+		//What to reset the color and depth with, in attachment order
+		std::array<VkClearValue, 2> clearValues{};
+		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
 
 		//Either Inline (no secondary cmd buffers) or subpass (cmds will be executed from a secondary cmd buffer)
 		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 	#pragma endregion
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
 	#pragma region Dynamic States Setting
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -394,8 +484,38 @@ void Renderer::RecordCommandBuffer(const VkCommandBuffer commandBuffer, const ui
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 	#pragma endregion
 
+	//Depth only first, so the shading pass only runs its fragment shader once per pixel
+	if (depthPrepass)
+	{
+		RecordDraws(commandBuffer, true);
+	}
+	RecordDraws(commandBuffer, false);
+
+	if (impostorRenderer->IsEnabled())
+	{
+		impostorRenderer->RecordDraw(commandBuffer, currentFrame, scene.projection * scene.view, glm::vec3(glm::inverse(scene.view)[3]));
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record command buffer!");
+	}
+
+}
+
+void Renderer::RecordDraws(const VkCommandBuffer commandBuffer, const bool depthOnly)
+{
+	//Indexed by depthOnly
+	const VkPipeline standardPipelines[] = { graphicsPipeline, depthPipeline };
+	const VkPipeline compactPipelines[] = { compactPipeline, compactDepthPipeline };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, standardPipelines[depthOnly]);
+	VertexFormat boundFormat = VertexFormat::STANDARD;
+
 	//Used for not updating the vertex and index buffers every frame
-	uint32_t lastIndicesSize = 0;
+	Mesh* lastMesh = nullptr;
 
 	#pragma region Binding Buffers
 
@@ -413,44 +533,59 @@ void Renderer::RecordCommandBuffer(const VkCommandBuffer commandBuffer, const ui
 		//Binds all descriptor sets
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, allUniformBufferObjects.size() + allStorageBufferObjects.size(), allCurrentFrameDescriptorSets.data(), 0, nullptr);
 
-		for (unsigned int i = 0; i < gameObjects->size(); i++)
+		for (const unsigned int i : visibleObjects)
 		{
+			Mesh* mesh = scene.meshes[i];
+
+			//Pipelines share a layout, so the descriptor sets stay bound
+			if (mesh->GetVertexFormat() != boundFormat)
+			{
+				boundFormat = mesh->GetVertexFormat();
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, (boundFormat == VertexFormat::COMPACT) ? compactPipelines[depthOnly] : standardPipelines[depthOnly]);
+			}
+
 			//Push Constant
 			Welkin_BufferStructs::PushConstant push{};
-			/*push.world = gameObjects->at(i)->GetTransform()->GetWorldMatrix();
-			push.worldInverseTranspose = gameObjects->at(i)->GetTransform()->GetWorldInverseTransposeMatrix();*/
-			push.instanceID = i;
+			/*push.world = gameObjects->at(i)->GetWorldMatrix();
+			push.worldInverseTranspose = gameObjects->at(i)->GetWorldInverseTransposeMatrix();*/
+			push.instanceID = perTransformBuffer->GetInstanceIDs()[i];
 			push.materialID = i % 2;
+			push.positionScale = glm::vec4(mesh->GetPositionScale(), 0.0f);
+			push.positionOffset = glm::vec4(mesh->GetPositionOffset(), 0.0f);
 			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(Welkin_BufferStructs::PushConstant), &push);
 
-			const auto newIndicesSize = (gameObjects->at(i)->GetMesh()->GetIndeicesSize());
 			//string newMaterialName = gameObjects->at(i)->GetMaterial()->GetMaterialName();
 
-			if (newIndicesSize != lastIndicesSize)
+			if (mesh != lastMesh)
 			{
 				//New Mesh, bind new vertex and index buffers
 
-				const VkBuffer vertexBuffers[] = { *gameObjects->at(i)->GetMesh()->GetVertexBuffer() };
-				constexpr  VkDeviceSize offsets[] = { 0 };
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-				vkCmdBindIndexBuffer(commandBuffer, *gameObjects->at(i)->GetMesh()->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+				//Both streams live in the same buffer, the attribute stream starts after the positions
+				const VkBuffer vertexBuffers[] = { *mesh->GetVertexBuffer(), *mesh->GetVertexBuffer() };
+				const VkDeviceSize offsets[] = { 0, mesh->GetAttributeStreamOffset() };
+				vkCmdBindVertexBuffers(commandBuffer, 0, depthOnly ? 1 : 2, vertexBuffers, offsets);
+				vkCmdBindIndexBuffer(commandBuffer, *mesh->GetIndexBuffer(), 0, mesh->GetIndexType());
 
-				lastIndicesSize = newIndicesSize;
+				lastMesh = mesh;
 			}
 
 			//TODO optimize this, create a single buffer for all meshes and then use offsets
 
-			vkCmdDrawIndexed(commandBuffer, newIndicesSize, 1, 0, 0, 0);
+			if (objectMeshletJobs[i] >= 0)
+			{
+				meshletCuller->RecordDraw(commandBuffer, currentFrame, objectMeshletJobs[i]);
+				continue;
+			}
+
+			//Split submeshes each have their own vertex range for 16 bit indices
+			const MeshLod& lod = mesh->GetLods()[objectLods[i]];
+			for (uint32_t s = lod.firstSubmesh; s < lod.firstSubmesh + lod.submeshCount; s++)
+			{
+				const Submesh& submesh = mesh->GetSubmeshes()[s];
+				vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, static_cast<int32_t>(submesh.vertexOffset), 0);
+			}
 		}
 	#pragma endregion
-
-	vkCmdEndRenderPass(commandBuffer);
-
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to record command buffer!");
-	}
-
 }
 
 void Renderer::DrawFrame()
@@ -466,6 +601,23 @@ void Renderer::DrawFrame()
 	//Wait until the previous frame has finished, aka waits for signaled
 	vkWaitForFences(*device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
+	//After the wait, so the blend is for as close to when the frame is shown as possible
+	UpdateScene();
+	if (scene.worlds.empty())
+	{
+		//Nothing published yet
+		return;
+	}
+
+	//Finished texture uploads get patched into this frame's descriptors below
+	fm->GetTextureStreamer()->Update();
+
+	//Waits for the queue, so it goes before anything is recorded
+	if (impostorRenderer->IsEnabled())
+	{
+		impostorRenderer->BakePending();
+	}
+
 	//Aquire img from swap chain to draw to
 	uint32_t imageIndex;
 	VkResult result = vkAcquireNextImageKHR(*device, *vCore->GetSwapchain(), UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -483,16 +635,30 @@ void Renderer::DrawFrame()
 	//Updating the Uniform Buffer Objects 
 	for (auto& UBO : allUniformBufferObjects)
 	{
-		UBO->UpdateUniformBuffer(currentFrame);
+		UBO->UpdateUniformBuffer(currentFrame, scene);
 	}
 	for (auto& SBO : allStorageBufferObjects)
 	{
-		SBO->UpdateStorageBuffer(currentFrame, gameObjects);
+		SBO->UpdateStorageBuffer(currentFrame, scene);
+	}
+	if (transformEvaluator->IsEnabled())
+	{
+		transformEvaluator->UpdateInputBuffer(currentFrame, latestScene, perTransformBuffer->GetInstanceIDs());
 	}
 
 	//Sets fence(s) to unsignaled state
 	vkResetFences(*device, 1, &inFlightFences[currentFrame]);
 
+	CullObjects();
+	if (meshletCuller->IsEnabled())
+	{
+		meshletCuller->UpdateJobBuffer(currentFrame);
+	}
+	if (impostorRenderer->IsEnabled())
+	{
+		impostorRenderer->UpdateInstanceBuffer(currentFrame);
+	}
+
 	//Reset and record cmd buffer
 	vkResetCommandBuffer(mainCommandBuffers[currentFrame], 0);
 	RecordCommandBuffer(mainCommandBuffers[currentFrame], imageIndex);
@@ -523,6 +689,7 @@ void Renderer::DrawFrame()
 		{
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
+		fm->GetTextureStreamer()->FrameSubmitted();
 	#pragma endregion	
 
 	VkPresentInfoKHR presentInfo{};
@@ -552,6 +719,53 @@ void Renderer::DrawFrame()
 	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+void Renderer::UpdateScene()
+{
+	if (snapshots->Acquire())
+	{
+		//Swapped rather than moved so both keep their allocations
+		std::swap(previousScene, latestScene);
+		latestScene = *snapshots->GetReadSnapshot();
+
+		//Entities were added, removed or reordered in between, so there's nothing to blend from
+		if (previousScene.structureVersion != latestScene.structureVersion || previousScene.worlds.size() != latestScene.worlds.size())
+		{
+			previousScene = latestScene;
+		}
+	}
+
+	const double span = latestScene.time - previousScene.time;
+	const double renderTime = SceneSnapshot::ClockNow() - Welkin_Settings::SIMULATION_STEP_MS;
+	const float alpha = (span > 0.0) ? static_cast<float>(std::clamp((renderTime - previousScene.time) / span, 0.0, 1.0)) : 1.0f;
+
+	scene.time = previousScene.time + span * alpha;
+	scene.fixedVersion = latestScene.fixedVersion;
+	scene.structureVersion = latestScene.structureVersion;
+	scene.meshes = latestScene.meshes;
+	scene.materials = latestScene.materials;
+	scene.bounds = latestScene.bounds;
+	scene.mobilities = latestScene.mobilities;
+	scene.projection = latestScene.projection;
+	//Matrices are blended as position, rotation and scale, a lerped rotation matrix shrinks and shears partway through
+	//Once alpha reaches the latest step its matrices are used as they are, so objects whose world has shear are only off while they move
+	scene.camera = SnapshotPose::Blend(previousScene.camera, latestScene.camera, alpha);
+	scene.view = (alpha >= 1.0f) ? latestScene.view : glm::inverse(scene.camera.ToMatrix());
+
+	scene.worlds.resize(latestScene.worlds.size());
+	for (size_t i = 0; i < scene.worlds.size(); i++)
+	{
+		//Static and stationary objects jump, their region of the per transform buffer is only rewritten when the fixed version changes
+		if (latestScene.mobilities[i] == Mobility::DYNAMIC && previousScene.mobilities[i] == Mobility::DYNAMIC && alpha < 1.0f)
+		{
+			scene.worlds[i] = SnapshotPose::Blend(previousScene.poses[i], latestScene.poses[i], alpha).ToMatrix();
+		}
+		else
+		{
+			scene.worlds[i] = latestScene.worlds[i];
+		}
+	}
+}
+
 void Renderer::CreateSyncObjects()
 {
 	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -577,4 +791,170 @@ void Renderer::CreateSyncObjects()
 	}
 
 	Helper::Cout("Created Sync Objects");
-}
\ No newline at end of file
+}
+
+void Renderer::CullObjects()
+{
+	visibleObjects.clear();
+
+	const glm::mat4 view = scene.view;
+	const glm::mat4 projection = scene.projection;
+	const glm::mat4 viewProjection = projection * view;
+
+	//Gribb/Hartmann plane extraction, depth is zero to one so the near plane is just the third row
+	glm::vec4 planes[6];
+	for (int i = 0; i < 4; i++)
+	{
+		planes[0][i] = viewProjection[i][3] + viewProjection[i][0];
+		planes[1][i] = viewProjection[i][3] - viewProjection[i][0];
+		planes[2][i] = viewProjection[i][3] + viewProjection[i][1];
+		planes[3][i] = viewProjection[i][3] - viewProjection[i][1];
+		planes[4][i] = viewProjection[i][2];
+		planes[5][i] = viewProjection[i][3] - viewProjection[i][2];
+	}
+
+	for (auto& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	//Pixels covered by one world unit, one unit away from the camera
+	const float pixelsPerUnit = std::abs(projection[1][1]) * vCore->GetSwapchainExtent()->height * 0.5f;
+
+	const uint32_t objectCount = static_cast<uint32_t>(scene.worlds.size());
+
+	//Any change to the object list changes the fixed version too, so the cached spheres are redone along with the resize
+	const bool fixedChanged = spheresFixedVersion != scene.fixedVersion || objectSpheres.size() != objectCount;
+	spheresFixedVersion = scene.fixedVersion;
+
+	//Indices belong to other entities once the structure changes, so the remembered LODs start over
+	if (lodsStructureVersion != scene.structureVersion || objectLods.size() != objectCount)
+	{
+		objectLods.assign(objectCount, 0);
+		lodsStructureVersion = scene.structureVersion;
+	}
+
+	//Stable, so objects sharing a material and mesh keep their chunk order
+	if (drawOrderStructureVersion != scene.structureVersion || drawOrderFixedVersion != scene.fixedVersion || drawOrder.size() != objectCount)
+	{
+		drawOrder.resize(objectCount);
+		std::iota(drawOrder.begin(), drawOrder.end(), 0u);
+		std::stable_sort(drawOrder.begin(), drawOrder.end(), [&](uint32_t a, uint32_t b)
+		{
+			if (scene.materials[a] != scene.materials[b])
+			{
+				return std::less<Material*>()(scene.materials[a], scene.materials[b]);
+			}
+			return std::less<Mesh*>()(scene.meshes[a], scene.meshes[b]);
+		});
+		drawOrderStructureVersion = scene.structureVersion;
+		drawOrderFixedVersion = scene.fixedVersion;
+	}
+	objectMeshletJobs.resize(objectCount, -1);
+	objectSpheres.resize(objectCount);
+	objectScales.resize(objectCount);
+	objectInFrustum.resize(objectCount);
+
+	if (meshletCuller->IsEnabled())
+	{
+		//View matrix is the camera's inverse world matrix
+		meshletCuller->BeginFrame(planes, glm::vec3(glm::inverse(view)[3]));
+	}
+	if (impostorRenderer->IsEnabled())
+	{
+		impostorRenderer->BeginFrame();
+	}
+
+	//Spheres and frustum tests only touch their own object, the rest of the pass adds to shared lists so stays serial
+	jobSystem->ParallelFor(objectCount, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			if (fixedChanged || scene.mobilities[i] == Mobility::DYNAMIC)
+			{
+				const Bounds& bounds = scene.bounds[i];
+				const glm::mat4& world = scene.worlds[i];
+				objectScales[i] = std::max(std::max(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1]))), glm::length(glm::vec3(world[2])));
+				objectSpheres[i] = glm::vec4(glm::vec3(world * glm::vec4(bounds.center, 1.0f)), bounds.radius * objectScales[i]);
+			}
+
+			objectInFrustum[i] = 1;
+			for (const auto& plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), glm::vec3(objectSpheres[i])) + plane.w < -objectSpheres[i].w)
+				{
+					objectInFrustum[i] = 0;
+					break;
+				}
+			}
+		}
+	});
+
+	for (const uint32_t i : drawOrder)
+	{
+		if (!objectInFrustum[i])
+		{
+			continue;
+		}
+
+		Mesh* mesh = scene.meshes[i];
+		Material* material = scene.materials[i];
+		const glm::mat4& world = scene.worlds[i];
+
+		const glm::vec3 center = glm::vec3(objectSpheres[i]);
+		const float scale = objectScales[i];
+		const float radius = objectSpheres[i].w;
+
+		const float centerDistance = std::max(glm::length(glm::vec3(view * glm::vec4(center, 1.0f))), 0.01f);
+		const float projectedRadius = radius * pixelsPerUnit / centerDistance;
+
+		//Drawn as a quad with the impostor's own pipeline, once its atlas is baked
+		if (impostorRenderer->IsEnabled() && projectedRadius < Welkin_Settings::IMPOSTOR_MAX_PIXELS && impostorRenderer->AddInstance(mesh, material, world))
+		{
+			continue;
+		}
+
+		visibleObjects.push_back(i);
+
+		#pragma region LOD Selection
+			//Each LOD's error is a fraction of the bounding sphere, so its size on screen follows from the sphere's
+			const std::vector<MeshLod>& lods = mesh->GetLods();
+			const float pixelsPerError = projectedRadius / std::max(scene.bounds[i].radius, FLT_EPSILON);
+
+			uint32_t lod = std::min<uint32_t>(objectLods[i], static_cast<uint32_t>(lods.size()) - 1);
+
+			//Finer while the current LOD's error is too big to hide
+			while (lod > 0 && lods[lod].error * pixelsPerError > Welkin_Settings::MESH_LOD_ERROR_PIXELS)
+			{
+				lod--;
+			}
+			//Coarser only once the next LOD is comfortably under the threshold
+			while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerError < Welkin_Settings::MESH_LOD_ERROR_PIXELS * (1.0f - Welkin_Settings::MESH_LOD_HYSTERESIS))
+			{
+				lod++;
+			}
+
+			objectLods[i] = lod;
+
+			//Big LODs are split into meshlets, culled again on the GPU before drawing
+			objectMeshletJobs[i] = (meshletCuller->IsEnabled() && lods[lod].meshletCount > 0) ? meshletCuller->AddJob(mesh, lods[lod], world, scale) : -1;
+		#pragma endregion
+
+		#pragma region Texture Mip Request
+			//Texels per pixel at the closest point of the bounding sphere picks the mip, for every texture the material binds
+			const float distance = std::max(glm::length(glm::vec3(view * glm::vec4(center, 1.0f))) - radius, 0.01f);
+			const float screenPixelsPerUnit = pixelsPerUnit / distance;
+
+			for (Texture* texture : material->GetTextures())
+			{
+				if (!texture->IsResident())
+				{
+					continue;
+				}
+
+				const float texelsPerUnit = std::max(texture->texWidth, texture->texHeight) * mesh->GetUVDensity() / scale;
+				texture->RequestMip(static_cast<uint32_t>(std::log2(std::max(texelsPerUnit / screenPixelsPerUnit, 1.0f))));
+			}
+		#pragma endregion
+	}
+}
@@ -7,42 +7,71 @@
 #include "VulkanCore.h"
 #include "UniformBufferObject.h"
 #include "StorageBufferObject.h"
+#include "MeshletCuller.h"
+#include "ImpostorRenderer.h"
+#include "TransformEvaluator.h"
 #include "GameObject.h"
+#include "JobSystem.h"
+#include "SceneSnapshot.h"
 
 class Renderer
 {
 public:
-	Renderer(VulkanCore* vCore, FileManager* fm, Camera* mainCamera, vector<GameObject*>* gameObjects);
+	//Everything drawn is read from the snapshots, the renderer never touches the simulation's objects
+	Renderer(VulkanCore* vCore, FileManager* fm, SnapshotExchange* snapshots, JobSystem* jobSystem);
 	~Renderer();
 
 	//Getters
 	VkRenderPass* GetRenderPass() { return &this->renderPass; };
 
 	//Drawing
+	//Safe to call from a thread other than the simulation's
 	void DrawFrame();
+	//The simulation only has to copy TransformSystem's components into its snapshots when this is on
+	bool IsTransformEvaluationEnabled() { return this->transformEvaluator->IsEnabled(); };
 	unsigned short currentFrame = 0;
 
 private:
 
 	FileManager* fm;
+	JobSystem* jobSystem;
 	VulkanCore* vCore;
 	VkDevice* device;
-	Camera* mainCamera;
-	vector<GameObject*>* gameObjects;
+
+#pragma region Scene
+	//Takes the newest snapshot and blends the last two into scene for this frame's time
+	void UpdateScene();
+	SnapshotExchange* snapshots;
+	//Last two simulation steps, copied out of the exchange
+	SceneSnapshot previousScene;
+	SceneSnapshot latestScene;
+	//What this frame draws, one step behind the simulation so there's always a later step to blend towards
+	SceneSnapshot scene;
+#pragma endregion
 
 #pragma region Pipeline/Passes
 
-	void CreateGraphicsPipeline();
+	void CreatePipelineLayout();
+	//A null fragment shader makes a depth only pipeline that only reads the position stream
+	void CreateGraphicsPipeline(VkShaderModule* vertShaderModule, VkShaderModule* fragShaderModule, VertexFormat format, VkPipeline& pipeline);
 	void CreateRenderPass();
 
 	VkRenderPass renderPass;
 	VkPipeline graphicsPipeline;
+	//For meshes using VertexFormat::COMPACT, null if the compact shader wasn't compiled
+	VkPipeline compactPipeline = VK_NULL_HANDLE;
+	//Depth prepass pipelines, only made when the depth only shaders were compiled
+	bool depthPrepass = false;
+	VkPipeline depthPipeline = VK_NULL_HANDLE;
+	VkPipeline compactDepthPipeline = VK_NULL_HANDLE;
 	VkPipelineLayout pipelineLayout;
 
 	//Commands ---------------
 
 	void CreateCommandBuffers(VkCommandPool pool);
 	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	//Draws every visible object, depth only draws bind just the position stream
+	void RecordDraws(VkCommandBuffer commandBuffer, bool depthOnly);
 
 	std::vector<VkCommandBuffer> mainCommandBuffers;
 
@@ -51,6 +80,32 @@ private:
 
 #pragma endregion
 
+#pragma region Culling
+	//Frustum culls the objects, picks their LODs and tells their textures which mip they need
+	void CullObjects();
+	std::vector<unsigned int> visibleObjects;
+	//LOD each object drew with last, kept between frames for the hysteresis, reset when the scene's structure version changes
+	std::vector<uint32_t> objectLods;
+	uint32_t lodsStructureVersion = 0;
+	//Object indices sorted by material then mesh, visibleObjects comes out in this order so neighbouring draws share their bindings
+	//Snapshots are in chunk order, so this is redone whenever the structure or fixed version changes
+	std::vector<uint32_t> drawOrder;
+	uint32_t drawOrderStructureVersion = 0;
+	uint32_t drawOrderFixedVersion = 0;
+	//World space bounding sphere and largest axis scale per object
+	//Only recomputed for static and stationary objects when GameObject::GetFixedVersion changes
+	std::vector<glm::vec4> objectSpheres;
+	std::vector<float> objectScales;
+	//Frustum test result per object, filled in parallel before the serial LOD and impostor pass
+	std::vector<uint8_t> objectInFrustum;
+	uint32_t spheresFixedVersion = 0;
+	//Meshlet culling job each object draws with this frame, -1 draws its LOD whole
+	std::vector<int32_t> objectMeshletJobs;
+	MeshletCuller* meshletCuller;
+	//Takes over objects too small on screen to be worth their mesh
+	ImpostorRenderer* impostorRenderer;
+#pragma endregion
+
 #pragma region DrawFrame and Sync Objects
 	void CreateSyncObjects();
 	std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -61,6 +116,10 @@ private:
 #pragma region Buffers
 	vector<UniformBufferObject*> allUniformBufferObjects;
 	vector<StorageBufferObject*> allStorageBufferObjects;
+	//Also in allStorageBufferObjects, gives each object its instance ID
+	StorageBufferObject* perTransformBuffer;
+	//Fills the per transform buffer on the GPU when enabled
+	TransformEvaluator* transformEvaluator;
 #pragma endregion
 
 };
@@ -0,0 +1,73 @@
+#include "SceneSnapshot.h"
+#include <chrono>
+
+SnapshotPose SnapshotPose::FromMatrix(const glm::mat4& world)
+{
+	SnapshotPose pose;
+	pose.position = glm::vec3(world[3]);
+
+	glm::mat3 axes(world);
+	pose.scale = glm::vec3(glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2]));
+	//A quaternion can't mirror, so one axis carries the flip
+	if (glm::determinant(axes) < 0.0f)
+	{
+		pose.scale.x = -pose.scale.x;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		//A zero scaled axis has no direction left, the rotation of the other two still comes through
+		if (pose.scale[i] != 0.0f)
+		{
+			axes[i] /= pose.scale[i];
+		}
+	}
+	pose.rotation = glm::normalize(glm::quat_cast(axes));
+
+	return pose;
+}
+
+glm::mat4 SnapshotPose::ToMatrix() const
+{
+	const glm::mat3 axes = glm::mat3_cast(rotation);
+
+	glm::mat4 world(1.0f);
+	world[0] = glm::vec4(axes[0] * scale.x, 0.0f);
+	world[1] = glm::vec4(axes[1] * scale.y, 0.0f);
+	world[2] = glm::vec4(axes[2] * scale.z, 0.0f);
+	world[3] = glm::vec4(position, 1.0f);
+	return world;
+}
+
+SnapshotPose SnapshotPose::Blend(const SnapshotPose& from, const SnapshotPose& to, float alpha)
+{
+	SnapshotPose pose;
+	pose.position = glm::mix(from.position, to.position, alpha);
+	//glm::slerp flips one side when they're more than half a turn apart
+	pose.rotation = glm::slerp(from.rotation, to.rotation, alpha);
+	pose.scale = glm::mix(from.scale, to.scale, alpha);
+	return pose;
+}
+
+double SceneSnapshot::ClockNow()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SnapshotExchange::Publish()
+{
+	//Release so the reader sees everything written into the snapshot, acquire to get the one it gave back
+	writeIndex = middle.exchange(writeIndex | NEW_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+bool SnapshotExchange::Acquire()
+{
+	if ((middle.load(std::memory_order_acquire) & NEW_BIT) == 0)
+	{
+		return false;
+	}
+
+	//Only the writer can change middle in between, and it always sets NEW_BIT again, so this can't lose a snapshot
+	readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+	return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Components.h"
+
+//A world transform split back into its parts, so snapshots can be blended with slerp instead of by matrix
+struct SnapshotPose
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	//Negative x when the matrix mirrors
+	glm::vec3 scale = glm::vec3(1.0f);
+
+	//Shear, which only comes from a non-uniformly scaled parent, can't be represented and is dropped
+	static SnapshotPose FromMatrix(const glm::mat4& world);
+	glm::mat4 ToMatrix() const;
+	//Position and scale linearly, rotation along the shorter arc
+	static SnapshotPose Blend(const SnapshotPose& from, const SnapshotPose& to, float alpha);
+};
+
+//Everything the render thread reads from the simulation, copied out once per step so the two threads never share live state
+struct SceneSnapshot
+{
+	//Steady clock milliseconds the state is at, steps are SIMULATION_STEP_MS apart
+	double time = 0.0;
+	glm::mat4 view = glm::mat4(1.0f);
+	//Inverse of view, what the render thread blends the view between steps from
+	SnapshotPose camera;
+	glm::mat4 projection = glm::mat4(1.0f);
+	//One entry per drawable entity, in the order EntityRegistry's query visited them
+	std::vector<glm::mat4> worlds;
+	//worlds split into parts, only filled in for DYNAMIC objects since the others are never blended
+	std::vector<SnapshotPose> poses;
+	std::vector<Mesh*> meshes;
+	std::vector<Material*> materials;
+	std::vector<Bounds> bounds;
+	std::vector<Mobility> mobilities;
+	//GameObject::GetFixedVersion when this was taken
+	uint32_t fixedVersion = 0;
+	//EntityRegistry::GetStructureVersion when this was taken, per object state from an older snapshot doesn't line up with this one's if it differs
+	uint32_t structureVersion = 0;
+
+	//TransformSystem::WriteComponents output and each object's slot, only filled when transforms are evaluated on the GPU
+	uint32_t slotCount = 0;
+	std::vector<uint8_t> transformComponents;
+	std::vector<uint32_t> objectSlots;
+
+	//Steady clock milliseconds, what time is measured in
+	static double ClockNow();
+};
+
+//Lock free triple buffer between the simulation and render threads
+//The writer always has a snapshot to fill and the reader one to read, publishing and acquiring just swap theirs with the one in the middle, so neither ever waits
+class SnapshotExchange
+{
+public:
+	//Only touched by the simulation thread until Publish
+	SceneSnapshot* GetWriteSnapshot() { return &this->snapshots[writeIndex]; };
+	void Publish();
+
+	//Swaps in the newest published snapshot, false if nothing was published since the last call
+	bool Acquire();
+	//Only touched by the render thread, stays the same until the next Acquire that returns true
+	SceneSnapshot* GetReadSnapshot() { return &this->snapshots[readIndex]; };
+
+private:
+	static const uint32_t INDEX_MASK = 0x3;
+	//Set while the middle snapshot is one the reader hasn't taken yet
+	static const uint32_t NEW_BIT = 0x4;
+
+	SceneSnapshot snapshots[3];
+	uint32_t writeIndex = 0;
+	std::atomic<uint32_t> middle{ 1 };
+	uint32_t readIndex = 2;
+};
@@ -0,0 +1,55 @@
+#version 450
+
+//Depth prepass version of SimpleShaderCompact.vert, reads only the position stream
+
+//Buffers
+
+layout(push_constant) uniform PushConst
+{
+    uint instanceID;
+    uint materialID;
+    vec4 positionScale;
+    vec4 positionOffset;
+} 
+pushConst;
+
+//Per Frame ---------------------------------------
+layout(set = 0, binding = 0) uniform PerFrame 
+{
+    mat4 view;
+    mat4 proj;
+} 
+perFrame;
+
+//Per Transform ----------------------------------
+//Affine world matrix with its constant bottom row dropped, stored transposed so each column holds one row
+//vec4(position, 1.0) * world gives the world position
+struct PerTransformStruct
+{
+	mat3x4 world;
+};
+
+layout(std140, set = 2, binding = 0) readonly buffer PerTransformBuffer
+{
+    PerTransformStruct perTransforms[];
+} 
+perTransformBuffer;
+
+
+//IN - Position stream ---------------------------
+//CompactVertex, see Vertex.h
+layout(location = 0) in vec4 inQuantizedPosition;
+
+//OUT
+invariant gl_Position;
+
+
+void main() 
+{
+    vec3 inPosition = pushConst.positionOffset.xyz + pushConst.positionScale.xyz * inQuantizedPosition.xyz;
+
+    mat3x4 worldMatrix = perTransformBuffer.perTransforms[pushConst.instanceID].world;
+    vec3 worldPos = vec4(inPosition, 1.0) * worldMatrix;
+
+    gl_Position = perFrame.proj * perFrame.view * vec4(worldPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#version 450
+
+layout(push_constant) uniform PushConst
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    uint framesPerSide;
+} 
+pushConst;
+
+layout(set = 1, binding = 0) uniform sampler2D albedoAtlas;
+//rgb is the model space normal, a the baked depth
+layout(set = 1, binding = 1) uniform sampler2D normalAtlas;
+
+//IN
+layout(location = 0) in vec2 inAtlasUV;
+layout(location = 1) in vec3 inWorldPos;
+layout(location = 2) flat in vec3 inDepthAxis;
+
+//OUT
+layout(location = 0) out vec4 outColor;
+
+
+void main() 
+{
+    vec4 albedo = texture(albedoAtlas, inAtlasUV);
+    if (albedo.a < 0.5)
+    {
+        discard;
+    }
+
+    //Baked depth 0 is the near side of the bounding sphere and 1 the far side, the quad sits in the middle
+    float bakedDepth = texture(normalAtlas, inAtlasUV).a;
+    vec4 surface = pushConst.viewProjection * vec4(inWorldPos + inDepthAxis * (1.0 - 2.0 * bakedDepth), 1.0);
+    gl_FragDepth = surface.z / surface.w;
+
+    outColor = vec4(albedo.rgb, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#version 450
+
+//Camera facing quad for a far away object, textured with the baked frame closest to the direction it is seen from
+
+layout(push_constant) uniform PushConst
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    uint framesPerSide;
+} 
+pushConst;
+
+//ImpostorInstance, see ImpostorRenderer.h
+struct ImpostorInstance
+{
+    //w is the bounding radius in model space
+    vec4 center;
+    vec4 axes[3];
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer InstanceBuffer
+{
+    ImpostorInstance instances[];
+} 
+instanceBuffer;
+
+
+//OUT
+layout(location = 0) out vec2 outAtlasUV;
+layout(location = 1) out vec3 outWorldPos;
+//World space offset from the quad to the near side of the bounding sphere
+layout(location = 2) flat out vec3 outDepthAxis;
+
+
+//Two triangles, corners in frame space
+const vec2 corners[6] = vec2[](vec2(-1, -1), vec2(1, -1), vec2(1, 1), vec2(-1, -1), vec2(1, 1), vec2(-1, 1));
+
+//https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+vec2 EncodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+    {
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return e;
+}
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+void main() 
+{
+    ImpostorInstance instance = instanceBuffer.instances[gl_InstanceIndex];
+    mat3 axes = mat3(instance.axes[0].xyz, instance.axes[1].xyz, instance.axes[2].xyz);
+    float radius = instance.center.w;
+    float frames = float(pushConst.framesPerSide);
+
+    //Camera direction in model space picks the frame
+    vec3 toCamera = normalize(inverse(axes) * (pushConst.cameraPosition.xyz - instance.center.xyz));
+    vec2 frame = min(floor((EncodeOctahedral(toCamera) * 0.5 + 0.5) * frames), vec2(frames - 1.0));
+    vec3 frameDirection = DecodeOctahedral((frame + 0.5) / frames * 2.0 - 1.0);
+
+    //Same basis as ImpostorRenderer::Bake, so the quad covers exactly what the frame saw
+    vec3 up = abs(frameDirection.y) > 0.999 ? vec3(0, 0, 1) : vec3(0, 1, 0);
+    vec3 right = normalize(cross(up, frameDirection));
+    up = cross(frameDirection, right);
+
+    vec2 corner = corners[gl_VertexIndex];
+    outWorldPos = instance.center.xyz + axes * ((right * corner.x + up * corner.y) * radius);
+    outDepthAxis = axes * (frameDirection * radius);
+    outAtlasUV = (frame + corner * 0.5 + 0.5) / frames;
+
+    gl_Position = pushConst.viewProjection * vec4(outWorldPos, 1.0);
+}
\ No newline at end of file
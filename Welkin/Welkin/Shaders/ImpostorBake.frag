@@ -0,0 +1,21 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform sampler2D materialTexture;
+
+//IN
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in vec3 inNormal;
+
+//OUT
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+
+
+void main() 
+{
+    //Alpha is coverage, the clear leaves it 0 around the mesh
+    outAlbedo = vec4(texture(materialTexture, inUV).rgb, 1.0);
+
+    //Model space normal, and depth through the bounding sphere for Impostor.frag to rebuild the surface
+    outNormal = vec4(normalize(inNormal) * 0.5 + 0.5, gl_FragCoord.z);
+}
\ No newline at end of file
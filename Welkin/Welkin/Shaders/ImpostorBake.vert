@@ -0,0 +1,52 @@
+#version 450
+
+//Renders a mesh into one frame of its impostor atlas, see ImpostorRenderer::Bake
+
+layout(push_constant) uniform PushConst
+{
+    mat4 viewProjection;
+    vec4 positionScale;
+    vec4 positionOffset;
+    uint compact;
+} 
+pushConst;
+
+
+//IN - Vertex attributes -------------------------
+//Declared wide enough for both Vertex and CompactVertex, see Vertex.h
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inUV;
+layout(location = 2) in vec3 inNormal;
+
+//OUT
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out vec3 outNormal;
+
+
+//https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+void main() 
+{
+    vec3 position = inPosition.xyz;
+    vec3 normal = inNormal;
+
+    if (pushConst.compact != 0)
+    {
+        position = pushConst.positionOffset.xyz + pushConst.positionScale.xyz * inPosition.xyz;
+        normal = DecodeOctahedral(inNormal.xy);
+    }
+
+    //Frames are baked in model space, the impostor applies the object's transform
+    gl_Position = pushConst.viewProjection * vec4(position, 1.0);
+
+    outUV = inUV;
+    outNormal = normal;
+}
\ No newline at end of file
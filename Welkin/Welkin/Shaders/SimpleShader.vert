@@ -18,10 +18,11 @@ layout(set = 0, binding = 0) uniform PerFrame
 perFrame;
 
 //Per Transform ----------------------------------
+//Affine world matrix with its constant bottom row dropped, stored transposed so each column holds one row
+//vec4(position, 1.0) * world gives the world position
 struct PerTransformStruct
 {
-	mat4 world;
-	mat4 worldInverseTranspose;
+	mat3x4 world;
 };
 
 layout(std140, set = 2, binding = 0) readonly buffer PerTransformBuffer
@@ -35,9 +36,12 @@ perTransformBuffer;
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUV;
 layout(location = 2) in vec3 inNormal;
-layout(location = 3) in vec3 inTangent;
+//w is the handedness, bitangent = cross(normal, tangent.xyz) * w
+layout(location = 3) in vec4 inTangent;
 
 //OUT
+//Must match the depth only shaders bit for bit, or shading fails the depth test against the prepass
+invariant gl_Position;
 layout(location = 0) out vec2 outUV;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec3 outTangent;
@@ -46,18 +50,22 @@ layout(location = 3) out vec3 outWorldPos;
 
 void main() 
 {
-    mat4 worldMatrix = perTransformBuffer.perTransforms[pushConst.instanceID].world;
-    mat4 inverseTWorldMatrix = perTransformBuffer.perTransforms[pushConst.instanceID].worldInverseTranspose;
+    mat3x4 worldMatrix = perTransformBuffer.perTransforms[pushConst.instanceID].world;
+    vec3 worldPos = vec4(inPosition, 1.0) * worldMatrix;
 
+    outWorldPos = worldPos;
 
-    outWorldPos = vec3(worldMatrix * vec4(inPosition, 1.0));
-
-    gl_Position = perFrame.proj * perFrame.view * worldMatrix * vec4(inPosition, 1.0);
+    gl_Position = perFrame.proj * perFrame.view * vec4(worldPos, 1.0);
 
     outUV = inUV; // * perMaterial.uvScale;
 
     //Make sure the normal is in world space, and not local space, 
     //https://www.scratchapixel.com/lessons/mathematics-physics-for-computer-graphics/geometry/transforming-normals
-    outNormal = normalize(mat3(inverseTWorldMatrix) * inNormal);
-    outTangent = vec3(0, 0, 0); //normalize(mat3(Push.worldInverseTranspose) * inTangent);
+    //The cofactor matrix is the inverse transpose times the determinant, only the determinant's sign survives the normalize
+    //Holds for any scale or shear, so the normal matrix doesn't have to be uploaded
+    mat3 linear = transpose(mat3(worldMatrix));
+    vec3 crossYZ = cross(linear[1], linear[2]);
+    mat3 normalMatrix = mat3(crossYZ, cross(linear[2], linear[0]), cross(linear[0], linear[1]));
+    outNormal = normalize(normalMatrix * inNormal) * sign(dot(linear[0], crossYZ));
+    outTangent = vec3(0, 0, 0); //normalize(normalMatrix * inTangent.xyz);
 }
\ No newline at end of file
@@ -0,0 +1,86 @@
+#version 450
+
+//Buffers
+
+layout(push_constant) uniform PushConst
+{
+    uint instanceID;
+    uint materialID;
+    vec4 positionScale;
+    vec4 positionOffset;
+} 
+pushConst;
+
+//Per Frame ---------------------------------------
+layout(set = 0, binding = 0) uniform PerFrame 
+{
+    mat4 view;
+    mat4 proj;
+} 
+perFrame;
+
+//Per Transform ----------------------------------
+//Affine world matrix with its constant bottom row dropped, stored transposed so each column holds one row
+//vec4(position, 1.0) * world gives the world position
+struct PerTransformStruct
+{
+	mat3x4 world;
+};
+
+layout(std140, set = 2, binding = 0) readonly buffer PerTransformBuffer
+{
+    PerTransformStruct perTransforms[];
+} 
+perTransformBuffer;
+
+
+//IN - Vertex attributes -------------------------
+//CompactVertex, see Vertex.h, w is the tangent's handedness remapped to 0-1
+layout(location = 0) in vec4 inQuantizedPosition;
+layout(location = 1) in vec2 inUV;
+layout(location = 2) in vec2 inOctNormal;
+layout(location = 3) in vec2 inOctTangent;
+
+//OUT
+//Must match the depth only shaders bit for bit, or shading fails the depth test against the prepass
+invariant gl_Position;
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec3 outTangent;
+layout(location = 3) out vec3 outWorldPos;
+
+
+//https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+void main() 
+{
+    vec3 inPosition = pushConst.positionOffset.xyz + pushConst.positionScale.xyz * inQuantizedPosition.xyz;
+    vec3 inNormal = DecodeOctahedral(inOctNormal);
+
+    mat3x4 worldMatrix = perTransformBuffer.perTransforms[pushConst.instanceID].world;
+    vec3 worldPos = vec4(inPosition, 1.0) * worldMatrix;
+
+    outWorldPos = worldPos;
+
+    gl_Position = perFrame.proj * perFrame.view * vec4(worldPos, 1.0);
+
+    outUV = inUV; // * perMaterial.uvScale;
+
+    //Make sure the normal is in world space, and not local space, 
+    //https://www.scratchapixel.com/lessons/mathematics-physics-for-computer-graphics/geometry/transforming-normals
+    //The cofactor matrix is the inverse transpose times the determinant, only the determinant's sign survives the normalize
+    //Holds for any scale or shear, so the normal matrix doesn't have to be uploaded
+    mat3 linear = transpose(mat3(worldMatrix));
+    vec3 crossYZ = cross(linear[1], linear[2]);
+    mat3 normalMatrix = mat3(crossYZ, cross(linear[2], linear[0]), cross(linear[0], linear[1]));
+    outNormal = normalize(normalMatrix * inNormal) * sign(dot(linear[0], crossYZ));
+    outTangent = vec3(0, 0, 0); //normalize(normalMatrix * inTangent);
+}
\ No newline at end of file
@@ -1,3 +1,12 @@
 C:\VulkanSDK\1.3.216.0\Bin\glslc.exe SimpleShader.vert -o (C)SimpleShaderVert.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe SimpleShaderCompact.vert -o (C)SimpleShaderCompactVert.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe DepthOnly.vert -o (C)DepthOnlyVert.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe DepthOnlyCompact.vert -o (C)DepthOnlyCompactVert.spv
 C:\VulkanSDK\1.3.216.0\Bin\glslc.exe SimpleShader.frag -o (C)SimpleShaderFrag.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe MeshletCull.comp -o (C)MeshletCullComp.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe TransformEval.comp -o (C)TransformEvalComp.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe ImpostorBake.vert -o (C)ImpostorBakeVert.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe ImpostorBake.frag -o (C)ImpostorBakeFrag.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe Impostor.vert -o (C)ImpostorVert.spv
+C:\VulkanSDK\1.3.216.0\Bin\glslc.exe Impostor.frag -o (C)ImpostorFrag.spv
 pause
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "StaticBatcher.h"
+#include "MappedFile.h"
+#include <map>
+#include <algorithm>
+#include <tuple>
+#include <cmath>
+
+StaticBatcher::StaticBatcher(VulkanCore* vCore, EntityRegistry* registry, TransformSystem* transformSystem, JobSystem* jobSystem) : vCore{ vCore }, registry{ registry }, transformSystem{ transformSystem }, jobSystem{ jobSystem }
+{
+}
+
+StaticBatcher::~StaticBatcher()
+{
+	for (auto& mesh : batchMeshes)
+	{
+		delete mesh;
+	}
+}
+
+void StaticBatcher::Build(std::vector<GameObject*>& gameObjects)
+{
+	transformSystem->UpdateMatrices();
+
+	#pragma region Grouping
+		//Keyed by material, then by cell
+		using CellKey = std::tuple<std::string, int, int, int>;
+		std::map<CellKey, std::vector<GameObject*>> cells;
+
+		for (auto& gameObject : gameObjects)
+		{
+			if (gameObject->GetMobility() != Mobility::STATIC || gameObject->GetMesh()->GetCachePath().empty())
+			{
+				continue;
+			}
+
+			//Whole objects go in the cell their bounds center lands in, they aren't cut at cell borders
+			const glm::mat4 world = gameObject->GetWorldMatrix();
+			const glm::vec3 center = glm::vec3(world * glm::vec4(gameObject->GetMesh()->GetBoundsCenter(), 1.0f));
+			const glm::vec3 cell = center / Welkin_Settings::STATIC_BATCH_CELL_SIZE;
+
+			const CellKey key{ gameObject->GetMaterial()->GetMaterialName(), static_cast<int>(std::floor(cell.x)), static_cast<int>(std::floor(cell.y)), static_cast<int>(std::floor(cell.z)) };
+			cells[key].push_back(gameObject);
+		}
+	#pragma endregion
+
+	std::vector<GameObject*> batchedObjects;
+
+	for (auto& [key, members] : cells)
+	{
+		//Nothing to save by copying a lone object's vertices
+		if (members.size() < 2)
+		{
+			continue;
+		}
+
+		MeshData data;
+
+		for (auto& gameObject : members)
+		{
+			#pragma region Reading The Source Mesh
+				//Only LOD 0 is kept, the batch has no LODs of its own
+				MappedFile file(gameObject->GetMesh()->GetCachePath());
+				MeshCacheView view;
+
+				if (!MeshCache::ReadCache(file.GetData(), file.GetSize(), view))
+				{
+					throw std::runtime_error("Mesh cache " + gameObject->GetMesh()->GetCachePath() + " is corrupt!");
+				}
+
+				std::vector<Vertex> vertices;
+				std::vector<uint32_t> indices;
+				MeshCache::ReadVertexStreams(view, vertices, jobSystem);
+				MeshCache::ReadIndices(view, indices, jobSystem);
+			#pragma endregion
+
+			#pragma region Pre-Transforming
+				const glm::mat4 world = gameObject->GetWorldMatrix();
+				const glm::mat3 normalMatrix = glm::mat3(gameObject->GetWorldInverseTransposeMatrix());
+				//Mirroring transforms flip the winding, so the triangles are flipped back
+				const bool flipWinding = glm::determinant(glm::mat3(world)) < 0.0f;
+
+				const uint32_t baseVertex = static_cast<uint32_t>(data.vertices.size());
+				for (Vertex vertex : vertices)
+				{
+					vertex.position = glm::vec3(world * glm::vec4(vertex.position, 1.0f));
+					vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+					//Left alone when the mesh has none, normalizing zero would make NaNs
+					//Mirroring also flips which way the bitangent points
+					if (glm::dot(glm::vec3(vertex.tangent), glm::vec3(vertex.tangent)) > 0.0f)
+					{
+						vertex.tangent = glm::vec4(glm::normalize(glm::mat3(world) * glm::vec3(vertex.tangent)), flipWinding ? -vertex.tangent.w : vertex.tangent.w);
+					}
+					data.vertices.push_back(vertex);
+				}
+
+				//Every submesh of LOD 0 is appended back to back, so the whole batch stays one range
+				const MeshLod& lod = view.lods[0];
+				for (uint32_t s = lod.firstSubmesh; s < lod.firstSubmesh + lod.submeshCount; s++)
+				{
+					const Submesh& submesh = view.submeshes[s];
+					const uint32_t offset = baseVertex + submesh.vertexOffset;
+
+					for (uint32_t i = 0; i < submesh.indexCount; i += 3)
+					{
+						const uint32_t* triangle = &indices[submesh.firstIndex + i];
+						data.indices.push_back(offset + triangle[0]);
+						data.indices.push_back(offset + triangle[flipWinding ? 2 : 1]);
+						data.indices.push_back(offset + triangle[flipWinding ? 1 : 2]);
+					}
+				}
+			#pragma endregion
+		}
+
+		//One draw for the cell, unless it needs splitting for 16 bit indices
+		data.submeshes.push_back(Submesh{ 0, static_cast<uint32_t>(data.indices.size()), 0 });
+
+		const std::string batchName = "Static Batch " + std::get<0>(key) + " (" + std::to_string(std::get<1>(key)) + ", " + std::to_string(std::get<2>(key)) + ", " + std::to_string(std::get<3>(key)) + ")";
+		Mesh* batchMesh = new Mesh(batchName, data, vCore);
+		batchMeshes.push_back(batchMesh);
+
+		//Default transform, the vertices are already in world space
+		batchedObjects.push_back(new GameObject(batchName, batchMesh, members[0]->GetMaterial(), registry, transformSystem));
+		batchedObjects.back()->SetMobility(Mobility::STATIC);
+
+		for (auto& gameObject : members)
+		{
+			gameObjects.erase(std::find(gameObjects.begin(), gameObjects.end(), gameObject));
+			delete gameObject;
+		}
+
+		Helper::Cout("- Batched " + std::to_string(members.size()) + " objects into [" + batchName + "]");
+	}
+
+	//Draw order is sorted by the renderer, so batches just go at the end
+	gameObjects.insert(gameObjects.end(), batchedObjects.begin(), batchedObjects.end());
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include "VulkanCore.h"
+#include "GameObject.h"
+#include "Helper.h"
+#include "JobSystem.h"
+
+//Merges static GameObjects that share a material into one mesh per grid cell, with the vertices already in world space
+//Each batch replaces its objects with a single GameObject at the origin, so it is culled by its own bounds and drawn with one call per LOD submesh
+class StaticBatcher
+{
+public:
+	//Batch objects are entities in registry and get their transforms from transformSystem, source caches are decoded on jobSystem
+	StaticBatcher(VulkanCore* vCore, EntityRegistry* registry, TransformSystem* transformSystem, JobSystem* jobSystem);
+	//Batch meshes are owned here, the batch GameObjects are deleted with the rest of the scene
+	~StaticBatcher();
+
+	//Replaces every group of 2 or more static objects with the same material in the same cell with one batch object, the objects it replaced are deleted
+	//Objects whose mesh has no cache to read the vertices back from are left as they are
+	//Batch objects are appended to gameObjects
+	void Build(std::vector<GameObject*>& gameObjects);
+
+private:
+	VulkanCore* vCore;
+	EntityRegistry* registry;
+	TransformSystem* transformSystem;
+	JobSystem* jobSystem;
+	std::vector<Mesh*> batchMeshes;
+};
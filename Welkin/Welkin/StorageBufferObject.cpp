@@ -1,7 +1,7 @@
 #include "StorageBufferObject.h"
 
-StorageBufferObject::StorageBufferObject(StorageBufferType storageType, VulkanCore* vCore, FileManager* fm, Camera* mainCamera):
-	thisStorageType{storageType}, vCore{vCore}, fm{fm}, mainCamera{mainCamera}
+StorageBufferObject::StorageBufferObject(StorageBufferType storageType, VulkanCore* vCore, FileManager* fm, bool gpuWritten):
+	thisStorageType{storageType}, vCore{vCore}, fm{fm}, gpuWritten{gpuWritten}
 {
 	Helper::Cout("Creating Storage Buffer");
 	device = vCore->GetLogicalDevice();
@@ -35,9 +35,10 @@ void StorageBufferObject::CreateStorageBuffers()
 		storageBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 		storageBufferMemory.resize(MAX_FRAMES_IN_FLIGHT);
 
+		const VkMemoryPropertyFlags properties = gpuWritten ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
-			vCore->CreateBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, storageBuffers[i], storageBufferMemory[i]);
+			vCore->CreateBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, properties, storageBuffers[i], storageBufferMemory[i]);
 		}
 	}
 }
@@ -138,29 +139,82 @@ void StorageBufferObject::CreateDescriptorSets()
 	}
 }
 
-void StorageBufferObject::UpdateStorageBuffer(unsigned short currentFrame, vector<GameObject*>* allGameobjects)
+void StorageBufferObject::UpdateStorageBuffer(unsigned short currentFrame, const SceneSnapshot& scene)
 {
 	switch (thisStorageType)
 	{
 		case(StorageBufferType::PER_TRANSFORM):
 
-			if (allGameobjects == nullptr)
+			//The GPU written buffer still needs the instance IDs
+			UpdateInstanceLayout(scene);
+
+			if (gpuWritten)
 			{
-				throw std::runtime_error("inserted vector of gameobjects is nullptr in storageBufferObject");
+				return;
 			}
 
-
 			void* data;
-			vkMapMemory(*device, storageBufferMemory[currentFrame], 0, sizeof(Welkin_BufferStructs::PerTransformStruct), 0, &data);
+			vkMapMemory(*device, storageBufferMemory[currentFrame], 0, VK_WHOLE_SIZE, 0, &data);
 
 			Welkin_BufferStructs::PerTransformStruct* allTransformsStruct = (Welkin_BufferStructs::PerTransformStruct*)data;
-			for (int i = 0; i < allGameobjects->size(); i++)
+			if (!fixedRegionCurrent[currentFrame])
 			{
-				allTransformsStruct[i].world = allGameobjects->at(i)->GetTransform()->GetWorldMatrix();
-				allTransformsStruct[i].worldInverseTranspose = allGameobjects->at(i)->GetTransform()->GetWorldInverseTransposeMatrix();
+				for (const uint32_t i : fixedObjects)
+				{
+					WriteInstance(allTransformsStruct, scene.worlds[i], instanceIDs[i]);
+				}
+				fixedRegionCurrent[currentFrame] = true;
+			}
+
+			for (const uint32_t i : dynamicObjects)
+			{
+				WriteInstance(allTransformsStruct, scene.worlds[i], instanceIDs[i]);
 			}
 			
 			vkUnmapMemory(*device, storageBufferMemory[currentFrame]);
 			break;
 	}
-}
\ No newline at end of file
+}
+
+void StorageBufferObject::UpdateInstanceLayout(const SceneSnapshot& scene)
+{
+	if (layoutBuilt && layoutFixedVersion == scene.fixedVersion && instanceIDs.size() == scene.mobilities.size())
+	{
+		return;
+	}
+
+	if (scene.mobilities.size() > Welkin_Settings::MAX_OBJECTS)
+	{
+		throw std::runtime_error("More gameobjects than MAX_OBJECTS!");
+	}
+
+	fixedObjects.clear();
+	dynamicObjects.clear();
+	for (uint32_t i = 0; i < scene.mobilities.size(); i++)
+	{
+		(scene.mobilities[i] == Mobility::DYNAMIC ? dynamicObjects : fixedObjects).push_back(i);
+	}
+
+	instanceIDs.resize(scene.mobilities.size());
+	uint32_t instanceID = 0;
+	for (const uint32_t i : fixedObjects)
+	{
+		instanceIDs[i] = instanceID++;
+	}
+	for (const uint32_t i : dynamicObjects)
+	{
+		instanceIDs[i] = instanceID++;
+	}
+
+	layoutFixedVersion = scene.fixedVersion;
+	layoutBuilt = true;
+	fixedRegionCurrent.assign(MAX_FRAMES_IN_FLIGHT, false);
+}
+
+void StorageBufferObject::WriteInstance(Welkin_BufferStructs::PerTransformStruct* instances, const glm::mat4& world, uint32_t instanceID)
+{
+	for (int row = 0; row < 3; row++)
+	{
+		instances[instanceID].worldRows[row] = glm::vec4(world[0][row], world[1][row], world[2][row], world[3][row]);
+	}
+}
@@ -1,9 +1,8 @@
 #pragma once
 #include "VulkanCore.h"
 #include "FileManager.h"
-#include "Camera.h"
+#include "SceneSnapshot.h"
 #include "Helper.h"
-#include "GameObject.h"
 
 enum StorageBufferType { PER_TRANSFORM = 0 };
 
@@ -11,24 +10,43 @@ class StorageBufferObject
 {
 
 public:
-	StorageBufferObject(StorageBufferType storageType, VulkanCore* vCore, FileManager* fm, Camera* mainCamera);
+	//A GPU written buffer is device local and filled by a compute pass instead of UpdateStorageBuffer
+	StorageBufferObject(StorageBufferType storageType, VulkanCore* vCore, FileManager* fm, bool gpuWritten = false);
 	~StorageBufferObject();
 
 	VkDescriptorSetLayout* GetDescriptorSetLayout() { return &descriptorSetLayout; };
 	VkDescriptorSet GetDescriptorSet(unsigned short currentFrame) { return descriptorSets[currentFrame]; };
-	void UpdateStorageBuffer(unsigned short currentFrame, vector<GameObject*>* allGameobjects);
+	const vector<VkBuffer>& GetBuffers() { return storageBuffers; };
+	//Matrices and mobilities come from scene
+	void UpdateStorageBuffer(unsigned short currentFrame, const SceneSnapshot& scene);
+
+	//PER_TRANSFORM keeps static and stationary objects in a region at the front that is only rewritten when the scene's fixed version changes
+	//Dynamic objects are packed after it and rewritten every frame, so an object's instance ID isn't its index
+	const vector<uint32_t>& GetInstanceIDs() { return instanceIDs; };
 
 private:
 	VulkanCore* vCore;
 	VkDevice* device;
-	Camera* mainCamera;
 	StorageBufferType thisStorageType;
+	bool gpuWritten;
 	FileManager* fm;
 
 	//Storage Stuff
 	vector<VkBuffer> storageBuffers;
 	std::vector<VkDeviceMemory> storageBufferMemory;
 
+	//Instance layout, indexed like the scene's objects
+	vector<uint32_t> instanceIDs;
+	vector<uint32_t> fixedObjects;
+	vector<uint32_t> dynamicObjects;
+	uint32_t layoutFixedVersion = 0;
+	bool layoutBuilt = false;
+	//Per frame in flight, whether the fixed region in that frame's buffer is up to date with the layout
+	vector<bool> fixedRegionCurrent;
+
+	void UpdateInstanceLayout(const SceneSnapshot& scene);
+	void WriteInstance(Welkin_BufferStructs::PerTransformStruct* instances, const glm::mat4& world, uint32_t instanceID);
+
 	//Descriptor Stuff
 	std::vector<VkDescriptorSet> descriptorSets;
 	VkDescriptorSetLayout descriptorSetLayout;
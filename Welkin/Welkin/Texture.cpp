@@ -1,13 +1,93 @@
 #include "Texture.h"
+#include "MappedFile.h"
+#include <filesystem>
 
-Texture::Texture(std::string PATH, VulkanCore* vCore, short textureSpot): vCore{vCore}, textureSpot{textureSpot}
+Texture::Texture(std::string PATH, VulkanCore* vCore, short textureSpot) : Texture(PATH, vCore, textureSpot, nullptr)
 {
-	pixels = stbi_load(PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	targetMip = 0;
+	LoadFromDisk();
+	UploadNow();
+}
+
+Texture::Texture(std::string PATH, VulkanCore* vCore, short textureSpot, Texture* placeholder)
+	: vCore{vCore}, textureSpot{textureSpot}, path{PATH}, placeholder{placeholder}, pixels{nullptr}, texWidth{0}, texHeight{0}, texChannels{0}, imageSize{0}, mipLevels{1},
+	requestedMip{NO_MIP_REQUESTED}, targetMip{INITIAL_MIP}, stagingBuffer{VK_NULL_HANDLE}, stagingBufferMemory{VK_NULL_HANDLE}
+{
+	role = TextureImporter::GetRoleFromFileName(std::filesystem::path(PATH).filename().string());
+	format = TextureImporter::GetUncompressedFormat(role);
+}
+
+Texture::Texture(const uint8_t color[4], VulkanCore* vCore) : Texture("Placeholder", vCore, -1, nullptr)
+{
+	texWidth = 1;
+	texHeight = 1;
+	texChannels = 4;
+	imageSize = 4;
+	format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	CreateBuffers(color);
+	UploadNow();
+}
+
+Texture::~Texture()
+{
+	VkDevice* device = vCore->GetLogicalDevice();
+
+	DestroyImage(*device, current);
+	DestroyImage(*device, pending);
+
+	//Only still around if the texture never finished streaming
+	vkDestroyBuffer(*device, stagingBuffer, nullptr);
+	vkFreeMemory(*device, stagingBufferMemory, nullptr);
+}
+
+void Texture::DestroyImage(VkDevice device, TextureImage& image)
+{
+	vkDestroyImageView(device, image.view, nullptr);
+	vkDestroyImage(device, image.image, nullptr);
+	vkFreeMemory(device, image.memory, nullptr);
+	image = TextureImage{};
+}
+
+VkDeviceSize Texture::GetMipChainSize(uint32_t baseMip)
+{
+	if (levelSizes.empty())
+	{
+		return imageSize;
+	}
+
+	VkDeviceSize size = 0;
+	for (uint32_t i = std::min(baseMip, mipLevels - 1); i < mipLevels; i++)
+	{
+		size += levelSizes[i];
+	}
+
+	return size;
+}
+
+uint32_t Texture::ConsumeRequestedMip()
+{
+	uint32_t mip = requestedMip;
+	requestedMip = NO_MIP_REQUESTED;
+	return mip;
+}
+
+void Texture::LoadFromDisk()
+{
+	Helper::Cout("Creating buffers and images for: " + path);
+
+	if (Welkin_Settings::USE_COMPRESSED_TEXTURES && vCore->IsTextureCompressionBCEnabled() && CreateCompressedBuffers())
+	{
+		return;
+	}
+
+	//Uncompressed images only have one mip, so they are always fully resident
+	pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 	imageSize = texWidth * texHeight * 4;
 
 	if (!pixels)
 	{
-		throw std::runtime_error("failed to load" + PATH + " texture image!");
+		throw std::runtime_error("failed to load" + path + " texture image!");
 	}
 
 	if (imageSize <= 0)
@@ -15,44 +95,165 @@ Texture::Texture(std::string PATH, VulkanCore* vCore, short textureSpot): vCore{
 		throw std::runtime_error("Image size can't be smaller then 0!");
 	}
 
-	Helper::Cout("Creating buffers, images, and views for: " + PATH);
+	CreateBuffers(pixels);
 
-	CreateBuffers();
-	textureImageView = vCore->CreateImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+	stbi_image_free(pixels);
+	pixels = nullptr;
 }
 
-Texture::~Texture()
+void Texture::RecordUpload(VkCommandBuffer commandBuffer)
 {
-	vkDestroyImageView(*vCore->GetLogicalDevice(), textureImageView, nullptr);
-	vkDestroyImage(*vCore->GetLogicalDevice(), textureImage, nullptr);
-	vkFreeMemory(*vCore->GetLogicalDevice(), textureImageMemory, nullptr);
+	vCore->RecordImageLayoutTransition(commandBuffer, pending.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pending.levelCount);
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, pending.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+	vCore->RecordImageLayoutTransition(commandBuffer, pending.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, pending.levelCount);
 }
 
-void Texture::CreateBuffers()
+TextureImage Texture::FinishUpload()
 {
 	VkDevice* device = vCore->GetLogicalDevice();
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	vkDestroyBuffer(*device, stagingBuffer, nullptr);
+	vkFreeMemory(*device, stagingBufferMemory, nullptr);
+	stagingBuffer = VK_NULL_HANDLE;
+	stagingBufferMemory = VK_NULL_HANDLE;
+	copyRegions.clear();
+
+	pending.view = vCore->CreateImageView(pending.image, format, pending.levelCount);
+
+	TextureImage replaced = current;
+	current = pending;
+	pending = TextureImage{};
+	imageSize = current.size;
+
+	return replaced;
+}
+
+void Texture::UploadNow()
+{
+	vCore->TransitionImageLayout(pending.image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pending.levelCount);
+	vCore->CopyBufferToImage(stagingBuffer, pending.image, copyRegions);
+	vCore->TransitionImageLayout(pending.image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, pending.levelCount);
+
+	TextureImage replaced = FinishUpload();
+	DestroyImage(*vCore->GetLogicalDevice(), replaced);
+}
+
+void Texture::CreateBuffers(const uint8_t* source)
+{
+	VkDevice* device = vCore->GetLogicalDevice();
 
 	vCore->CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
 	void* data;
 	vkMapMemory(*device, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
+	memcpy(data, source, static_cast<size_t>(imageSize));
 	vkUnmapMemory(*device, stagingBufferMemory);
 
-	stbi_image_free(pixels);
-
 	//------------Creating the acutal img and buffers ------------
 
-	vCore->CreateImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-	vCore->TransitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	vCore->CopyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	vCore->TransitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	pending = TextureImage{};
+	pending.size = imageSize;
+	vCore->CreateImage(texWidth, texHeight, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pending.image, pending.memory);
 
-	vkDestroyBuffer(*device, stagingBuffer, nullptr);
-	vkFreeMemory(*device, stagingBufferMemory, nullptr);
+	copyRegions.resize(1);
+	copyRegions[0] = {};
+	copyRegions[0].bufferOffset = 0;
+	copyRegions[0].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegions[0].imageSubresource.mipLevel = 0;
+	copyRegions[0].imageSubresource.baseArrayLayer = 0;
+	copyRegions[0].imageSubresource.layerCount = 1;
+	copyRegions[0].imageOffset = { 0, 0, 0 };
+	copyRegions[0].imageExtent = { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1 };
+}
+
+bool Texture::CreateCompressedBuffers()
+{
+	const std::string cachePath = TextureImporter::GetCachePath(path);
+
+	if (!TextureImporter::IsCacheUpToDate(path, cachePath))
+	{
+		TextureImporter::ImportTexture(path, cachePath, role);
+	}
+
+	MappedFile file(cachePath);
+	KTX2Info info;
+
+	if (!TextureImporter::ReadKTX2(file.GetData(), file.GetSize(), info))
+	{
+		Helper::Warning(cachePath + " is not a supported KTX2 file, using the source image instead");
+		return false;
+	}
+
+	if (!vCore->IsFormatSampleable(info.format))
+	{
+		Helper::Warning(cachePath + " format can't be sampled on this device, using the source image instead");
+		return false;
+	}
+
+	//Description of the full chain only gets filled once, the streamer reads it while later loads run
+	if (levelSizes.empty())
+	{
+		format = info.format;
+		texWidth = static_cast<int>(info.width);
+		texHeight = static_cast<int>(info.height);
+		texChannels = (role == TextureRole::NORMAL) ? 2 : (role == TextureRole::COLOR) ? 3 : 1;
+		mipLevels = static_cast<uint32_t>(info.levels.size());
+
+		for (const auto& level : info.levels)
+		{
+			levelSizes.push_back(level.size);
+		}
+	}
+
+	uint32_t baseMip = std::min(targetMip, mipLevels - 1);
+	if (targetMip == INITIAL_MIP)
+	{
+		baseMip = 0;
+		while (baseMip < mipLevels - 1 && std::max(info.levels[baseMip].width, info.levels[baseMip].height) > Welkin_Settings::TEXTURE_INITIAL_MAX_SIZE)
+		{
+			baseMip++;
+		}
+	}
+
+	pending = TextureImage{};
+	pending.baseMip = baseMip;
+	pending.levelCount = mipLevels - baseMip;
+	pending.size = GetMipChainSize(baseMip);
+
+	VkDevice* device = vCore->GetLogicalDevice();
+
+	vCore->CreateBuffer(pending.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+	//Block data is already in its GPU layout, so every level goes straight from the mapped file into the staging buffer
+	copyRegions.resize(pending.levelCount);
+	VkDeviceSize stagingOffset = 0;
+
+	void* data;
+	vkMapMemory(*device, stagingBufferMemory, 0, pending.size, 0, &data);
+
+	for (uint32_t i = 0; i < pending.levelCount; i++)
+	{
+		const KTX2Level& level = info.levels[baseMip + i];
+		memcpy(static_cast<uint8_t*>(data) + stagingOffset, file.GetData() + level.offset, static_cast<size_t>(level.size));
+
+		copyRegions[i] = {};
+		copyRegions[i].bufferOffset = stagingOffset;
+		copyRegions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegions[i].imageSubresource.mipLevel = i;
+		copyRegions[i].imageSubresource.baseArrayLayer = 0;
+		copyRegions[i].imageSubresource.layerCount = 1;
+		copyRegions[i].imageOffset = { 0, 0, 0 };
+		copyRegions[i].imageExtent = { level.width, level.height, 1 };
+
+		stagingOffset += level.size;
+	}
+
+	vkUnmapMemory(*device, stagingBufferMemory);
+
+	const KTX2Level& baseLevel = info.levels[baseMip];
+	vCore->CreateImage(baseLevel.width, baseLevel.height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pending.image, pending.memory, pending.levelCount);
+
+	return true;
 }
 
 //TODO All of the helper functions that submit commands so far have been set up to execute synchronously by waiting for the queue to become idle. For practical applications it is recommended to combine these operations in a single command buffer and execute them asynchronously for higher throughput, especially the transitions and copy in the createTextureImage function. Try to experiment with this by creating a setupCommandBuffer that the helper functions record commands into, and add a flushSetupCommands to execute the commands that have been recorded so far. It's best to do this after the texture mapping works to check if the texture resources are still set up correctly.
\ No newline at end of file
@@ -1,29 +1,100 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <string>
+#include <vector>
 #include <stdexcept>
+#include <algorithm>
 #include <stb_image.h>
 #include "VulkanCore.h"
 #include "Helper.h"
+#include "TextureImporter.h"
+
+//GPU image holding a range of a texture's mip chain
+struct TextureImage
+{
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	//Mip of the full chain stored in level 0 of this image
+	uint32_t baseMip = 0;
+	uint32_t levelCount = 1;
+	VkDeviceSize size = 0;
+};
 
 class Texture
 {
 public:
 	stbi_uc* pixels;
+	//Size of the full resolution image
 	int texWidth, texHeight, texChannels;
+	//Bytes currently resident on the GPU
 	VkDeviceSize imageSize;
 	short textureSpot;
+	TextureRole role;
+	VkFormat format;
+	//Length of the full mip chain on disk
+	uint32_t mipLevels;
 
+	//Loads and uploads right away
 	Texture(std::string PATH, VulkanCore* vCore, short textureSpot);
+	//Streamed, shows the placeholder until the TextureStreamer makes it resident
+	Texture(std::string PATH, VulkanCore* vCore, short textureSpot, Texture* placeholder);
+	//Single colored 1x1 texture
+	Texture(const uint8_t color[4], VulkanCore* vCore);
 	~Texture();
 
-	VkImageView* GetTextureImageView() { return &this->textureImageView; };
+	VkImageView* GetTextureImageView() { return (IsResident() || placeholder == nullptr) ? &this->current.view : placeholder->GetTextureImageView(); };
+	bool IsResident() { return this->current.view != VK_NULL_HANDLE; };
+
+	#pragma region Mip Streaming
+		//Loads the largest mip that fits Welkin_Settings::TEXTURE_INITIAL_MAX_SIZE
+		static const uint32_t INITIAL_MIP = UINT32_MAX;
+		static const uint32_t NO_MIP_REQUESTED = UINT32_MAX;
+
+		uint32_t GetResidentMip() { return this->current.baseMip; };
+		VkDeviceSize GetResidentSize() { return this->current.size; };
+		//Bytes the image would take with baseMip as its finest level
+		VkDeviceSize GetMipChainSize(uint32_t baseMip);
+
+		//Culling reports the finest mip it needs, the streamer reads and resets it once per frame
+		void RequestMip(uint32_t mip) { requestedMip = std::min(requestedMip, mip); };
+		uint32_t ConsumeRequestedMip();
+		//Finest mip the next LoadFromDisk will load, set by the streamer before queuing the texture
+		void SetTargetMip(uint32_t mip) { targetMip = mip; };
+		bool HasPendingUpload() { return this->pending.image != VK_NULL_HANDLE; };
+		//Bytes LoadFromDisk staged for the next upload, what RecordUpload will copy
+		VkDeviceSize GetPendingUploadSize() { return this->pending.size; };
+	#pragma endregion
+
+	//Streaming steps. LoadFromDisk can run on a worker thread, the other two have to be on the main thread
+	void LoadFromDisk();
+	void RecordUpload(VkCommandBuffer commandBuffer);
+	//Swaps in the uploaded image and returns the one it replaced, which has to stay alive until no frame in flight uses it
+	TextureImage FinishUpload();
+
+	static void DestroyImage(VkDevice device, TextureImage& image);
 
 private:
 	VulkanCore* vCore;
+	std::string path;
+	Texture* placeholder;
+
+	void CreateBuffers(const uint8_t* source);
+	//Loads the KTX2 cache of the image, importing it first if it's missing or out of date
+	bool CreateCompressedBuffers();
+	void UploadNow();
+
+	//Image being sampled, and the one being loaded to replace it
+	TextureImage current;
+	TextureImage pending;
+
+	//Filled on the first load, sizes of every mip level on disk
+	std::vector<VkDeviceSize> levelSizes;
+	uint32_t requestedMip;
+	uint32_t targetMip;
 
-	void CreateBuffers();
-	VkImage textureImage;
-	VkImageView textureImageView;
-	VkDeviceMemory textureImageMemory;
-};
\ No newline at end of file
+	//Filled by LoadFromDisk, released once the upload is done
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	std::vector<VkBufferImageCopy> copyRegions;
+};
@@ -0,0 +1,640 @@
+#include "TextureImporter.h"
+#include "Helper.h"
+#include <stb_image.h>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	//Identifier + header + index, the level index starts right after
+	const size_t KTX2_LEVEL_INDEX_OFFSET = 80;
+
+	//Khronos data format descriptor values for the formats written here
+	const uint8_t KHR_DF_MODEL_BC1A = 128;
+	const uint8_t KHR_DF_MODEL_BC4 = 131;
+	const uint8_t KHR_DF_MODEL_BC5 = 132;
+	const uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+	const uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+	const uint8_t KHR_DF_TRANSFER_SRGB = 2;
+
+	struct MipImage
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint8_t> rgba;
+	};
+
+#pragma region Mip Generation
+
+	float SrgbToLinear(uint8_t value)
+	{
+		float c = value / 255.0f;
+		return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	uint8_t LinearToSrgb(float c)
+	{
+		c = std::clamp(c, 0.0f, 1.0f);
+		float s = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return static_cast<uint8_t>(s * 255.0f + 0.5f);
+	}
+
+	//2x2 box filter. Color is filtered in linear space and normals are renormalized
+	MipImage Downsample(const MipImage& src, TextureRole role)
+	{
+		MipImage dst;
+		dst.width = std::max(1u, src.width / 2);
+		dst.height = std::max(1u, src.height / 2);
+		dst.rgba.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+
+		for (uint32_t y = 0; y < dst.height; y++)
+		{
+			for (uint32_t x = 0; x < dst.width; x++)
+			{
+				float sum[4] = { 0, 0, 0, 0 };
+
+				for (uint32_t i = 0; i < 4; i++)
+				{
+					uint32_t sx = std::min(x * 2 + (i & 1), src.width - 1);
+					uint32_t sy = std::min(y * 2 + (i >> 1), src.height - 1);
+					const uint8_t* texel = &src.rgba[(static_cast<size_t>(sy) * src.width + sx) * 4];
+
+					for (int c = 0; c < 4; c++)
+					{
+						sum[c] += (role == TextureRole::COLOR && c < 3) ? SrgbToLinear(texel[c]) : texel[c] / 255.0f;
+					}
+				}
+
+				for (int c = 0; c < 4; c++)
+				{
+					sum[c] *= 0.25f;
+				}
+
+				if (role == TextureRole::NORMAL)
+				{
+					float n[3] = { sum[0] * 2 - 1, sum[1] * 2 - 1, sum[2] * 2 - 1 };
+					float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					if (length > 0.0001f)
+					{
+						for (int c = 0; c < 3; c++)
+						{
+							sum[c] = (n[c] / length) * 0.5f + 0.5f;
+						}
+					}
+				}
+
+				uint8_t* out = &dst.rgba[(static_cast<size_t>(y) * dst.width + x) * 4];
+				for (int c = 0; c < 4; c++)
+				{
+					out[c] = (role == TextureRole::COLOR && c < 3) ? LinearToSrgb(sum[c]) : static_cast<uint8_t>(std::clamp(sum[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+				}
+			}
+		}
+
+		return dst;
+	}
+
+#pragma endregion
+
+#pragma region Block Compression
+
+	//Edge blocks repeat the last row/column
+	void FetchBlock(const MipImage& img, uint32_t blockX, uint32_t blockY, uint8_t block[16][4])
+	{
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t x = std::min(blockX * 4 + (i & 3), img.width - 1);
+			uint32_t y = std::min(blockY * 4 + (i >> 2), img.height - 1);
+			memcpy(block[i], &img.rgba[(static_cast<size_t>(y) * img.width + x) * 4], 4);
+		}
+	}
+
+	uint16_t PackRGB565(const float color[3])
+	{
+		uint16_t r = static_cast<uint16_t>(std::clamp(color[0] * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f));
+		uint16_t g = static_cast<uint16_t>(std::clamp(color[1] * 63.0f / 255.0f + 0.5f, 0.0f, 63.0f));
+		uint16_t b = static_cast<uint16_t>(std::clamp(color[2] * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRGB565(uint16_t packed, float color[3])
+	{
+		uint32_t r = (packed >> 11) & 31;
+		uint32_t g = (packed >> 5) & 63;
+		uint32_t b = packed & 31;
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+	}
+
+	//Quantizes both endpoints, picks the closest palette entry for every texel and returns the squared error
+	float BuildBC1(const uint8_t block[16][4], const float end0[3], const float end1[3], uint16_t& color0, uint16_t& color1, uint32_t& indices)
+	{
+		color0 = PackRGB565(end0);
+		color1 = PackRGB565(end1);
+
+		//color0 > color1 keeps the block in the opaque 4 color mode
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		float palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3.0f;
+		}
+
+		int paletteSize = (color0 == color1) ? 1 : 4;
+		float totalError = 0;
+		indices = 0;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			float bestError = FLT_MAX;
+			uint32_t bestIndex = 0;
+
+			for (int p = 0; p < paletteSize; p++)
+			{
+				float error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					float d = block[i][c] - palette[p][c];
+					error += d * d;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (i * 2);
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	void EncodeBC1Block(const uint8_t block[16][4], uint8_t* out)
+	{
+		#pragma region Principal Axis
+			float mean[3] = { 0, 0, 0 };
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					mean[c] += block[i][c] / 16.0f;
+				}
+			}
+
+			float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				float r = block[i][0] - mean[0];
+				float g = block[i][1] - mean[1];
+				float b = block[i][2] - mean[2];
+				covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+				covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+			}
+
+			//Power iteration converges quickly enough for a 4x4 block
+			float axis[3] = { 1, 1, 1 };
+			for (int iteration = 0; iteration < 4; iteration++)
+			{
+				float x = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+				float y = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+				float z = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+				float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+
+				if (length < 0.0001f)
+				{
+					break;
+				}
+
+				axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+			}
+
+			float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			for (int c = 0; c < 3; c++)
+			{
+				axis[c] /= axisLength;
+			}
+		#pragma endregion
+
+		float minProjection = FLT_MAX;
+		float maxProjection = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			float projection = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		//Inset the endpoints a bit so the interpolated colors land on the actual texels
+		float inset = (maxProjection - minProjection) / 16.0f;
+		float end0[3], end1[3];
+		for (int c = 0; c < 3; c++)
+		{
+			end0[c] = std::clamp(mean[c] + axis[c] * (maxProjection - inset), 0.0f, 255.0f);
+			end1[c] = std::clamp(mean[c] + axis[c] * (minProjection + inset), 0.0f, 255.0f);
+		}
+
+		uint16_t color0, color1;
+		uint32_t indices;
+		float error = BuildBC1(block, end0, end1, color0, color1, indices);
+
+		#pragma region Least Squares Refit
+			//Solve for the endpoints that best fit the chosen indices, keep them if they are better
+			const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+			float alpha2 = 0, beta2 = 0, alphaBeta = 0;
+			float alphaX[3] = { 0, 0, 0 };
+			float betaX[3] = { 0, 0, 0 };
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				float alpha = weights[(indices >> (i * 2)) & 3];
+				float beta = 1.0f - alpha;
+				alpha2 += alpha * alpha;
+				beta2 += beta * beta;
+				alphaBeta += alpha * beta;
+
+				for (int c = 0; c < 3; c++)
+				{
+					alphaX[c] += alpha * block[i][c];
+					betaX[c] += beta * block[i][c];
+				}
+			}
+
+			float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+			if (std::fabs(determinant) > 0.0001f)
+			{
+				float refit0[3], refit1[3];
+				for (int c = 0; c < 3; c++)
+				{
+					refit0[c] = std::clamp((alphaX[c] * beta2 - betaX[c] * alphaBeta) / determinant, 0.0f, 255.0f);
+					refit1[c] = std::clamp((betaX[c] * alpha2 - alphaX[c] * alphaBeta) / determinant, 0.0f, 255.0f);
+				}
+
+				uint16_t refitColor0, refitColor1;
+				uint32_t refitIndices;
+				float refitError = BuildBC1(block, refit0, refit1, refitColor0, refitColor1, refitIndices);
+
+				if (refitError < error)
+				{
+					color0 = refitColor0;
+					color1 = refitColor1;
+					indices = refitIndices;
+				}
+			}
+		#pragma endregion
+
+		memcpy(out, &color0, 2);
+		memcpy(out + 2, &color1, 2);
+		memcpy(out + 4, &indices, 4);
+	}
+
+	//Single channel, 8 interpolated values between the min and max of the block
+	void EncodeBC4Block(const uint8_t block[16][4], int channel, uint8_t* out)
+	{
+		uint8_t minValue = 255;
+		uint8_t maxValue = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			minValue = std::min(minValue, block[i][channel]);
+			maxValue = std::max(maxValue, block[i][channel]);
+		}
+
+		memset(out, 0, 8);
+		out[0] = maxValue;
+		out[1] = minValue;
+
+		if (maxValue == minValue)
+		{
+			return;
+		}
+
+		float palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int i = 2; i < 8; i++)
+		{
+			palette[i] = ((8 - i) * maxValue + (i - 1) * minValue) / 7.0f;
+		}
+
+		uint64_t indices = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			float bestError = FLT_MAX;
+			uint64_t bestIndex = 0;
+
+			for (int p = 0; p < 8; p++)
+			{
+				float error = std::fabs(block[i][channel] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (i * 3);
+		}
+
+		//48 bits of indices after the two endpoints
+		for (int b = 0; b < 6; b++)
+		{
+			out[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+		}
+	}
+
+	uint32_t GetBlockSize(TextureRole role)
+	{
+		//BC5 is two BC4 blocks
+		return (role == TextureRole::NORMAL) ? 16 : 8;
+	}
+
+	std::vector<uint8_t> EncodeLevel(const MipImage& img, TextureRole role)
+	{
+		const uint32_t blocksX = (img.width + 3) / 4;
+		const uint32_t blocksY = (img.height + 3) / 4;
+		const uint32_t blockSize = GetBlockSize(role);
+
+		std::vector<uint8_t> encoded(static_cast<size_t>(blocksX) * blocksY * blockSize);
+		uint8_t block[16][4];
+
+		for (uint32_t by = 0; by < blocksY; by++)
+		{
+			for (uint32_t bx = 0; bx < blocksX; bx++)
+			{
+				FetchBlock(img, bx, by, block);
+				uint8_t* out = &encoded[(static_cast<size_t>(by) * blocksX + bx) * blockSize];
+
+				switch (role)
+				{
+				case TextureRole::COLOR:
+					EncodeBC1Block(block, out);
+					break;
+				case TextureRole::NORMAL:
+					EncodeBC4Block(block, 0, out);
+					EncodeBC4Block(block, 1, out + 8);
+					break;
+				default:
+					EncodeBC4Block(block, 0, out);
+					break;
+				}
+			}
+		}
+
+		return encoded;
+	}
+
+#pragma endregion
+
+#pragma region KTX2 Writing
+
+	size_t Align(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	void WriteU32(std::vector<uint8_t>& file, size_t offset, uint32_t value) { memcpy(&file[offset], &value, 4); }
+	void WriteU64(std::vector<uint8_t>& file, size_t offset, uint64_t value) { memcpy(&file[offset], &value, 8); }
+
+	void WriteKTX2(const std::string& path, TextureRole role, const MipImage& baseLevel, const std::vector<std::vector<uint8_t>>& levels)
+	{
+		const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+		const uint32_t blockSize = GetBlockSize(role);
+		const uint32_t sampleCount = (role == TextureRole::NORMAL) ? 2 : 1;
+
+		const size_t dfdOffset = KTX2_LEVEL_INDEX_OFFSET + levelCount * 24;
+		const size_t dfdSize = 4 + 24 + 16 * sampleCount;
+
+		//Levels are stored smallest first, each aligned to the block size
+		std::vector<size_t> levelOffsets(levelCount);
+		size_t cursor = dfdOffset + dfdSize;
+		for (int i = levelCount - 1; i >= 0; i--)
+		{
+			levelOffsets[i] = Align(cursor, blockSize);
+			cursor = levelOffsets[i] + levels[i].size();
+		}
+
+		std::vector<uint8_t> file(cursor, 0);
+
+		#pragma region Header and Index
+			memcpy(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+			WriteU32(file, 12, TextureImporter::GetCompressedFormat(role));
+			WriteU32(file, 16, 1); //typeSize
+			WriteU32(file, 20, baseLevel.width);
+			WriteU32(file, 24, baseLevel.height);
+			WriteU32(file, 28, 0); //pixelDepth
+			WriteU32(file, 32, 0); //layerCount
+			WriteU32(file, 36, 1); //faceCount
+			WriteU32(file, 40, levelCount);
+			WriteU32(file, 44, 0); //supercompressionScheme
+
+			WriteU32(file, 48, static_cast<uint32_t>(dfdOffset));
+			WriteU32(file, 52, static_cast<uint32_t>(dfdSize));
+			//No key/value or supercompression data
+			WriteU32(file, 56, 0);
+			WriteU32(file, 60, 0);
+			WriteU64(file, 64, 0);
+			WriteU64(file, 72, 0);
+
+			for (uint32_t i = 0; i < levelCount; i++)
+			{
+				size_t entry = KTX2_LEVEL_INDEX_OFFSET + i * 24;
+				WriteU64(file, entry, levelOffsets[i]);
+				WriteU64(file, entry + 8, levels[i].size());
+				WriteU64(file, entry + 16, levels[i].size());
+			}
+		#pragma endregion
+
+		#pragma region Data Format Descriptor
+			WriteU32(file, dfdOffset, static_cast<uint32_t>(dfdSize));
+			//Khronos basic descriptor block, version 2
+			WriteU32(file, dfdOffset + 4, 0);
+			WriteU32(file, dfdOffset + 8, 2 | static_cast<uint32_t>((24 + 16 * sampleCount) << 16));
+
+			uint8_t colorModel = (role == TextureRole::COLOR) ? KHR_DF_MODEL_BC1A : (role == TextureRole::NORMAL) ? KHR_DF_MODEL_BC5 : KHR_DF_MODEL_BC4;
+			file[dfdOffset + 12] = colorModel;
+			file[dfdOffset + 13] = KHR_DF_PRIMARIES_BT709;
+			file[dfdOffset + 14] = (role == TextureRole::COLOR) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+			file[dfdOffset + 15] = 0;
+			//4x4 texel blocks (stored as size - 1)
+			file[dfdOffset + 16] = 3;
+			file[dfdOffset + 17] = 3;
+			file[dfdOffset + 20] = static_cast<uint8_t>(blockSize);
+
+			for (uint32_t s = 0; s < sampleCount; s++)
+			{
+				size_t sample = dfdOffset + 28 + s * 16;
+				file[sample] = static_cast<uint8_t>(s * 64);
+				file[sample + 2] = 63;
+				file[sample + 3] = static_cast<uint8_t>(s);
+				WriteU32(file, sample + 8, 0);
+				WriteU32(file, sample + 12, 0xFFFFFFFF);
+			}
+		#pragma endregion
+
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			memcpy(&file[levelOffsets[i]], levels[i].data(), levels[i].size());
+		}
+
+		std::ofstream output(path, std::ios::binary | std::ios::trunc);
+		if (!output.is_open())
+		{
+			throw std::runtime_error("failed to write texture cache " + path);
+		}
+
+		output.write(reinterpret_cast<const char*>(file.data()), file.size());
+	}
+
+#pragma endregion
+}
+
+TextureRole TextureImporter::GetRoleFromFileName(const std::string& fileName)
+{
+	switch (fileName.empty() ? 'c' : fileName[0])
+	{
+	case 'r':
+		return TextureRole::ROUGHNESS;
+	case 'a':
+		return TextureRole::AMBIENT_OCCLUSION;
+	case 'd':
+		return TextureRole::DEPTH;
+	case 'n':
+		return TextureRole::NORMAL;
+	default:
+		return TextureRole::COLOR;
+	}
+}
+
+VkFormat TextureImporter::GetCompressedFormat(TextureRole role)
+{
+	switch (role)
+	{
+	case TextureRole::COLOR:
+		return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	case TextureRole::NORMAL:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	default:
+		return VK_FORMAT_BC4_UNORM_BLOCK;
+	}
+}
+
+VkFormat TextureImporter::GetUncompressedFormat(TextureRole role)
+{
+	return (role == TextureRole::COLOR) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+std::string TextureImporter::GetCachePath(const std::string& sourcePath)
+{
+	return fs::path(sourcePath).replace_extension(".ktx2").string();
+}
+
+bool TextureImporter::IsCacheUpToDate(const std::string& sourcePath, const std::string& cachePath)
+{
+	std::error_code error;
+	if (!fs::exists(cachePath, error))
+	{
+		return false;
+	}
+
+	return fs::last_write_time(cachePath, error) >= fs::last_write_time(sourcePath, error);
+}
+
+void TextureImporter::ImportTexture(const std::string& sourcePath, const std::string& cachePath, TextureRole role)
+{
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+	if (!pixels)
+	{
+		throw std::runtime_error("failed to load " + sourcePath + " for importing!");
+	}
+
+	std::vector<MipImage> mips;
+	mips.push_back({ static_cast<uint32_t>(width), static_cast<uint32_t>(height), std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(width) * height * 4) });
+	stbi_image_free(pixels);
+
+	while (mips.back().width > 1 || mips.back().height > 1)
+	{
+		mips.push_back(Downsample(mips.back(), role));
+	}
+
+	std::vector<std::vector<uint8_t>> levels;
+	levels.reserve(mips.size());
+	for (const auto& mip : mips)
+	{
+		levels.push_back(EncodeLevel(mip, role));
+	}
+
+	WriteKTX2(cachePath, role, mips[0], levels);
+
+	Helper::Cout("-- Imported Texture: " + sourcePath + " (" + std::to_string(levels.size()) + " mips)");
+}
+
+bool TextureImporter::ReadKTX2(const uint8_t* data, size_t size, KTX2Info& info)
+{
+	if (size < KTX2_LEVEL_INDEX_OFFSET || memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+	{
+		return false;
+	}
+
+	uint32_t header[9];
+	memcpy(header, data + 12, sizeof(header));
+
+	const uint32_t pixelDepth = header[4];
+	const uint32_t layerCount = header[5];
+	const uint32_t faceCount = header[6];
+	const uint32_t supercompression = header[8];
+
+	//Only plain 2D textures without supercompression are supported
+	if (pixelDepth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0)
+	{
+		return false;
+	}
+
+	info.format = static_cast<VkFormat>(header[0]);
+	info.width = header[2];
+	info.height = header[3];
+
+	const uint32_t levelCount = std::max(1u, header[7]);
+	if (KTX2_LEVEL_INDEX_OFFSET + levelCount * 24 > size)
+	{
+		return false;
+	}
+
+	info.levels.resize(levelCount);
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		uint64_t entry[3];
+		memcpy(entry, data + KTX2_LEVEL_INDEX_OFFSET + i * 24, sizeof(entry));
+
+		if (entry[0] + entry[1] > size)
+		{
+			return false;
+		}
+
+		info.levels[i].offset = entry[0];
+		info.levels[i].size = entry[1];
+		info.levels[i].width = std::max(1u, info.width >> i);
+		info.levels[i].height = std::max(1u, info.height >> i);
+	}
+
+	return true;
+}
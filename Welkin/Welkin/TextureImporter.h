@@ -0,0 +1,43 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//What a texture is used for, decides which block compressed format it is imported as
+//Taken from the first letter of the file name (cBrick, rBrick, nBrick...)
+enum class TextureRole { COLOR, ROUGHNESS, AMBIENT_OCCLUSION, DEPTH, NORMAL };
+
+struct KTX2Level
+{
+	//Offset from the start of the file
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct KTX2Info
+{
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	//Level 0 is the full resolution image
+	std::vector<KTX2Level> levels;
+};
+
+//Converts source images into block compressed (BC1/BC4/BC5) KTX2 files with a full mip chain
+//BC7 KTX2 files made by an external tool can be read, but are not produced here
+namespace TextureImporter
+{
+	TextureRole GetRoleFromFileName(const std::string& fileName);
+	VkFormat GetCompressedFormat(TextureRole role);
+	VkFormat GetUncompressedFormat(TextureRole role);
+
+	//Cache lives next to the source image, cBrick.png -> cBrick.ktx2
+	std::string GetCachePath(const std::string& sourcePath);
+	bool IsCacheUpToDate(const std::string& sourcePath, const std::string& cachePath);
+
+	void ImportTexture(const std::string& sourcePath, const std::string& cachePath, TextureRole role);
+	bool ReadKTX2(const uint8_t* data, size_t size, KTX2Info& info);
+};
@@ -0,0 +1,353 @@
+#include "TextureStreamer.h"
+
+TextureStreamer::TextureStreamer(VulkanCore* vCore) : vCore{vCore}, residencyVersion{0}, frameCount{0}, stopping{false}
+{
+	Helper::Cout("Texture Streamer", true);
+	device = vCore->GetLogicalDevice();
+
+	//Mid grey so streamed textures don't pop in from black
+	const uint8_t placeholderColor[4] = { 128, 128, 128, 255 };
+	placeholder = new Texture(placeholderColor, vCore);
+
+	unsigned int workerCount = std::max(1u, std::min(Welkin_Settings::TEXTURE_STREAMING_THREADS, std::thread::hardware_concurrency()));
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&TextureStreamer::WorkerLoop, this);
+	}
+
+	Helper::Cout("- Started " + std::to_string(workerCount) + " texture streaming threads");
+	Helper::Cout("- Texture budget: " + std::to_string(GetTextureBudget() / (1024 * 1024)) + "MB");
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+		stopping = true;
+	}
+	requestCondition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	for (auto& upload : pendingUploads)
+	{
+		vkWaitForFences(*device, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+		RetireUpload(upload);
+	}
+
+	for (auto& retired : retiredImages)
+	{
+		Texture::DestroyImage(*device, retired.image);
+	}
+
+	delete placeholder;
+}
+
+VkDeviceSize TextureStreamer::GetTextureBudget()
+{
+	if (Welkin_Settings::TEXTURE_MEMORY_BUDGET > 0)
+	{
+		return Welkin_Settings::TEXTURE_MEMORY_BUDGET;
+	}
+
+	VkDeviceSize deviceBudget = vCore->GetDeviceLocalMemoryBudget();
+	if (deviceBudget == 0)
+	{
+		return Welkin_Settings::TEXTURE_MEMORY_BUDGET_FALLBACK;
+	}
+
+	//Leave the rest for meshes, buffers and the swapchain
+	return static_cast<VkDeviceSize>(deviceBudget * Welkin_Settings::TEXTURE_MEMORY_BUDGET_FRACTION);
+}
+
+void TextureStreamer::RequestTexture(Texture* texture)
+{
+	streamedTextures.push_back(texture);
+	QueueLoad(texture, Texture::INITIAL_MIP);
+}
+
+void TextureStreamer::QueueLoad(Texture* texture, uint32_t baseMip)
+{
+	texture->SetTargetMip(baseMip);
+	loadsInFlight.insert(texture);
+
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+		requestedTextures.push_back(texture);
+	}
+	requestCondition.notify_one();
+}
+
+void TextureStreamer::WorkerLoop()
+{
+	while (true)
+	{
+		Texture* texture;
+
+		{
+			std::unique_lock<std::mutex> lock(requestMutex);
+			requestCondition.wait(lock, [this] { return stopping || !requestedTextures.empty(); });
+
+			if (stopping)
+			{
+				return;
+			}
+
+			texture = requestedTextures.front();
+			requestedTextures.pop_front();
+		}
+
+		//Decoding/importing and filling the staging buffer is the slow part, and doesn't touch any queues
+		try
+		{
+			texture->LoadFromDisk();
+		}
+		catch (const std::exception& ex)
+		{
+			//Still handed back so the main thread stops treating it as in flight
+			Helper::Warning("Failed to stream texture, keeping what is resident: " + std::string(ex.what()));
+		}
+
+		std::lock_guard<std::mutex> lock(loadedMutex);
+		loadedTextures.push_back(texture);
+	}
+}
+
+void TextureStreamer::Update()
+{
+	//Retire finished uploads, only polls the fences
+	for (size_t i = 0; i < pendingUploads.size();)
+	{
+		if (vkGetFenceStatus(*device, pendingUploads[i].fence) == VK_SUCCESS)
+		{
+			RetireUpload(pendingUploads[i]);
+			pendingUploads.erase(pendingUploads.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	//Update is called after the frame's fence wait, so once MAX_FRAMES_IN_FLIGHT more frames have been submitted nothing can sample these
+	for (size_t i = 0; i < retiredImages.size();)
+	{
+		if (retiredImages[i].releaseFrame <= frameCount)
+		{
+			Texture::DestroyImage(*device, retiredImages[i].image);
+			retiredImages.erase(retiredImages.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	SubmitLoadedTextures();
+	UpdateResidency();
+}
+
+void TextureStreamer::FrameSubmitted()
+{
+	frameCount++;
+}
+
+void TextureStreamer::SubmitLoadedTextures()
+{
+	PendingUpload upload{};
+
+	{
+		std::lock_guard<std::mutex> lock(loadedMutex);
+
+		//Cap the bytes copied per frame, but always take at least one so huge textures still get through
+		VkDeviceSize uploadSize = 0;
+		size_t count = 0;
+		//Charged with what's staged, imageSize is still the resident image's until FinishUpload
+		while (count < loadedTextures.size() && (count == 0 || uploadSize + loadedTextures[count]->GetPendingUploadSize() <= Welkin_Settings::TEXTURE_UPLOAD_BUDGET_PER_FRAME))
+		{
+			uploadSize += loadedTextures[count]->GetPendingUploadSize();
+			count++;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (loadedTextures[i]->HasPendingUpload())
+			{
+				upload.textures.push_back(loadedTextures[i]);
+			}
+			else
+			{
+				//Load failed
+				loadsInFlight.erase(loadedTextures[i]);
+			}
+		}
+
+		loadedTextures.erase(loadedTextures.begin(), loadedTextures.begin() + count);
+	}
+
+	if (upload.textures.empty())
+	{
+		return;
+	}
+
+	#pragma region Record and Submit
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = *vCore->GetCommandPool(0);
+		allocInfo.commandBufferCount = 1;
+
+		vkAllocateCommandBuffers(*device, &allocInfo, &upload.commandBuffer);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+		for (auto& texture : upload.textures)
+		{
+			texture->RecordUpload(upload.commandBuffer);
+		}
+		vkEndCommandBuffer(upload.commandBuffer);
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(*device, &fenceInfo, nullptr, &upload.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create texture upload fence!");
+		}
+
+		//Graphics queue so the layout transitions don't need a queue ownership transfer
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &upload.commandBuffer;
+
+		if (vkQueueSubmit(*vCore->GetQueue(0), 1, &submitInfo, upload.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit texture upload!");
+		}
+	#pragma endregion
+
+	pendingUploads.push_back(upload);
+}
+
+void TextureStreamer::RetireUpload(PendingUpload& upload)
+{
+	for (auto& texture : upload.textures)
+	{
+		TextureImage replaced = texture->FinishUpload();
+		loadsInFlight.erase(texture);
+
+		if (replaced.image != VK_NULL_HANDLE)
+		{
+			retiredImages.push_back({ replaced, frameCount + MAX_FRAMES_IN_FLIGHT });
+		}
+	}
+
+	residencyVersion++;
+
+	vkFreeCommandBuffers(*device, *vCore->GetCommandPool(0), 1, &upload.commandBuffer);
+	vkDestroyFence(*device, upload.fence, nullptr);
+}
+
+void TextureStreamer::UpdateResidency()
+{
+	struct Candidate
+	{
+		Texture* texture;
+		//Finest mip culling asked for
+		uint32_t wanted;
+		//Finest mip that will be kept resident
+		uint32_t target;
+		uint64_t lastVisible;
+	};
+
+	std::vector<Candidate> candidates;
+	VkDeviceSize totalSize = 0;
+
+	for (auto& texture : streamedTextures)
+	{
+		uint32_t requested = texture->ConsumeRequestedMip();
+
+		if (!texture->IsResident() || loadsInFlight.count(texture) > 0)
+		{
+			totalSize += texture->GetResidentSize();
+			continue;
+		}
+
+		if (requested != Texture::NO_MIP_REQUESTED)
+		{
+			lastVisibleFrame[texture] = frameCount;
+		}
+
+		const uint32_t coarsestMip = texture->mipLevels - 1;
+		const uint32_t wanted = std::min(requested, coarsestMip);
+
+		//Detail that's already resident is kept until the budget needs the memory back
+		Candidate candidate{ texture, wanted, std::min(wanted, texture->GetResidentMip()), lastVisibleFrame[texture] };
+		totalSize += texture->GetMipChainSize(candidate.target);
+		candidates.push_back(candidate);
+	}
+
+	const VkDeviceSize budget = GetTextureBudget();
+
+	if (totalSize > budget)
+	{
+		//Lowest priority first, least recently seen and then largest
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+			{
+				if (a.lastVisible != b.lastVisible)
+				{
+					return a.lastVisible < b.lastVisible;
+				}
+				return a.texture->GetMipChainSize(a.target) > b.texture->GetMipChainSize(b.target);
+			});
+
+		//First pass gives back detail nobody asked for, the second starts dropping detail that is visible
+		for (int pass = 0; pass < 2 && totalSize > budget; pass++)
+		{
+			bool dropped = true;
+			while (totalSize > budget && dropped)
+			{
+				dropped = false;
+				for (auto& candidate : candidates)
+				{
+					const uint32_t limit = (pass == 0) ? candidate.wanted : candidate.texture->mipLevels - 1;
+					if (candidate.target >= limit)
+					{
+						continue;
+					}
+
+					totalSize -= candidate.texture->GetMipChainSize(candidate.target) - candidate.texture->GetMipChainSize(candidate.target + 1);
+					candidate.target++;
+					dropped = true;
+
+					if (totalSize <= budget)
+					{
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	unsigned int changes = 0;
+	for (auto& candidate : candidates)
+	{
+		if (changes >= Welkin_Settings::TEXTURE_MIP_CHANGES_PER_FRAME)
+		{
+			break;
+		}
+
+		if (candidate.target != candidate.texture->GetResidentMip())
+		{
+			QueueLoad(candidate.texture, candidate.target);
+			changes++;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Texture.h"
+#include "VulkanCore.h"
+#include "Helper.h"
+
+//Loads textures on worker threads while the placeholder is bound, then uploads them from the main thread without stalling the frame
+//Resident mips follow what culling asks for, and get dropped when textures go over the memory budget
+class TextureStreamer
+{
+public:
+	TextureStreamer(VulkanCore* vCore);
+	~TextureStreamer();
+
+	//The texture shows the placeholder until it's resident
+	void RequestTexture(Texture* texture);
+	//Called once per frame from the main thread. Submits loaded textures, retires uploads the GPU has finished and rebalances mips
+	void Update();
+	//Called by the renderer after each successful vkQueueSubmit. Retired images count submitted frames, since a skipped frame doesn't retire one in flight
+	void FrameSubmitted();
+
+	Texture* GetPlaceholder() { return this->placeholder; };
+	//Goes up whenever a texture's image changes, so descriptor sets know to patch their image views
+	uint32_t GetResidencyVersion() { return this->residencyVersion; };
+	VkDeviceSize GetTextureBudget();
+
+private:
+	VulkanCore* vCore;
+	VkDevice* device;
+	Texture* placeholder;
+	uint32_t residencyVersion;
+	uint64_t frameCount;
+
+	struct PendingUpload
+	{
+		std::vector<Texture*> textures;
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+	};
+
+	//Replaced images wait here until no frame in flight can still sample them
+	struct RetiredImage
+	{
+		TextureImage image;
+		uint64_t releaseFrame;
+	};
+
+	void WorkerLoop();
+	void QueueLoad(Texture* texture, uint32_t baseMip);
+	void SubmitLoadedTextures();
+	void RetireUpload(PendingUpload& upload);
+	void UpdateResidency();
+
+	//Workers ---------
+	std::vector<std::thread> workers;
+	bool stopping;
+
+	std::mutex requestMutex;
+	std::condition_variable requestCondition;
+	std::deque<Texture*> requestedTextures;
+
+	std::mutex loadedMutex;
+	std::vector<Texture*> loadedTextures;
+
+	//Main thread only ---------
+	std::vector<Texture*> streamedTextures;
+	std::unordered_set<Texture*> loadsInFlight;
+	std::unordered_map<Texture*, uint64_t> lastVisibleFrame;
+	std::vector<PendingUpload> pendingUploads;
+	std::vector<RetiredImage> retiredImages;
+};
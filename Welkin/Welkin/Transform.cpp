@@ -7,12 +7,10 @@ Transform::Transform()
 	worldInverseTransposeMatrix = glm::mat4(1);
 
 	position = vec3(0, 0, 0);
-	eulerAngles = vec3(0, 0, 0);
+	rotation = quat(1, 0, 0, 0);
 	scale = vec3(1, 1, 1);
 
 	matricesDirty = false;
-
-	parent = nullptr;
 }
 
 Transform::Transform(vec3 pos, vec3 rotation, vec3 scale)
@@ -22,12 +20,10 @@ Transform::Transform(vec3 pos, vec3 rotation, vec3 scale)
 	worldInverseTransposeMatrix = glm::mat4(1);
 
 	this->position = pos;
-	this->eulerAngles = rotation;
+	this->rotation = EulerToQuaternion(rotation);
 	this->scale = scale;
 
 	matricesDirty = true;
-
-	parent = nullptr;
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
@@ -43,7 +39,8 @@ void Transform::MoveRelative(float x, float y, float z)
 
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
-	eulerAngles += vec3(pitch, yaw, roll);
+	//Applied on top of the current rotation, in local space
+	rotation = normalize(rotation * EulerToQuaternion(vec3(pitch, yaw, roll)));
 	matricesDirty = true;
 
 }
@@ -63,7 +60,13 @@ void Transform::SetPosition(float x, float y, float z)
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
-	eulerAngles = vec3(pitch, yaw, roll);
+	rotation = EulerToQuaternion(vec3(pitch, yaw, roll));
+	matricesDirty = true;
+}
+
+void Transform::SetRotation(quat rotation)
+{
+	this->rotation = normalize(rotation);
 	matricesDirty = true;
 }
 
@@ -86,7 +89,7 @@ void Transform::SetTransformsFromMatrix(mat4 worldMatrix)
 	rotation = glm::conjugate(rotation);
 
 	position = translation;
-	eulerAngles = QuaterionToEuler(rotation);
+	this->rotation = normalize(rotation);
 	this->scale = scale;
 
 	matricesDirty = true;
@@ -95,14 +98,16 @@ void Transform::SetTransformsFromMatrix(mat4 worldMatrix)
 void Transform::SetTransform(Transform transform)
 {
 	position = transform.GetPosition();
-	eulerAngles = transform.GetPitchYawRoll();
+	rotation = transform.GetRotation();
 	scale = transform.GetScale();
 	matricesDirty = true;
 }
 
 vec3 Transform::GetPosition() { return position; }
 
-vec3 Transform::GetPitchYawRoll() { return eulerAngles; }
+vec3 Transform::GetPitchYawRoll() { return QuaternionToEuler(rotation); }
+
+quat Transform::GetRotation() { return rotation; }
 
 vec3 Transform::GetScale() { return scale; }
 
@@ -110,46 +115,42 @@ mat4 Transform::GetWorldMatrix() { return worldMatrix; }
 
 mat4 Transform::GetWorldInverseTransposeMatrix() { return worldInverseTransposeMatrix; }
 
-//Hiarchy
-
 void Transform::UpdateMatrices()
 {
 	if (matricesDirty)
 	{
-		mat4 worldMatrix = mat4(1.0f);
-
-		mat4 translationMatrix = translate(mat4(1.0f), position);
-		mat4 scaleMatrix = glm::scale(mat4(1.0f), scale);
-		mat4 rotationMatrix = glm::eulerAngleXYZ(eulerAngles.x, eulerAngles.y, eulerAngles.z);
-
-		//TODO right order?
-		//worldMatrix = scaleMatrix * rotationMatrix * translationMatrix;
-		worldMatrix = translationMatrix * rotationMatrix * scaleMatrix;
-
-		if (parent)
+		//translation * rotation * scale written out, the columns are the rotation's scaled by each axis
+		const mat3 rotationMatrix = glm::mat3_cast(rotation);
+		for (int column = 0; column < 3; column++)
 		{
-			worldMatrix *= parent->GetWorldMatrix();
+			worldMatrix[column] = vec4(rotationMatrix[column] * scale[column], 0.0f);
 		}
+		worldMatrix[3] = vec4(position, 1.0f);
 
-		this->worldMatrix = worldMatrix;
-		this->worldInverseTransposeMatrix = glm::inverse(glm::transpose(worldMatrix));
+		//The inverse transpose of translation * rotation * scale has rotation / scale as its 3x3 and -(rotation column . position) / scale along the bottom row
+		//With a uniform scale that's the world matrix's 3x3 divided by scale squared, so one reciprocal is shared by every column
+		const bool uniformScale = scale.x == scale.y && scale.y == scale.z;
+		const float uniformInverseSquared = 1.0f / (scale.x * scale.x);
+		for (int column = 0; column < 3; column++)
+		{
+			const vec3 normalColumn = uniformScale ? vec3(worldMatrix[column]) * uniformInverseSquared : rotationMatrix[column] / scale[column];
+			worldInverseTransposeMatrix[column] = vec4(normalColumn, -dot(normalColumn, position));
+		}
+		worldInverseTransposeMatrix[3] = vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
 		matricesDirty = false;
-
-		MarkChildTransformsDirty();
 	}
 }
 
-void Transform::MarkChildTransformsDirty()
+quat Transform::EulerToQuaternion(vec3 pitchYawRoll)
 {
-	for (auto child : children)
-	{
-		child->matricesDirty = true;
-		child->MarkChildTransformsDirty();
-	}
+	return glm::angleAxis(pitchYawRoll.x, vec3(1, 0, 0)) * glm::angleAxis(pitchYawRoll.y, vec3(0, 1, 0)) * glm::angleAxis(pitchYawRoll.z, vec3(0, 0, 1));
 }
 
-vec3 Transform::QuaterionToEuler(glm::quat quaterion)
+vec3 Transform::QuaternionToEuler(quat rotation)
 {
-	return glm::eulerAngles(quaterion);
+	//glm::eulerAngles uses a different order, so go through the matrix eulerAngleXYZ would have built
+	vec3 pitchYawRoll;
+	glm::extractEulerAngleXYZ(glm::mat4_cast(rotation), pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+	return pitchYawRoll;
 }
\ No newline at end of file
@@ -23,12 +23,14 @@ public:
 
 	void SetPosition(float x, float y, float z);
 	void SetRotation(float pitch, float yaw, float roll);
+	void SetRotation(quat rotation);
 	void SetScale(float x, float y, float z);
 
 	void SetTransformsFromMatrix(mat4 worldMatrix);
 
 	vec3 GetPosition();
 	vec3 GetPitchYawRoll();
+	quat GetRotation();
 	vec3 GetScale();
 
 	void SetTransform(Transform transform);
@@ -38,23 +40,16 @@ public:
 
 	void UpdateMatrices();
 
-	/*
-	void AddChild(Transform* child, bool makeChildRelative);
-	void RemoveChild(Transform* child, bool applyParentTransform);
-	void SetParent(Transform* newParent, bool makeChildRelative);
-	Transform* GetParent();
-	Transform* GetChild(unsigned int index);
-	int IndexOfChild(Transform* child);
-	unsigned int ChildCount();
-	*/
-private:
-	//Hierarchy
-	Transform* parent;
-	std::vector<Transform*> children;
+	//Same rotation glm::eulerAngleXYZ builds
+	static quat EulerToQuaternion(vec3 pitchYawRoll);
+	static vec3 QuaternionToEuler(quat rotation);
 
+	//Hierarchies are kept by TransformSystem, a Transform on its own is always in world space
+private:
 	//Transform Data
 	vec3 position;
-	vec3 eulerAngles;
+	//Kept normalized, Euler angles are only converted to and from at the edges
+	quat rotation;
 	vec3 scale;
 
 	//World matrix and such
@@ -63,11 +58,5 @@ private:
 	mat4 worldMatrix;
 	mat4 worldInverseTransposeMatrix;
 
-	//Update helper funtions
-	void MarkChildTransformsDirty();
-
-	//Helper for conversions
-	vec3 QuaterionToEuler(quat quaterion);
-
 };
 
@@ -0,0 +1,264 @@
+#include "TransformEvaluator.h"
+
+namespace
+{
+	const uint32_t WORKGROUP_SIZE = 64;
+
+	//Keeps the object slots, bound at the end of the component arrays, on a storage buffer offset every device accepts
+	const uint32_t SLOT_CAPACITY_STEP = 64;
+
+	VkDeviceSize ComponentsSize(uint32_t slotCapacity)
+	{
+		return static_cast<VkDeviceSize>(slotCapacity) * TransformSystem::GPU_COMPONENT_COUNT * sizeof(float);
+	}
+}
+
+TransformEvaluator::TransformEvaluator(VulkanCore* vCore, FileManager* fm) : vCore{ vCore }, fm{ fm }
+{
+	device = vCore->GetLogicalDevice();
+
+	if (!Welkin_Settings::USE_GPU_TRANSFORMS)
+	{
+		return;
+	}
+
+	VkShaderModule* shaderModule = fm->TryFindShaderModule("(C)TransformEvalComp.spv");
+	if (shaderModule == nullptr)
+	{
+		Helper::Warning("(C)TransformEvalComp.spv not found, world matrices are uploaded from the CPU");
+		return;
+	}
+
+	Helper::Cout("Creating Transform Evaluator");
+	enabled = true;
+
+	inputBuffers.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	inputBufferMemory.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	inputSlotCapacities.resize(MAX_FRAMES_IN_FLIGHT, 0);
+
+	CreateDescriptorSetLayout();
+	CreateDescriptorPool();
+	CreateDescriptorSets();
+	CreatePipeline(shaderModule);
+}
+
+TransformEvaluator::~TransformEvaluator()
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	vkDestroyPipeline(*device, pipeline, nullptr);
+	vkDestroyPipelineLayout(*device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(*device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(*device, descriptorSetLayout, nullptr);
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (inputBuffers[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(*device, inputBuffers[i], nullptr);
+			vkFreeMemory(*device, inputBufferMemory[i], nullptr);
+		}
+	}
+}
+
+#pragma region Setup
+
+void TransformEvaluator::SetOutputBuffers(const std::vector<VkBuffer>& perTransformBuffers)
+{
+	outputBuffers = perTransformBuffers;
+
+	for (unsigned short i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		CreateInputBuffer(i, Welkin_Settings::MAX_OBJECTS);
+	}
+}
+
+void TransformEvaluator::CreateInputBuffer(unsigned short frame, uint32_t slotCapacity)
+{
+	slotCapacity = (slotCapacity + SLOT_CAPACITY_STEP - 1) / SLOT_CAPACITY_STEP * SLOT_CAPACITY_STEP;
+
+	//Only called for a frame whose fence was waited on, so its old buffer is no longer read
+	if (inputBuffers[frame] != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(*device, inputBuffers[frame], nullptr);
+		vkFreeMemory(*device, inputBufferMemory[frame], nullptr);
+	}
+
+	vCore->CreateBuffer(ComponentsSize(slotCapacity) + sizeof(uint32_t) * Welkin_Settings::MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, inputBuffers[frame], inputBufferMemory[frame]);
+	inputSlotCapacities[frame] = slotCapacity;
+
+	WriteDescriptorSet(frame);
+}
+
+void TransformEvaluator::WriteDescriptorSet(unsigned short frame)
+{
+	const VkDeviceSize componentsSize = ComponentsSize(inputSlotCapacities[frame]);
+
+	VkDescriptorBufferInfo bufferInfos[3]{};
+	bufferInfos[0].buffer = inputBuffers[frame];
+	bufferInfos[0].offset = 0;
+	bufferInfos[0].range = componentsSize;
+	bufferInfos[1].buffer = inputBuffers[frame];
+	bufferInfos[1].offset = componentsSize;
+	bufferInfos[1].range = VK_WHOLE_SIZE;
+	bufferInfos[2].buffer = outputBuffers[frame];
+	bufferInfos[2].offset = 0;
+	bufferInfos[2].range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet descriptorWrites[3]{};
+	for (uint32_t b = 0; b < 3; b++)
+	{
+		descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[b].dstSet = descriptorSets[frame];
+		descriptorWrites[b].dstBinding = b;
+		descriptorWrites[b].dstArrayElement = 0;
+		descriptorWrites[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[b].descriptorCount = 1;
+		descriptorWrites[b].pBufferInfo = &bufferInfos[b];
+	}
+
+	vkUpdateDescriptorSets(*device, 3, descriptorWrites, 0, nullptr);
+}
+
+void TransformEvaluator::CreateDescriptorSetLayout()
+{
+	//Components, object slots, per transform output
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(*device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transform evaluation descriptor set layout!");
+	}
+}
+
+void TransformEvaluator::CreateDescriptorPool()
+{
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 3;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+	if (vkCreateDescriptorPool(*device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transform evaluation descriptor pool!");
+	}
+}
+
+void TransformEvaluator::CreateDescriptorSets()
+{
+	std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	allocInfo.pSetLayouts = layouts.data();
+
+	descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	if (vkAllocateDescriptorSets(*device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate transform evaluation descriptor sets!");
+	}
+}
+
+void TransformEvaluator::CreatePipeline(VkShaderModule* shaderModule)
+{
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	range.offset = 0;
+	range.size = sizeof(TransformEvalPush);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &range;
+
+	if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transform evaluation pipeline layout!");
+	}
+
+	VkPipelineShaderStageCreateInfo stageInfo{};
+	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module = *shaderModule;
+	stageInfo.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = stageInfo;
+	pipelineInfo.layout = pipelineLayout;
+
+	if (vkCreateComputePipelines(*device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transform evaluation pipeline!");
+	}
+}
+
+#pragma endregion
+
+void TransformEvaluator::UpdateInputBuffer(unsigned short currentFrame, const SceneSnapshot& scene, const std::vector<uint32_t>& instanceIDs)
+{
+	push.slotCount = scene.slotCount;
+	push.objectCount = static_cast<uint32_t>(std::min<size_t>(scene.objectSlots.size(), Welkin_Settings::MAX_OBJECTS));
+
+	if (push.slotCount > inputSlotCapacities[currentFrame])
+	{
+		CreateInputBuffer(currentFrame, push.slotCount * 2);
+	}
+
+	void* data;
+	vkMapMemory(*device, inputBufferMemory[currentFrame], 0, VK_WHOLE_SIZE, 0, &data);
+
+	memcpy(data, scene.transformComponents.data(), scene.transformComponents.size());
+
+	uint32_t* objectSlots = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(data) + ComponentsSize(inputSlotCapacities[currentFrame]));
+	for (uint32_t i = 0; i < push.objectCount; i++)
+	{
+		objectSlots[instanceIDs[i]] = scene.objectSlots[i];
+	}
+
+	vkUnmapMemory(*device, inputBufferMemory[currentFrame]);
+}
+
+void TransformEvaluator::RecordEvaluation(VkCommandBuffer commandBuffer, unsigned short currentFrame)
+{
+	if (push.objectCount == 0)
+	{
+		return;
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TransformEvalPush), &push);
+	vkCmdDispatch(commandBuffer, (push.objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier evaluationBarrier{};
+	evaluationBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	evaluationBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	evaluationBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &evaluationBarrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "VulkanCore.h"
+#include "FileManager.h"
+#include "Helper.h"
+#include "GameObject.h"
+#include "TransformSystem.h"
+#include "SceneSnapshot.h"
+
+//Matches TransformEval.comp's push constant
+struct TransformEvalPush
+{
+	uint32_t slotCount;
+	uint32_t objectCount;
+};
+
+//Builds the per transform buffer's world matrices in a compute pass, from TransformSystem's raw position, rotation and scale arrays
+//Each slot uploads 44 bytes plus 4 per object for its slot, instead of a composed matrix per object
+class TransformEvaluator
+{
+public:
+	TransformEvaluator(VulkanCore* vCore, FileManager* fm);
+	~TransformEvaluator();
+
+	//False when USE_GPU_TRANSFORMS is off or TransformEval.comp wasn't compiled, the per transform buffer is then filled on the CPU
+	bool IsEnabled() { return this->enabled; };
+
+	//perTransformBuffers is the buffer per frame in flight the results go to, has to be called once before the first UpdateInputBuffer
+	void SetOutputBuffers(const std::vector<VkBuffer>& perTransformBuffers);
+	//Uploads the transform components and object slots the simulation copied into scene, each object's matrix goes to its instanceIDs entry
+	//Matrices come out at the scene's step, they aren't interpolated like the CPU filled ones
+	void UpdateInputBuffer(unsigned short currentFrame, const SceneSnapshot& scene, const std::vector<uint32_t>& instanceIDs);
+
+	//Has to be outside the render pass, before anything reads the per transform buffer
+	void RecordEvaluation(VkCommandBuffer commandBuffer, unsigned short currentFrame);
+
+private:
+	VulkanCore* vCore;
+	VkDevice* device;
+	FileManager* fm;
+	bool enabled = false;
+
+	TransformEvalPush push{};
+
+	//Per frame in flight, component arrays then object slots
+	std::vector<VkBuffer> inputBuffers;
+	std::vector<VkDeviceMemory> inputBufferMemory;
+	//Slots the input buffer has room for, TransformSystem grows past MAX_OBJECTS when SetParent moves transforms
+	std::vector<uint32_t> inputSlotCapacities;
+	std::vector<VkBuffer> outputBuffers;
+
+	std::vector<VkDescriptorSet> descriptorSets;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+
+	//Recreates the frame's input buffer and points its descriptor set at it
+	void CreateInputBuffer(unsigned short frame, uint32_t slotCapacity);
+	void WriteDescriptorSet(unsigned short frame);
+	void CreateDescriptorSetLayout();
+	void CreateDescriptorPool();
+	void CreateDescriptorSets();
+	void CreatePipeline(VkShaderModule* shaderModule);
+};
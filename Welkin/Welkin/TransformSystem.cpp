@@ -0,0 +1,508 @@
+#include "TransformSystem.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRANSFORM_SYSTEM_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const uint32_t GROUP_SIZE = 4;
+	const uint32_t NO_SLOT = UINT32_MAX;
+
+#ifdef TRANSFORM_SYSTEM_SSE2
+	//x, y, z and w hold one column for 4 transforms, transposed so each matrix gets its own column
+	void StoreColumn(glm::mat4* matrices, int column, __m128 x, __m128 y, __m128 z, __m128 w)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&matrices[0][column][0], x);
+		_mm_storeu_ps(&matrices[1][column][0], y);
+		_mm_storeu_ps(&matrices[2][column][0], z);
+		_mm_storeu_ps(&matrices[3][column][0], w);
+	}
+#endif
+}
+
+TransformSystem::TransformSystem() : anyDirty{ false }, pass{ 0 }
+{
+}
+
+TransformHandle TransformSystem::Create(const Transform& transform)
+{
+	uint32_t slot;
+	if (freeSlots.empty())
+	{
+		slot = AppendSlots(1);
+	}
+	else
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+
+	TransformHandle handle;
+	if (freeHandles.empty())
+	{
+		handle.index = static_cast<uint32_t>(handleSlots.size());
+		handleSlots.push_back(slot);
+		handleGenerations.push_back(0);
+	}
+	else
+	{
+		handle.index = freeHandles.back();
+		freeHandles.pop_back();
+		handleSlots[handle.index] = slot;
+	}
+	handle.generation = handleGenerations[handle.index];
+	slotHandles[slot] = handle.index;
+
+	SetTransform(handle, transform);
+	return handle;
+}
+
+void TransformSystem::Destroy(TransformHandle handle)
+{
+	const uint32_t slot = GetSlot(handle);
+
+	//Children always come after their parent, so they are all past slot
+	for (uint32_t i = slot + 1; childCounts[slot] > 0 && i < parents.size(); i++)
+	{
+		if (parents[i] == slot)
+		{
+			parents[i] = NO_SLOT;
+			childCounts[slot]--;
+			DetachLocal(i);
+			MarkDirty(i);
+		}
+	}
+
+	if (parents[slot] != NO_SLOT)
+	{
+		childCounts[parents[slot]]--;
+	}
+
+	FreeSlot(slot);
+	handleGenerations[handle.index]++;
+	freeHandles.push_back(handle.index);
+}
+
+bool TransformSystem::IsValid(TransformHandle handle) const
+{
+	return handle.index < handleSlots.size() && handleGenerations[handle.index] == handle.generation;
+}
+
+void TransformSystem::SetTransform(TransformHandle handle, const Transform& transform)
+{
+	//Transform's getters aren't const
+	Transform source = transform;
+	SetPosition(handle, source.GetPosition());
+	SetRotation(handle, source.GetRotation());
+	SetScale(handle, source.GetScale());
+}
+
+void TransformSystem::SetPosition(TransformHandle handle, const glm::vec3& position)
+{
+	const uint32_t slot = GetSlot(handle);
+	positionX[slot] = position.x;
+	positionY[slot] = position.y;
+	positionZ[slot] = position.z;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetRotation(TransformHandle handle, const glm::vec3& pitchYawRoll)
+{
+	SetRotation(handle, Transform::EulerToQuaternion(pitchYawRoll));
+}
+
+void TransformSystem::SetRotation(TransformHandle handle, const glm::quat& rotation)
+{
+	const uint32_t slot = GetSlot(handle);
+	const glm::quat normalized = glm::normalize(rotation);
+	rotationX[slot] = normalized.x;
+	rotationY[slot] = normalized.y;
+	rotationZ[slot] = normalized.z;
+	rotationW[slot] = normalized.w;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetScale(TransformHandle handle, const glm::vec3& scale)
+{
+	const uint32_t slot = GetSlot(handle);
+	scaleX[slot] = scale.x;
+	scaleY[slot] = scale.y;
+	scaleZ[slot] = scale.z;
+	MarkDirty(slot);
+}
+
+void TransformSystem::Rotate(TransformHandle handle, const glm::vec3& pitchYawRoll)
+{
+	SetRotation(handle, GetRotation(handle) * Transform::EulerToQuaternion(pitchYawRoll));
+}
+
+glm::vec3 TransformSystem::GetPosition(TransformHandle handle) const
+{
+	const uint32_t slot = GetSlot(handle);
+	return glm::vec3(positionX[slot], positionY[slot], positionZ[slot]);
+}
+
+glm::vec3 TransformSystem::GetPitchYawRoll(TransformHandle handle) const
+{
+	return Transform::QuaternionToEuler(GetRotation(handle));
+}
+
+glm::quat TransformSystem::GetRotation(TransformHandle handle) const
+{
+	const uint32_t slot = GetSlot(handle);
+	return glm::quat(rotationW[slot], rotationX[slot], rotationY[slot], rotationZ[slot]);
+}
+
+glm::vec3 TransformSystem::GetScale(TransformHandle handle) const
+{
+	const uint32_t slot = GetSlot(handle);
+	return glm::vec3(scaleX[slot], scaleY[slot], scaleZ[slot]);
+}
+
+void TransformSystem::SetParent(TransformHandle child, TransformHandle parent)
+{
+	const uint32_t childSlot = GetSlot(child);
+	const uint32_t parentSlot = IsValid(parent) ? GetSlot(parent) : NO_SLOT;
+
+	//Walks up from the new parent, only as deep as the hierarchy
+	for (uint32_t ancestor = parentSlot; ancestor != NO_SLOT; ancestor = parents[ancestor])
+	{
+		if (ancestor == childSlot)
+		{
+			throw std::runtime_error("A transform can't be parented to itself or one of its children!");
+		}
+	}
+
+	if (parents[childSlot] == parentSlot)
+	{
+		return;
+	}
+
+	if (parents[childSlot] != NO_SLOT)
+	{
+		childCounts[parents[childSlot]]--;
+	}
+
+	if (parentSlot == NO_SLOT)
+	{
+		parents[childSlot] = NO_SLOT;
+		DetachLocal(childSlot);
+		MarkDirty(childSlot);
+		return;
+	}
+
+	parents[childSlot] = parentSlot;
+	childCounts[parentSlot]++;
+	AttachLocal(childSlot);
+	MarkDirty(childSlot);
+
+	if (parentSlot > childSlot)
+	{
+		MoveSubtreeToEnd(childSlot);
+	}
+}
+
+TransformHandle TransformSystem::GetParent(TransformHandle handle) const
+{
+	const uint32_t parentSlot = parents[GetSlot(handle)];
+	if (parentSlot == NO_SLOT)
+	{
+		return TransformHandle();
+	}
+
+	TransformHandle parent;
+	parent.index = slotHandles[parentSlot];
+	parent.generation = handleGenerations[parent.index];
+	return parent;
+}
+
+void TransformSystem::UpdateMatrices()
+{
+	if (!anyDirty)
+	{
+		return;
+	}
+	pass++;
+
+	//One pass in slot order, a parent's world matrix is always final before its children are reached
+	for (uint32_t first = 0; first < dirty.size(); first += GROUP_SIZE)
+	{
+		uint32_t groupDirty;
+		memcpy(&groupDirty, dirty.data() + first, sizeof(groupDirty));
+		const bool groupHasChildren = (parents[first] & parents[first + 1] & parents[first + 2] & parents[first + 3]) != NO_SLOT;
+
+		if (groupDirty == 0 && !groupHasChildren)
+		{
+			continue;
+		}
+
+		//Whole groups are rebuilt, the clean transforms in them come out the same as before
+		if (groupDirty != 0)
+		{
+			ComposeGroup(first);
+		}
+
+		for (uint32_t slot = first; slot < first + GROUP_SIZE; slot++)
+		{
+			const uint32_t parent = parents[slot];
+			if (parent == NO_SLOT)
+			{
+				changedPasses[slot] = dirty[slot] ? pass : changedPasses[slot];
+				continue;
+			}
+
+			//ComposeGroup wrote the local matrix, keep it and put the parent's world matrix in front
+			//It also overwrites clean children in the same group, so those are redone from their kept local matrix
+			const uint32_t local = localIndices[slot];
+			if (dirty[slot])
+			{
+				localMatrices[local] = worldMatrices[slot];
+				localInverseTransposeMatrices[local] = worldInverseTransposeMatrices[slot];
+			}
+
+			if (groupDirty != 0 || changedPasses[parent] == pass)
+			{
+				//(AB)^-T = A^-T B^-T, so the inverse transposes chain the same way
+				worldMatrices[slot] = worldMatrices[parent] * localMatrices[local];
+				worldInverseTransposeMatrices[slot] = worldInverseTransposeMatrices[parent] * localInverseTransposeMatrices[local];
+				changedPasses[slot] = (dirty[slot] || changedPasses[parent] == pass) ? pass : changedPasses[slot];
+			}
+		}
+
+		memset(dirty.data() + first, 0, GROUP_SIZE);
+	}
+
+	anyDirty = false;
+}
+
+const glm::mat4& TransformSystem::GetWorldMatrix(TransformHandle handle) const
+{
+	return worldMatrices[GetSlot(handle)];
+}
+
+const glm::mat4& TransformSystem::GetWorldInverseTransposeMatrix(TransformHandle handle) const
+{
+	return worldInverseTransposeMatrices[GetSlot(handle)];
+}
+
+void TransformSystem::WriteComponents(uint8_t* destination) const
+{
+	const size_t arraySize = parents.size() * sizeof(float);
+	for (const auto* component : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ })
+	{
+		memcpy(destination, component->data(), arraySize);
+		destination += arraySize;
+	}
+	memcpy(destination, parents.data(), arraySize);
+}
+
+uint32_t TransformSystem::GetSlot(TransformHandle handle) const
+{
+	if (!IsValid(handle))
+	{
+		throw std::runtime_error("Transform handle is stale or was never created!");
+	}
+	return handleSlots[handle.index];
+}
+
+void TransformSystem::MarkDirty(uint32_t slot)
+{
+	dirty[slot] = 1;
+	anyDirty = true;
+}
+
+uint32_t TransformSystem::AppendSlots(uint32_t count)
+{
+	const uint32_t first = static_cast<uint32_t>(parents.size());
+	const size_t size = first + (count + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+
+	for (auto* component : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ })
+	{
+		component->resize(size, 0.0f);
+	}
+	for (auto* component : { &rotationW, &scaleX, &scaleY, &scaleZ })
+	{
+		component->resize(size, 1.0f);
+	}
+
+	dirty.resize(size, 0);
+	worldMatrices.resize(size, glm::mat4(1.0f));
+	worldInverseTransposeMatrices.resize(size, glm::mat4(1.0f));
+	parents.resize(size, NO_SLOT);
+	childCounts.resize(size, 0);
+	localIndices.resize(size, NO_SLOT);
+	changedPasses.resize(size, 0);
+	slotHandles.resize(size, NO_SLOT);
+
+	//Padding past count is free, handed out lowest slot first so live transforms stay packed at the front
+	for (uint32_t slot = static_cast<uint32_t>(size); slot-- > first + count;)
+	{
+		freeSlots.push_back(slot);
+	}
+	return first;
+}
+
+void TransformSystem::FreeSlot(uint32_t slot)
+{
+	DetachLocal(slot);
+	parents[slot] = NO_SLOT;
+	childCounts[slot] = 0;
+	slotHandles[slot] = NO_SLOT;
+	dirty[slot] = 0;
+	freeSlots.push_back(slot);
+}
+
+void TransformSystem::MoveSubtreeToEnd(uint32_t slot)
+{
+	//Descendants are all past slot, one forward scan finds them in an order that still has parents first
+	std::vector<uint8_t> inSubtree(parents.size() - slot, 0);
+	std::vector<uint32_t> subtree{ slot };
+	inSubtree[0] = 1;
+
+	for (uint32_t i = slot + 1; i < parents.size(); i++)
+	{
+		if (parents[i] != NO_SLOT && parents[i] >= slot && inSubtree[parents[i] - slot])
+		{
+			inSubtree[i - slot] = 1;
+			subtree.push_back(i);
+		}
+	}
+
+	const uint32_t first = AppendSlots(static_cast<uint32_t>(subtree.size()));
+	std::vector<uint32_t> newSlots(parents.size() - slot, NO_SLOT);
+
+	for (uint32_t i = 0; i < subtree.size(); i++)
+	{
+		const uint32_t from = subtree[i];
+		const uint32_t to = first + i;
+		newSlots[from - slot] = to;
+
+		positionX[to] = positionX[from];
+		positionY[to] = positionY[from];
+		positionZ[to] = positionZ[from];
+		rotationX[to] = rotationX[from];
+		rotationY[to] = rotationY[from];
+		rotationZ[to] = rotationZ[from];
+		rotationW[to] = rotationW[from];
+		scaleX[to] = scaleX[from];
+		scaleY[to] = scaleY[from];
+		scaleZ[to] = scaleZ[from];
+
+		//The root's parent is outside the subtree and keeps its slot
+		const uint32_t parent = parents[from];
+		parents[to] = (parent != NO_SLOT && parent >= slot && newSlots[parent - slot] != NO_SLOT) ? newSlots[parent - slot] : parent;
+		childCounts[to] = childCounts[from];
+		localIndices[to] = localIndices[from];
+		slotHandles[to] = slotHandles[from];
+		handleSlots[slotHandles[to]] = to;
+		MarkDirty(to);
+
+		//Ownership of the local matrix moved with it
+		localIndices[from] = NO_SLOT;
+		childCounts[from] = 0;
+	}
+
+	for (const uint32_t from : subtree)
+	{
+		FreeSlot(from);
+	}
+}
+
+void TransformSystem::AttachLocal(uint32_t slot)
+{
+	if (localIndices[slot] != NO_SLOT)
+	{
+		return;
+	}
+
+	if (freeLocals.empty())
+	{
+		localIndices[slot] = static_cast<uint32_t>(localMatrices.size());
+		localMatrices.push_back(glm::mat4(1.0f));
+		localInverseTransposeMatrices.push_back(glm::mat4(1.0f));
+	}
+	else
+	{
+		localIndices[slot] = freeLocals.back();
+		freeLocals.pop_back();
+	}
+}
+
+void TransformSystem::DetachLocal(uint32_t slot)
+{
+	if (localIndices[slot] != NO_SLOT)
+	{
+		freeLocals.push_back(localIndices[slot]);
+		localIndices[slot] = NO_SLOT;
+	}
+}
+
+//translation * rotation * scale written out, the rotation columns come straight from the quaternion and are scaled per axis
+//The inverse transpose has rotation / scale as its 3x3 and -(rotation column . position) / scale along the bottom row, no general inverse needed
+void TransformSystem::ComposeGroup(uint32_t first)
+{
+	glm::mat4* world = &worldMatrices[first];
+	glm::mat4* worldInverseTranspose = &worldInverseTransposeMatrices[first];
+
+#ifdef TRANSFORM_SYSTEM_SSE2
+	const __m128 x = _mm_loadu_ps(&rotationX[first]);
+	const __m128 y = _mm_loadu_ps(&rotationY[first]);
+	const __m128 z = _mm_loadu_ps(&rotationZ[first]);
+	const __m128 w = _mm_loadu_ps(&rotationW[first]);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+	const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+	const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+	const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	const __m128 rotation[3][3] =
+	{
+		{ _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy) },
+		{ _mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx) },
+		{ _mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)) }
+	};
+
+	const __m128 position[3] = { _mm_loadu_ps(&positionX[first]), _mm_loadu_ps(&positionY[first]), _mm_loadu_ps(&positionZ[first]) };
+	const __m128 scale[3] = { _mm_loadu_ps(&scaleX[first]), _mm_loadu_ps(&scaleY[first]), _mm_loadu_ps(&scaleZ[first]) };
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	__m128 bottomRow[3];
+	for (int column = 0; column < 3; column++)
+	{
+		const __m128* r = rotation[column];
+		const __m128 inverseScale = _mm_div_ps(one, scale[column]);
+		const __m128 rotatedPosition = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], position[0]), _mm_mul_ps(r[1], position[1])), _mm_mul_ps(r[2], position[2]));
+		bottomRow[column] = _mm_xor_ps(_mm_mul_ps(rotatedPosition, inverseScale), signMask);
+
+		StoreColumn(world, column, _mm_mul_ps(r[0], scale[column]), _mm_mul_ps(r[1], scale[column]), _mm_mul_ps(r[2], scale[column]), zero);
+		StoreColumn(worldInverseTranspose, column, _mm_mul_ps(r[0], inverseScale), _mm_mul_ps(r[1], inverseScale), _mm_mul_ps(r[2], inverseScale), bottomRow[column]);
+	}
+
+	StoreColumn(world, 3, position[0], position[1], position[2], one);
+	StoreColumn(worldInverseTranspose, 3, zero, zero, zero, one);
+#else
+	for (uint32_t lane = 0; lane < GROUP_SIZE; lane++)
+	{
+		const uint32_t i = first + lane;
+		const glm::mat3 rotation = glm::mat3_cast(glm::quat(rotationW[i], rotationX[i], rotationY[i], rotationZ[i]));
+		const glm::vec3 position(positionX[i], positionY[i], positionZ[i]);
+		const float scale[3] = { scaleX[i], scaleY[i], scaleZ[i] };
+
+		for (int column = 0; column < 3; column++)
+		{
+			world[lane][column] = glm::vec4(rotation[column] * scale[column], 0.0f);
+			worldInverseTranspose[lane][column] = glm::vec4(rotation[column] / scale[column], -glm::dot(rotation[column], position) / scale[column]);
+		}
+		world[lane][3] = glm::vec4(position, 1.0f);
+		worldInverseTranspose[lane][3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+#endif
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Transform.h"
+
+//Index into TransformSystem's handle table, the generation catches handles that are used after their transform was destroyed
+struct TransformHandle
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+};
+
+//Position, rotation and scale of every GameObject, kept as one array per component so UpdateMatrices streams through them instead of chasing pointers
+//Matrices are rebuilt 4 transforms at a time with SSE, only for groups of 4 that have a dirty transform in them
+//Slots are kept in an order where parents always come before their children, so the hierarchy is resolved in the same single pass
+//Handles go through a table, reparenting can move a transform to a different slot
+class TransformSystem
+{
+public:
+	TransformSystem();
+
+	TransformHandle Create(const Transform& transform);
+	//The handle is reused by a later Create with a new generation, children are detached and keep their local values as their world transform
+	void Destroy(TransformHandle handle);
+	bool IsValid(TransformHandle handle) const;
+
+	//Position, rotation and scale are relative to the parent, if there is one
+	void SetTransform(TransformHandle handle, const Transform& transform);
+	void SetPosition(TransformHandle handle, const glm::vec3& position);
+	void SetRotation(TransformHandle handle, const glm::vec3& pitchYawRoll);
+	void SetRotation(TransformHandle handle, const glm::quat& rotation);
+	void SetScale(TransformHandle handle, const glm::vec3& scale);
+	//Applied on top of the current rotation, in local space
+	void Rotate(TransformHandle handle, const glm::vec3& pitchYawRoll);
+
+	glm::vec3 GetPosition(TransformHandle handle) const;
+	glm::vec3 GetPitchYawRoll(TransformHandle handle) const;
+	glm::quat GetRotation(TransformHandle handle) const;
+	glm::vec3 GetScale(TransformHandle handle) const;
+
+	//Local values are kept as they are, so the child moves to the same offset from its new parent
+	//Pass a default TransformHandle to detach, throws if parent is child or one of its descendants
+	//When the parent comes after the child, the child and its descendants are moved past the end instead of the slots being sorted again
+	void SetParent(TransformHandle child, TransformHandle parent);
+	//Default handle when it has no parent
+	TransformHandle GetParent(TransformHandle handle) const;
+
+	//Rebuilds every dirty matrix, world = parent world * translation * rotation (quaternion) * scale
+	//Children of a transform that changed are rebuilt too, even when they aren't dirty themselves
+	void UpdateMatrices();
+	//Only current after UpdateMatrices
+	const glm::mat4& GetWorldMatrix(TransformHandle handle) const;
+	const glm::mat4& GetWorldInverseTransposeMatrix(TransformHandle handle) const;
+
+	//Live transforms, not counting free slots
+	uint32_t GetCount() const { return static_cast<uint32_t>(handleSlots.size() - freeHandles.size()); };
+
+	//For evaluating the transforms on the GPU, see TransformEvaluator
+	//Slots include free ones and are always a multiple of 4, a handle's slot changes when SetParent moves it
+	uint32_t GetSlotCount() const { return static_cast<uint32_t>(parents.size()); };
+	uint32_t GetSlotIndex(TransformHandle handle) const { return GetSlot(handle); };
+	//Writes GPU_COMPONENT_COUNT arrays of GetSlotCount() 4 byte values back to back, position xyz, rotation xyzw, scale xyz, then the parent slots
+	void WriteComponents(uint8_t* destination) const;
+	static const uint32_t GPU_COMPONENT_COUNT = 11;
+
+private:
+	//Every array below has one entry per slot, slots are added 4 at a time so the last group can always be loaded whole
+	std::vector<float> positionX, positionY, positionZ;
+	//Normalized quaternion
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<uint8_t> dirty;
+	bool anyDirty;
+
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<glm::mat4> worldInverseTransposeMatrices;
+
+	//Parent's slot, always lower than the child's, NO_SLOT for roots
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> childCounts;
+	//Index into localMatrices for children, their composed matrix has to be kept to multiply by the parent again when only the parent moves
+	std::vector<uint32_t> localIndices;
+	//UpdateMatrices call that last changed the slot's world matrix, tells children their parent moved
+	std::vector<uint32_t> changedPasses;
+	uint32_t pass;
+
+	std::vector<glm::mat4> localMatrices;
+	std::vector<glm::mat4> localInverseTransposeMatrices;
+	std::vector<uint32_t> freeLocals;
+
+	std::vector<uint32_t> slotHandles;
+	std::vector<uint32_t> freeSlots;
+
+	std::vector<uint32_t> handleSlots;
+	std::vector<uint32_t> handleGenerations;
+	std::vector<uint32_t> freeHandles;
+
+	//Throws if the handle is stale
+	uint32_t GetSlot(TransformHandle handle) const;
+	void MarkDirty(uint32_t slot);
+	//Appends count slots past the end, in whole groups of 4, and returns the first
+	uint32_t AppendSlots(uint32_t count);
+	void FreeSlot(uint32_t slot);
+	//Moves slot and every descendant past the end, keeping their order, for when its new parent comes after it
+	void MoveSubtreeToEnd(uint32_t slot);
+	void AttachLocal(uint32_t slot);
+	void DetachLocal(uint32_t slot);
+	//Writes the matrices of slots [first, first + 4), for children these are the local matrices
+	void ComposeGroup(uint32_t first);
+};
@@ -2,8 +2,8 @@
 
 //Good img explaining UBO's - https://vkguide.dev/docs/chapter-4/descriptors/
 
-UniformBufferObject::UniformBufferObject(UniformBufferType bufferType, VulkanCore* vCore, FileManager* fm, Camera* mainCamera)
-	: bufferType{ bufferType }, mainCamera{mainCamera}, vCore {vCore}, fm{fm}
+UniformBufferObject::UniformBufferObject(UniformBufferType bufferType, VulkanCore* vCore, FileManager* fm)
+	: bufferType{ bufferType }, vCore {vCore}, fm{fm}
 {
 	Helper::Cout("Creating Uniform Buffer");
 	device = vCore->GetLogicalDevice();
@@ -13,13 +13,15 @@ UniformBufferObject::UniformBufferObject(UniformBufferType bufferType, VulkanCor
 		mainSampler = *fm->GetAllMaterials()->begin()->second->GetSampler();
 		for (auto& tex : *fm->GetAllTextures())
 		{
-			imageViews.push_back(*tex.second->GetTextureImageView());
+			textures.push_back(tex.second);
 		}
 
-		if (imageViews.empty() || mainSampler == NULL)
+		if (textures.empty() || mainSampler == NULL)
 		{
 			throw std::runtime_error("Attempting to create descriptor set for textures, but either the sampler or image views are missing!");
 		}
+
+		writtenResidencyVersions.resize(MAX_FRAMES_IN_FLIGHT);
 	}
 
 	CreateDescriptorSetLayout();
@@ -73,7 +75,7 @@ void UniformBufferObject::CreateDescriptorSetLayout()
 		//Textures
 		uboLayoutBinding.binding = 0;
 		uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		uboLayoutBinding.descriptorCount = imageViews.size();
+		uboLayoutBinding.descriptorCount = textures.size();
 		uboLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 		uboLayoutBinding.pImmutableSamplers = nullptr;  //Used for image sampling - Optional
 
@@ -103,7 +105,7 @@ void UniformBufferObject::CreateUniformBufers()
 	}
 }
 
-void UniformBufferObject::UpdateUniformBuffer(unsigned short currentFrame)
+void UniformBufferObject::UpdateUniformBuffer(unsigned short currentFrame, const SceneSnapshot& scene)
 {
 	switch (bufferType)
 	{
@@ -112,17 +114,21 @@ void UniformBufferObject::UpdateUniformBuffer(unsigned short currentFrame)
 		//All UBO's are updated per frame, but some just end here so nothing is updated. Maybe change this?
 		break;
 	case(1):
-		mainCamera->UpdateProjectionMatrix();
-		perFrameData.proj = mainCamera->GetProjection();
-
-		mainCamera->UpdateViewMatrix();
-		perFrameData.view = mainCamera->GetView();
+		perFrameData.proj = scene.projection;
+		perFrameData.view = scene.view;
 
 		void* data;
 		vkMapMemory(*device, uniformBuffersMemory[currentFrame], 0, sizeof(UboPerFrame), 0, &data);
 		memcpy(data, &perFrameData, sizeof(perFrameData));
 		vkUnmapMemory(*device, uniformBuffersMemory[currentFrame]);
 		break;
+	case(2):
+		//This frame's fence has been waited on, so its set can be patched once streamed textures become resident
+		if (writtenResidencyVersions[currentFrame] != fm->GetTextureStreamer()->GetResidencyVersion())
+		{
+			WriteTextureDescriptorSet(currentFrame);
+		}
+		break;
 	case(3):
 		break;
 	}
@@ -153,7 +159,7 @@ void UniformBufferObject::CreateDescriptorPool()
 	case(2):
 		//Textures
 		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * imageViews.size());
+		poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * textures.size());
 
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		poolInfo.poolSizeCount = 1;
@@ -187,7 +193,6 @@ void UniformBufferObject::CreateDescriptorSets()
 	size_t sizeOfCorrespondingStruct{};
 	VkWriteDescriptorSet descriptorWrite{};
 	VkDescriptorBufferInfo bufferInfo{};
-	std::vector<VkDescriptorImageInfo> imageInfos(imageViews.size());
 
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) 
@@ -221,29 +226,39 @@ void UniformBufferObject::CreateDescriptorSets()
 			break;
 
 		case(2):
+			WriteTextureDescriptorSet(i);
+			break;
+		}
+	}
+}
 
-			for (uint32_t i = 0; i < imageViews.size(); ++i)
-			{
-				imageInfos[i].sampler = mainSampler;
-				imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-				imageInfos[i].imageView = imageViews[i];
-			}
+void UniformBufferObject::WriteTextureDescriptorSet(unsigned short frame)
+{
+	std::vector<VkDescriptorImageInfo> imageInfos(textures.size());
 
-			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrite.dstSet = descriptorSets[i];
-			descriptorWrite.dstBinding = 0;
-			descriptorWrite.dstArrayElement = 0;
+	for (uint32_t i = 0; i < textures.size(); ++i)
+	{
+		imageInfos[i].sampler = mainSampler;
+		imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		//Placeholder view until the texture is resident
+		imageInfos[i].imageView = *textures[i]->GetTextureImageView();
+	}
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSets[frame];
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
 
-			descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrite.descriptorCount = imageViews.size();
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = textures.size();
 
-			descriptorWrite.pBufferInfo = nullptr;
-			descriptorWrite.pImageInfo = imageInfos.data();
-			descriptorWrite.pTexelBufferView = nullptr; 
+	descriptorWrite.pBufferInfo = nullptr;
+	descriptorWrite.pImageInfo = imageInfos.data();
+	descriptorWrite.pTexelBufferView = nullptr;
 
-			vkUpdateDescriptorSets(*device, 1, &descriptorWrite, 0, nullptr);
-			break;
-		}
-	}
+	vkUpdateDescriptorSets(*device, 1, &descriptorWrite, 0, nullptr);
+
+	writtenResidencyVersions[frame] = fm->GetTextureStreamer()->GetResidencyVersion();
 }
 
@@ -1,7 +1,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vector>
-#include "Camera.h"
+#include "SceneSnapshot.h"
 #include "Helper.h"
 #include "VulkanCore.h"
 #include "FileManager.h"
@@ -33,18 +33,18 @@ class UniformBufferObject
 {
 public:
 
-	UniformBufferObject(UniformBufferType bufferType, VulkanCore* vCore, FileManager* fm, Camera* mainCamera);
+	UniformBufferObject(UniformBufferType bufferType, VulkanCore* vCore, FileManager* fm);
 	~UniformBufferObject();
 
 	VkDescriptorSetLayout* GetDescriptorSetLayout() { return &descriptorSetLayout; };
 	VkDescriptorSet GetDescriptorSet(unsigned short currentFrame) { return descriptorSets[currentFrame]; };
 
-	void UpdateUniformBuffer(unsigned short currentFrame);
+	//PER_FRAME takes the camera from scene, the render thread never reads the live camera
+	void UpdateUniformBuffer(unsigned short currentFrame, const SceneSnapshot& scene);
 private:
 	//Init
 	VulkanCore* vCore;
 	VkDevice* device;
-	Camera* mainCamera;
 	UniformBufferType bufferType;
 	FileManager* fm;
 
@@ -60,13 +60,16 @@ private:
 	std::vector<VkDeviceMemory> uniformBuffersMemory;
 	std::vector<VkDescriptorSet> descriptorSets;
 
-	//Imported from VulkanCore
-	std::vector<VkImageView> imageViews;
+	//Textures are streamed, so their image views are looked up whenever the sets are written
+	std::vector<Texture*> textures;
 	VkSampler mainSampler;
+	//Residency version each frame's texture set was last written with
+	std::vector<uint32_t> writtenResidencyVersions;
 
 
 	void CreateDescriptorSetLayout();
 	void CreateUniformBufers();
 	void CreateDescriptorPool();
 	void CreateDescriptorSets();
+	void WriteTextureDescriptorSet(unsigned short frame);
 };
\ No newline at end of file
@@ -3,52 +3,134 @@
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include <array>
+#include <cstdint>
+
+//Which vertex layout a mesh's vertex buffer uses, picked per mesh at import
+enum class VertexFormat : uint32_t { STANDARD, COMPACT };
+
+//20 byte version of Vertex, made by MeshQuantizer
+struct CompactVertex
+{
+	//unorm16, dequantized in the shader with the mesh's position scale and offset
+	//w is the tangent's handedness, 0 for -1 and 65535 for +1, it rides in the position stream's padding
+	uint16_t position[4];
+	//Half floats
+	uint16_t UV[2];
+	//Octahedral encoded unit vectors, snorm16
+	int16_t normal[2];
+	int16_t tangent[2];
+};
+
+//Vertex buffers hold two streams, every position first and then every other attribute
+//Depth only passes bind just the position stream, so they don't fetch UVs, normals and tangents they never use
+//Attribute stream half of Vertex
+struct VertexAttributes
+{
+	glm::vec2 UV;
+	glm::vec3 normal;
+	glm::vec4 tangent;
+};
+
+//Attribute stream half of CompactVertex
+struct CompactVertexAttributes
+{
+	uint16_t UV[2];
+	int16_t normal[2];
+	int16_t tangent[2];
+};
 
 struct Vertex
 {
 	glm::vec3 position;
 	glm::vec2 UV;
 	glm::vec3 normal;
-	glm::vec3 tangent;
+	//w is the handedness, bitangent = cross(normal, tangent.xyz) * w, so mirrored UVs still get the right one. All zero when the mesh has none
+	glm::vec4 tangent;
 
-	//Describes at which rate to load data from memory throughout the vertices
-	static VkVertexInputBindingDescription getBindingDescription()
+	//Binding 0 is the position stream, binding 1 the attribute stream
+	static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions(VertexFormat format = VertexFormat::STANDARD)
 	{
-		VkVertexInputBindingDescription bindingDescription{};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; //Change for instanced rendering
-		return bindingDescription;
+		std::array<VkVertexInputBindingDescription, 2> bindingDescriptions{};
+
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = getPositionStride(format);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX; //Change for instanced rendering
+
+		bindingDescriptions[1].binding = 1;
+		bindingDescriptions[1].stride = getAttributeStride(format);
+		bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
 	}
 
-	//How to handle the input 
-	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions()
+	//How to handle the input, position is always location 0 so depth only pipelines can take just the first description
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions(VertexFormat format = VertexFormat::STANDARD)
 	{
 		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
 
+		if (format == VertexFormat::COMPACT)
+		{
+			attributeDescriptions[0].binding = 0;
+			attributeDescriptions[0].location = 0;
+			attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+			attributeDescriptions[0].offset = 0;
+
+			attributeDescriptions[1].binding = 1;
+			attributeDescriptions[1].location = 1;
+			attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+			attributeDescriptions[1].offset = offsetof(CompactVertexAttributes, UV);
+
+			attributeDescriptions[2].binding = 1;
+			attributeDescriptions[2].location = 2;
+			attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+			attributeDescriptions[2].offset = offsetof(CompactVertexAttributes, normal);
+
+			attributeDescriptions[3].binding = 1;
+			attributeDescriptions[3].location = 3;
+			attributeDescriptions[3].format = VK_FORMAT_R16G16_SNORM;
+			attributeDescriptions[3].offset = offsetof(CompactVertexAttributes, tangent);
+
+			return attributeDescriptions;
+		}
+
 		attributeDescriptions[0].binding = 0;
 		attributeDescriptions[0].location = 0;
 		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
+		attributeDescriptions[0].offset = 0;
 
-		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].binding = 1;
 		attributeDescriptions[1].location = 1;
 		attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, UV);
+		attributeDescriptions[1].offset = offsetof(VertexAttributes, UV);
 
-		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].binding = 1;
 		attributeDescriptions[2].location = 2;
 		attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, normal);
+		attributeDescriptions[2].offset = offsetof(VertexAttributes, normal);
 
-		attributeDescriptions[3].binding = 0;
+		attributeDescriptions[3].binding = 1;
 		attributeDescriptions[3].location = 3;
-		attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[3].offset = offsetof(Vertex, tangent);
+		attributeDescriptions[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[3].offset = offsetof(VertexAttributes, tangent);
 
 		return attributeDescriptions;
 	}
 
+	static uint32_t getPositionStride(VertexFormat format)
+	{
+		return (format == VertexFormat::COMPACT) ? sizeof(CompactVertex::position) : sizeof(Vertex::position);
+	}
+
+	static uint32_t getAttributeStride(VertexFormat format)
+	{
+		return (format == VertexFormat::COMPACT) ? sizeof(CompactVertexAttributes) : sizeof(VertexAttributes);
+	}
+
+	//Both streams together
+	static uint32_t getStride(VertexFormat format)
+	{
+		return getPositionStride(format) + getAttributeStride(format);
+	}
+
 	bool operator==(const Vertex& other) const 
 	{
 		return position == other.position && UV == other.UV && normal == other.normal;
@@ -1,11 +1,14 @@
 #include "VulkanCore.h"
 #include <map>
 #include <algorithm>
+#include <thread>
+#include <chrono>
 
 VulkanCore::VulkanCore(GLFWwindow* window)
 {
 	Helper::Cout("Vulkan Core", true);
 	this->window = window;
+	UpdateFramebufferSize();
 	InitVulkan();
 }
 
@@ -35,6 +38,8 @@ void VulkanCore::InitVulkan()
 	//Presentation
 	CreateSwapchain();
 	CreateImageViews();
+	depthFormat = FindDepthFormat();
+	CreateDepthResources();
 
 	CreateCommandPools();
 }
@@ -106,6 +111,14 @@ void VulkanCore::SetWindowSize(int width, int height)
 	framebufferResized = true;
 }
 
+void VulkanCore::UpdateFramebufferSize()
+{
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	framebufferWidth = width;
+	framebufferHeight = height;
+}
+
 #pragma region Setup
 
 	void VulkanCore::CreateInstance()
@@ -388,8 +401,17 @@ void VulkanCore::SetWindowSize(int width, int height)
 		#pragma endregion
 
 		#pragma region PhysicalDeviceFeatures
+			VkPhysicalDeviceFeatures supportedFeatures;
+			vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
 			VkPhysicalDeviceFeatures deviceFeatures{};
 			deviceFeatures.samplerAnisotropy = VK_TRUE;
+			//Optional, textures fall back to uncompressed RGBA when it's missing
+			deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+			textureCompressionBCEnabled = supportedFeatures.textureCompressionBC == VK_TRUE;
+			//Optional, meshlet culling is turned off without it
+			deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+			multiDrawIndirectEnabled = supportedFeatures.multiDrawIndirect == VK_TRUE;
 		#pragma endregion
 
 
@@ -406,8 +428,33 @@ void VulkanCore::SetWindowSize(int width, int height)
 
 			//Couldn't figure out deviceFeatures2 :(
 
-			createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-			createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+			//Required extensions, plus whichever optional ones the device has
+			std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+
+			uint32_t extensionCount;
+			vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+			std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+			vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+			for (const auto& optionalExtension : optionalDeviceExtensions)
+			{
+				for (const auto& extension : availableExtensions)
+				{
+					if (std::string(extension.extensionName) == optionalExtension)
+					{
+						enabledExtensions.push_back(optionalExtension);
+						break;
+					}
+				}
+			}
+
+			memoryBudgetEnabled = std::find_if(enabledExtensions.begin(), enabledExtensions.end(),
+				[](const char* name) { return std::string(name) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME; }) != enabledExtensions.end();
+			drawIndirectCountEnabled = std::find_if(enabledExtensions.begin(), enabledExtensions.end(),
+				[](const char* name) { return std::string(name) == VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME; }) != enabledExtensions.end();
+
+			createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+			createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 			if (enableValidationLayers) 
 			{
@@ -608,8 +655,8 @@ void VulkanCore::SetWindowSize(int width, int height)
 			}
 			else
 			{
-				int width, height;
-				glfwGetFramebufferSize(window, &width, &height);
+				const int width = framebufferWidth;
+				const int height = framebufferHeight;
 
 				VkExtent2D actualExtent =
 				{
@@ -638,9 +685,44 @@ void VulkanCore::SetWindowSize(int width, int height)
 		Helper::Cout("Created Image Views!");
 	}
 
+	//First depth format the device can render to, D32 is guaranteed on most desktop GPUs
+	VkFormat VulkanCore::FindDepthFormat()
+	{
+		const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
+
+		for (const VkFormat format : candidates)
+		{
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+			if ((properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0)
+			{
+				return format;
+			}
+		}
+
+		throw std::runtime_error("failed to find a supported depth format!");
+	}
+
+	void VulkanCore::CreateDepthResources()
+	{
+		//Never read after the frame, so its layout is left to the render pass
+		CreateImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+		depthImageView = CreateImageView(depthImage, depthFormat, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+		Helper::Cout("Created Depth Buffer!");
+	}
+
 	//Wraps the swapChainImageViews (aka render targets) in a framebuffer
 	void VulkanCore::CreateFrameBuffers(VkRenderPass* renderPass)
 	{
+		//Swapchain recreation reuses the render pass they were first made with
+		if (renderPass == nullptr)
+		{
+			renderPass = this->currentRenderPass;
+		}
+
 		if (renderPass == nullptr)
 		{
 			throw std::exception("No current render pass for creating framebuffers!");
@@ -651,12 +733,12 @@ void VulkanCore::SetWindowSize(int width, int height)
 
 		for (size_t i = 0; i < swapChainImageViews.size(); i++)
 		{
-			VkImageView attachments[] = { swapChainImageViews[i] };
+			VkImageView attachments[] = { swapChainImageViews[i], depthImageView };
 
 			VkFramebufferCreateInfo framebufferInfo{};
 			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 			framebufferInfo.renderPass = *renderPass;
-			framebufferInfo.attachmentCount = 1;
+			framebufferInfo.attachmentCount = 2;
 			framebufferInfo.pAttachments = attachments;
 			framebufferInfo.width = swapChainExtent.width;
 			framebufferInfo.height = swapChainExtent.height;
@@ -682,6 +764,10 @@ void VulkanCore::SetWindowSize(int width, int height)
 			vkDestroyImageView(device, swapChainImageViews[i], nullptr);
 		}
 
+		vkDestroyImageView(device, depthImageView, nullptr);
+		vkDestroyImage(device, depthImage, nullptr);
+		vkFreeMemory(device, depthImageMemory, nullptr);
+
 		vkDestroySwapchainKHR(device, swapChain, nullptr);
 	}
 
@@ -689,13 +775,12 @@ void VulkanCore::SetWindowSize(int width, int height)
 	{
 		#pragma region Handling Minimization
 
-		//Waits for the window to have a greater width/height then 0 to continue
-			int width = 0, height = 0;
-			glfwGetFramebufferSize(window, &width, &height);
-			while (width == 0 || height == 0)
+		//Nothing to recreate at 0 by 0, tries again on the next frame instead of blocking the drawing thread
+			if (framebufferWidth == 0 || framebufferHeight == 0)
 			{
-				glfwGetFramebufferSize(window, &width, &height);
-				glfwWaitEvents();
+				framebufferResized = true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				return;
 			}
 		#pragma endregion
 
@@ -716,7 +801,7 @@ void VulkanCore::SetWindowSize(int width, int height)
 
 		//Image views need to be recreated because they are based directly on the swap chain images
 		CreateImageViews();
-		//CreateDepthResources();
+		CreateDepthResources();
 		//The framebuffers directly depend on the swap chain images, and thus must be recreated as well 
 		CreateFrameBuffers();
 	}
@@ -824,7 +909,84 @@ void VulkanCore::SetWindowSize(int width, int height)
 		EndSingleTimeCommands(commandBuffer, transferQueue, transferCommandPool);
 	}
 
-	void VulkanCore::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+	void VulkanCore::CreateDeviceLocalBuffer(const void* source, const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+	{
+		CreateDeviceLocalBuffer(size, usage, buffer, bufferMemory, [&](uint8_t* data) { memcpy(data, source, static_cast<size_t>(size)); });
+	}
+
+	void VulkanCore::CreateDeviceLocalBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory, const std::function<void(uint8_t*)>& fill)
+	{
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+		void* data;
+		vkMapMemory(device, stagingBufferMemory, 0, size, 0, &data);
+		try
+		{
+			fill(static_cast<uint8_t*>(data));
+		}
+		catch (...)
+		{
+			//Decoding can throw on a corrupt file, don't leak the staging buffer on the way out
+			vkUnmapMemory(device, stagingBufferMemory);
+			vkDestroyBuffer(device, stagingBuffer, nullptr);
+			vkFreeMemory(device, stagingBufferMemory, nullptr);
+			throw;
+		}
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+
+		{
+			std::lock_guard<std::mutex> lock(uploadBatchMutex);
+			if (uploadBatchCommandBuffer != VK_NULL_HANDLE)
+			{
+				VkBufferCopy copyRegion{};
+				copyRegion.size = size;
+				vkCmdCopyBuffer(uploadBatchCommandBuffer, stagingBuffer, buffer, 1, &copyRegion);
+				uploadBatchStaging.emplace_back(stagingBuffer, stagingBufferMemory);
+				return;
+			}
+		}
+
+		CopyBuffer(stagingBuffer, buffer, size);
+
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	}
+
+	void VulkanCore::BeginUploadBatch()
+	{
+		std::lock_guard<std::mutex> lock(uploadBatchMutex);
+		if (uploadBatchCommandBuffer != VK_NULL_HANDLE)
+		{
+			throw std::runtime_error("Upload batch is already open!");
+		}
+		uploadBatchCommandBuffer = BeginSingleTimeCommands(transferCommandPool);
+	}
+
+	void VulkanCore::EndUploadBatch()
+	{
+		std::lock_guard<std::mutex> lock(uploadBatchMutex);
+		if (uploadBatchCommandBuffer == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		EndSingleTimeCommands(uploadBatchCommandBuffer, transferQueue, transferCommandPool);
+		uploadBatchCommandBuffer = VK_NULL_HANDLE;
+
+		Helper::Cout("- Uploaded " + std::to_string(uploadBatchStaging.size()) + " buffers in one batch");
+		for (auto& staging : uploadBatchStaging)
+		{
+			vkDestroyBuffer(device, staging.first, nullptr);
+			vkFreeMemory(device, staging.second, nullptr);
+		}
+		uploadBatchStaging.clear();
+	}
+
+	void VulkanCore::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, uint32_t mipLevels)
 	{
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -832,10 +994,9 @@ void VulkanCore::SetWindowSize(int width, int height)
 		imageInfo.extent.width = width;
 		imageInfo.extent.height = height;
 		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = 1;
+		imageInfo.mipLevels = mipLevels;
 		imageInfo.arrayLayers = 1;
 
-		//TODO check if this format is supported
 		imageInfo.format = format;
 		//If I want to directly access texels in the memory of the img, then switch this
 		imageInfo.tiling = tiling;
@@ -936,10 +1097,17 @@ void VulkanCore::SetWindowSize(int width, int height)
 		vkFreeCommandBuffers(device, pool, 1, &commandBuffer);
 	}
 
-	void VulkanCore::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+	void VulkanCore::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
 	{
 		VkCommandBuffer commandBuffer = BeginSingleTimeCommands(graphicsCommandPool);
-		
+
+		RecordImageLayoutTransition(commandBuffer, image, oldLayout, newLayout, mipLevels);
+
+		EndSingleTimeCommands(commandBuffer, graphicsQueue, graphicsCommandPool);
+	}
+
+	void VulkanCore::RecordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+	{
 		#pragma region Barrier
 			VkImageMemoryBarrier barrier{};
 			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -953,7 +1121,7 @@ void VulkanCore::SetWindowSize(int width, int height)
 			barrier.image = image;
 			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			barrier.subresourceRange.baseMipLevel = 0;
-			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.levelCount = mipLevels;
 			barrier.subresourceRange.baseArrayLayer = 0;
 			barrier.subresourceRange.layerCount = 1;
 
@@ -990,10 +1158,6 @@ void VulkanCore::SetWindowSize(int width, int height)
 				1, &barrier
 			);
 		#pragma endregion
-
-		
-
-		EndSingleTimeCommands(commandBuffer, graphicsQueue, graphicsCommandPool);
 	}
 
 	void VulkanCore::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
@@ -1018,16 +1182,61 @@ void VulkanCore::SetWindowSize(int width, int height)
 		EndSingleTimeCommands(commandBuffer, transferQueue, transferCommandPool);
 	}
 
-	VkImageView VulkanCore::CreateImageView(VkImage image, VkFormat format)
+	void VulkanCore::CopyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions)
+	{
+		VkCommandBuffer commandBuffer = BeginSingleTimeCommands(transferCommandPool);
+
+		vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+		EndSingleTimeCommands(commandBuffer, transferQueue, transferCommandPool);
+	}
+
+	VkDeviceSize VulkanCore::GetDeviceLocalMemoryBudget()
+	{
+		if (!memoryBudgetEnabled)
+		{
+			return 0;
+		}
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+		memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memoryProperties.pNext = &budgetProperties;
+
+		vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties);
+
+		VkDeviceSize budget = 0;
+		for (uint32_t i = 0; i < memoryProperties.memoryProperties.memoryHeapCount; i++)
+		{
+			if (memoryProperties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			{
+				budget += budgetProperties.heapBudget[i];
+			}
+		}
+
+		return budget;
+	}
+
+	bool VulkanCore::IsFormatSampleable(VkFormat format)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+		return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	}
+
+	VkImageView VulkanCore::CreateImageView(VkImage image, VkFormat format, uint32_t mipLevels, VkImageAspectFlags aspectMask)
 	{
 		VkImageViewCreateInfo viewInfo{};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 		viewInfo.image = image;
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 		viewInfo.format = format;
-		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.aspectMask = aspectMask;
 		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.levelCount = mipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
 
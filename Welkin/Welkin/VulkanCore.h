@@ -16,6 +16,9 @@
 #include <string>
 #include <optional>
 #include <algorithm>
+#include <functional>
+#include <mutex>
+#include <atomic>
 
 #include "Helper.h"
 
@@ -31,7 +34,10 @@ public:
 
 	//Window resizing
 	void SetWindowSize(int width, int height);
-	bool framebufferResized = false;
+	//Set from the main thread, read by whichever thread draws
+	std::atomic<bool> framebufferResized{ false };
+	//GLFW can only be asked for the framebuffer size on the main thread, call this there after polling events so the swap chain can be recreated from any thread
+	void UpdateFramebufferSize();
 	
 	//Getters
 	VkDevice* GetLogicalDevice();
@@ -47,7 +53,17 @@ public:
 	VkCommandPool* GetCommandPool(int type);
 	VkSwapchainKHR* GetSwapchain() { return &this->swapChain; };
 	VkExtent2D* GetSwapchainExtent() { return &this->swapChainExtent; };
+	//Format of the depth attachment every swapchain framebuffer has after its color attachment
+	VkFormat GetDepthFormat() { return this->depthFormat; };
 	VkPhysicalDeviceProperties GetPhysicalDeviceProperties();
+	//Block compressed (BC1-BC7) textures can be sampled
+	bool IsTextureCompressionBCEnabled() { return this->textureCompressionBCEnabled; };
+	//Device local memory this process can use from VK_EXT_memory_budget, 0 if the extension isn't available
+	VkDeviceSize GetDeviceLocalMemoryBudget();
+	//VK_KHR_draw_indirect_count, lets the GPU decide how many indirect draws run
+	bool IsDrawIndirectCountEnabled() { return this->drawIndirectCountEnabled; };
+	//More than one draw per vkCmdDrawIndexedIndirect
+	bool IsMultiDrawIndirectEnabled() { return this->multiDrawIndirectEnabled; };
 
 	//Called from renderer
 	void CreateFrameBuffers(VkRenderPass* renderPass = nullptr);
@@ -58,11 +74,27 @@ public:
 
 	void CreateBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 	void CopyBuffer(const VkBuffer srcBuffer, const VkBuffer dstBuffer, const VkDeviceSize size);
-	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+	//Copies source into a new device local buffer through a temporary staging buffer
+	void CreateDeviceLocalBuffer(const void* source, const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	//Same, but fill writes the contents straight into the mapped staging buffer, saves a copy for data that has to be built or decoded first
+	void CreateDeviceLocalBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory, const std::function<void(uint8_t*)>& fill);
+	//Device local buffers created between these are copied in a single submit at EndUploadBatch instead of one wait each
+	//Any thread can create them while the batch is open, none of them are usable until it ends
+	void BeginUploadBatch();
+	void EndUploadBatch();
+	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, uint32_t mipLevels = 1);
 	uint32_t FindMemoryType(const uint32_t type_filter, const VkMemoryPropertyFlags properties);
 	void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	VkImageView CreateImageView(VkImage image, VkFormat format);
+	//One region per mip level, all recorded into a single submit
+	void CopyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
+	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+	//Same barrier as TransitionImageLayout, but recorded into a command buffer the caller submits
+	void RecordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+	VkImageView CreateImageView(VkImage image, VkFormat format, uint32_t mipLevels = 1, VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT);
+	bool IsFormatSampleable(VkFormat format);
+	//Submitting waits for the queue to go idle
+	VkCommandBuffer BeginSingleTimeCommands(VkCommandPool pool);
+	void EndSingleTimeCommands(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool);
 #pragma endregion
 
 
@@ -74,10 +106,17 @@ private:
 	VkPhysicalDevice physicalDevice;
 	//Logical Device
 	VkDevice device;
+	bool textureCompressionBCEnabled = false;
+	bool memoryBudgetEnabled = false;
+	bool drawIndirectCountEnabled = false;
+	bool multiDrawIndirectEnabled = false;
 	//Pointer to the GLFW window we created
 	GLFWwindow* window;
+	//Last size UpdateFramebufferSize saw, zero while minimized
+	std::atomic<int> framebufferWidth{ 0 };
+	std::atomic<int> framebufferHeight{ 0 };
 	//Taken from renderer
-	VkRenderPass* currentRenderPass;
+	VkRenderPass* currentRenderPass = nullptr;
 
 
 	//Queues ---------
@@ -122,6 +161,8 @@ private:
 	#pragma endregion
 
 	const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	//Enabled when the device has them
+	const std::vector<const char*> optionalDeviceExtensions = { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME };
 
 #pragma endregion
 
@@ -142,6 +183,11 @@ private:
 	VkExtent2D swapChainExtent;
 	//Holds the attachments for the swinchain
 	std::vector<VkFramebuffer> swapChainFramebuffers;
+	//One depth buffer shared by every framebuffer, only one frame draws at a time
+	VkFormat depthFormat;
+	VkImage depthImage;
+	VkDeviceMemory depthImageMemory;
+	VkImageView depthImageView;
 
 
 
@@ -151,6 +197,8 @@ private:
 	VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
 	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 	void CreateImageViews();
+	VkFormat FindDepthFormat();
+	void CreateDepthResources();
 	void CleanupSwapChain();
 
 
@@ -173,8 +221,12 @@ private:
 	VkCommandPool transferCommandPool;
 
 #pragma region Buffers
-	VkCommandBuffer BeginSingleTimeCommands(VkCommandPool pool);
-	void EndSingleTimeCommands(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool);
+	//Open upload batch, recorded into from several threads so guarded by uploadBatchMutex
+	std::mutex uploadBatchMutex;
+	VkCommandBuffer uploadBatchCommandBuffer = VK_NULL_HANDLE;
+	//Staging buffers the batch copies from, freed once it has been submitted
+	std::vector<std::pair<VkBuffer, VkDeviceMemory>> uploadBatchStaging;
+
 	void CreateDescriptorsForTextures();
 #pragma endregion
 